@@ -70,7 +70,36 @@ void OSDCFlushRange(const void *start, u32 size);
 
 u32 OSVirtualToPhysical(u32 virtualAddress);
 
+s32 OSIOSCImportPublicKey(const void* publicKeyData, const void* exponent, u32 keyHandle);
+s32 OSIOSCComputeSharedKey(u32 privateKeyHandle, u32 publicKeyHandle, u32 sharedKeyHandle);
 s32 OSGetIOSCData(u32 keyHandle, u32* value);
+s32 OSIOSCVerifyPublicKeySign(const void* hash, u32 hashSize, u32 keyHandle, const void* signData);
+s32 OSIOSCImportCertificate(const void* certData, u32 signerHandle, u32 publicKeyHandle);
+s32 OSIOSCGeneratePublicKeySign(const void* hash, u32 hashSize, u32 keyHandle, void* signData);
+
+//starstruck specific syscalls
+void* OSReallocateMemory(s32 heapid, void* ptr, u32 size);
+s32 OSSetTimerSlack(s32 timerId, u32 slackUs);
+s32 OSGetMonotonicTime(u64* ticks);
+s32 OSSleepThread(u32 delayUs);
+s32 OSReceiveMessageTimeout(s32 queueid, void **message, u32 timeoutUs);
+//statistics : top half ticks (u64), wake latency ticks (u64), count, max top half ticks, wakeups, max wake latency ticks,
+//coalesced interrupts (timer alarms saved by timer slack), reserved.
+//irq 32 returns the totals of all irqs, with the longest run of the whole irq handler as max top half ticks
+s32 OSGetInterruptStatistics(u32 irq, u32 statistics[10]);
+s32 OSRegisterEventCounter(u8 device, s32 queueid, void* message);
+s32 OSTakeEventCount(u8 device);
+s32 OSStartProfiler(u32 intervalUs, u32 samples);
+s32 OSStopProfiler(void);
+s32 OSDumpProfilerSamples(void);
+s32 OSStartTracing(u32 events);
+s32 OSStopTracing(void);
+s32 OSDumpTraceEvents(void);
+s32 OSIOSCDecryptAndVerify(u32 keyHandle, void* ivData, const void* inputData, u32 dataSize, void* outputData, const void* expectedHash);
+//statistics : hits, misses of the kernel's pointer validation cache
+s32 OSGetPointerCacheStatistics(u32 statistics[2]);
+//statistics : sections, course pages mapped in the domains the process has access to
+s32 OSGetMemoryMappingStatistics(u32 pid, u32 statistics[2]);
 
 //special IOS syscall to print something to debug device
 void OSPrintk(const char* str);
@@ -23,7 +23,31 @@
 	END_ASM_FUNC
 .endm
 
-_SYSCALL OSCreateThread,			0x0000
+#the kernel hands r0-r9 of the caller to the syscall handler, but the arguments after the 4th one are on the stack.
+#these load them into r4 and up before the swi, and restore the caller's registers afterwards
+.macro _SYSCALL_STACKARGS name, syscall, stackArguments
+	.globl \name
+    BEGIN_ASM_FUNC \name
+		push	{r4-r7}
+		.if \stackArguments > 0
+		ldr		r4, [sp, #0x10]
+		.endif
+		.if \stackArguments > 1
+		ldr		r5, [sp, #0x14]
+		.endif
+		.if \stackArguments > 2
+		ldr		r6, [sp, #0x18]
+		.endif
+		.if \stackArguments > 3
+		ldr		r7, [sp, #0x1C]
+		.endif
+		swi		\syscall
+		pop		{r4-r7}
+		bx		lr
+	END_ASM_FUNC
+.endm
+
+_SYSCALL_STACKARGS OSCreateThread,	0x0000, 2
 _SYSCALL OSJoinThread,				0x0001
 _SYSCALL OSStopThread,				0x0002
 _SYSCALL OSGetThreadId,				0x0003
@@ -55,15 +79,15 @@ _SYSCALL OSCloseFD,					0x001D
 _SYSCALL OSReadFD,					0x001E
 _SYSCALL OSWriteFD,					0x001F
 _SYSCALL OSSeekFD,					0x0020
-_SYSCALL OSIoctlFD,					0x0021
-_SYSCALL OSIoctlvFD,				0x0022
+_SYSCALL_STACKARGS OSIoctlFD,	0x0021, 2
+_SYSCALL_STACKARGS OSIoctlvFD,	0x0022, 1
 _SYSCALL OSOpenFDAsync,				0x0023
 _SYSCALL OSCloseFDAsync,			0x0024
-_SYSCALL OSReadFDAsync,				0x0025
-_SYSCALL OSWriteFDAsync,			0x0026
-_SYSCALL OSSeekFDAsync,				0x0027
-_SYSCALL OSIoctlFDAsync,			0x0028
-_SYSCALL OSIoctlvFDAsync,			0x0029
+_SYSCALL_STACKARGS OSReadFDAsync,	0x0025, 1
+_SYSCALL_STACKARGS OSWriteFDAsync,	0x0026, 1
+_SYSCALL_STACKARGS OSSeekFDAsync,	0x0027, 1
+_SYSCALL_STACKARGS OSIoctlFDAsync,	0x0028, 4
+_SYSCALL_STACKARGS OSIoctlvFDAsync,	0x0029, 3
 _SYSCALL OSResourceReply,			0x002A
 _SYSCALL OSSetUID,					0x002B
 _SYSCALL OSGetUID,					0x002C
@@ -77,7 +101,31 @@ _SYSCALL OSDCFlushRange,			0x0040
 
 _SYSCALL OSVirtualToPhysical,		0x004F
 
+_SYSCALL OSIOSCImportPublicKey,		0x005F
+_SYSCALL OSIOSCComputeSharedKey,		0x0061
 _SYSCALL OSGetIOSCData				0x0063
+_SYSCALL OSIOSCVerifyPublicKeySign,	0x006C
+_SYSCALL OSIOSCImportCertificate,	0x006F
+_SYSCALL OSIOSCGeneratePublicKeySign,	0x0075
+
+#starstruck specific syscalls
+_SYSCALL OSReallocateMemory,		0x0080
+_SYSCALL OSSetTimerSlack,			0x0081
+_SYSCALL OSGetMonotonicTime,		0x0082
+_SYSCALL OSSleepThread,				0x0083
+_SYSCALL OSReceiveMessageTimeout,	0x0084
+_SYSCALL OSGetInterruptStatistics,	0x0085
+_SYSCALL OSRegisterEventCounter,	0x0086
+_SYSCALL OSTakeEventCount,			0x0087
+_SYSCALL OSStartProfiler,			0x0088
+_SYSCALL OSStopProfiler,			0x0089
+_SYSCALL OSDumpProfilerSamples,		0x008A
+_SYSCALL OSStartTracing,			0x008B
+_SYSCALL OSStopTracing,				0x008C
+_SYSCALL OSDumpTraceEvents,			0x008D
+_SYSCALL_STACKARGS OSIOSCDecryptAndVerify,	0x008E, 2
+_SYSCALL OSGetPointerCacheStatistics,	0x008F
+_SYSCALL OSGetMemoryMappingStatistics,	0x0090
 
 /* this is a special svc syscall. its the only syscall left in IOS. only used for printk too */
 .thumb
@@ -12,6 +12,13 @@ https://negix.net/trac/pdclib
 
 #include "string.h"
 
+//the word & block loops are built as arm code on starlet. kernel/tools/memcpybench builds this file for the host, as plain c
+#ifdef __arm__
+#define ARM_CODE __attribute__((target("arm")))
+#else
+#define ARM_CODE
+#endif
+
 size_t strlen(const char *s)
 {
 	size_t len;
@@ -36,12 +43,22 @@ void set_memory(void* dest, const unsigned char data, size_t len)
 {
 	if (dest < (void *)0x1800000) 
 	{
-		for(; len != 0; len--)
+		//do all bytes that are in the same word with a single read-modify-write
+		while(len != 0)
 		{
 			u32* address = (u32*)((u32)dest & (u32)~0x03);
-			u32 offset = 24 - ((u32)dest & 0x03) * 8;
-			*address = (*address & (u32)~(0xFF << offset)) | (data << offset);;
-			dest++;
+			u32 offset = (u32)dest & 0x03;
+			u32 count = 4 - offset;
+			if(count > len)
+				count = len;
+
+			u32 mask = 0xFFFFFFFF >> (offset * 8);
+			if(offset + count < 4)
+				mask &= (u32)~(0xFFFFFFFF >> ((offset + count) * 8));
+
+			*address = (*address & ~mask) | (((u32)data * 0x01010101) & mask);
+			dest += count;
+			len -= count;
 		}
 	}
 	else 
@@ -55,19 +72,31 @@ void set_memory(void* dest, const unsigned char data, size_t len)
 }
 
 //this is more like a regular memset, but only used at the end of memset..
-__attribute__((target("arm")))
+ARM_CODE
 void set_memory_short(void* dest, const unsigned char c, size_t len)
 {
 	u32 data = c | (c << 8) | (u32)(c << 16) | (u32)(c << 24);
+#ifdef __arm__
 	register u32 data1 asm("r3") = data;
 	register u32 data2 asm ("r4") = data;
 	register u32 data3 asm ("r5") = data;
+#else
+	u32 data1 = data, data2 = data, data3 = data;
+#endif
 	u32* address = dest;
 	for(u32 index = len & 0xFFFFFFF0; index != 0; index -= 0x10)
 	{
+#ifdef __arm__
 		__asm__ volatile ("stmia	%[address]!, {%[data],%[data1],%[data2],%[data3]}" 
 			: 
 			: [address] "r" (address), [data] "r" (data), [data1] "r" (data1), [data2] "r" (data2), [data3] "r" (data3));
+#else
+		address[0] = data;
+		address[1] = data1;
+		address[2] = data2;
+		address[3] = data3;
+		address += 4;
+#endif
 	}
 
 	for(u32 index = len & 0x0F; index != 0; index -= 4)
@@ -154,89 +183,231 @@ void *memset(void *dest, int character, size_t length)
 	return dest;
 }
 
-// memcpy
-// IOS has a completely custom memcpy to deal with a MEM1 HW bug
-// MEM1 accesses of 4 bytes (strb & strh) to MEM1 will thrash 4 bytes
-// hence the weird access/seperation of code
-__attribute__((target("arm")))
-void *memcpy(void *dest, const void *src, size_t len)
-{	
-	if(len == 0)
-		return dest;
-	
-	//these are normal for ARM (r0 - r2 = function arguments)
-	//however, to make sure we have the values in these registers we will redefine them here
-	//nintendo's memcpy is very optimised and custom written and its lovely lol
-	register size_t length asm("r3") = len;
-	register void *source asm ("r2") = (void*)src;
-	register void *destination asm ("r1") = dest;
-	register void *ret asm ("r0") = dest;
-	
-	if((((u32)destination | (u32)source) & 0x03) == 0)
+//starlet runs big endian, so the first byte in memory is the most significant byte of a word.
+//this takes the bytes we need out of 2 consecutive (aligned) words, when the data is shift bits into the first word
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MERGE_WORDS(first, second, shift)	(((first) >> (shift)) | ((second) << (32 - (shift))))
+#else
+#define MERGE_WORDS(first, second, shift)	(((first) << (shift)) | ((second) >> (32 - (shift))))
+#endif
+#ifndef IS_MEM1
+#define IS_MEM1(address)					((u32)(address) < 0x01800000)
+#endif
+
+//copies less than 4 bytes that are all within the same destination word
+//in MEM1 this is done as a single read-modify-write of that word.
+//the source is read completely before writing, so this works for overlapping buffers in both directions
+static inline void copy_partial_word(u8* dest, const u8* src, u32 count)
+{
+	if(count == 0)
+		return;
+
+	if(!IS_MEM1(dest))
+	{
+		u8 data[3];
+		for(u32 index = 0; index < count; index++)
+			data[index] = src[index];
+		for(u32 index = 0; index < count; index++)
+			dest[index] = data[index];
+		return;
+	}
+
+	u32* address = (u32*)(dest - ((u32)dest & 0x03));
+	u32 value = *address;
+	for(u32 offset = 24 - ((u32)dest & 0x03) * 8; count != 0; count--, offset -= 8)
+		value = (value & (u32)~(0xFF << offset)) | (u32)(*src++ << offset);
+
+	*address = value;
+}
+
+//copies blocks of 0x20 bytes between word aligned buffers
+ARM_CODE
+static void copy_blocks_forward(u32** dest, const u32** src, u32 blocks)
+{
+	u32* destination = *dest;
+	const u32* source = *src;
+#ifdef __arm__
+	__asm__ volatile ("\
+		1: \n\
+		ldmia		%[source]!,{r3,r4,r5,r6,r7,r8,r9,r10} \n\
+		stmia		%[destination]!,{r3,r4,r5,r6,r7,r8,r9,r10} \n\
+		subs		%[blocks],%[blocks], #1 \n\
+		bne			1b \n"
+		: [source] "+r" (source), [destination] "+r" (destination), [blocks] "+r" (blocks)
+		:
+		: "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+	for(; blocks != 0; blocks--, source += 8, destination += 8)
 	{
-		__asm__ volatile ("\
-			#Save the register values that GCC might have used before the asm \n\
-			stmdb		sp!,{r4,r5,r6,r7,r8,r9,r10,r11} \n\
-			#check if we can do a 0x10 copy paste \n\
-			cmp			%[length], #0x0F \n\
-			bls			memcpy_end \n\
-			#check if we can do a 0x20 copy/paste \n\
-			cmp			%[length], #0x1F \n\
-			bls			memcpy_By16 \n\
-			memcpy_by32: \n\
-			ldmia		%[source]!,{r4,r5,r6,r7,r8,r9,r10,r11} \n\
-			stmia		%[destination]!,{r4,r5,r6,r7,r8,r9,r10,r11} \n\
-			sub			%[length],%[length], #0x20 \n\
-			cmp			%[length], #0x1F \n\
-			bls			memcpy_By16 \n\
-			b			memcpy_by32 \n\
-			memcpy_By16: \n\
-			cmp			%[length], #0x0F \n\
-			bls			memcpy_end \n\
-			ldmia		%[source]!,{r4,r5,r6,r7} \n\
-			stmia		%[destination]!,{r4,r5,r6,r7} \n\
-			sub			%[length],%[length], #0x10 \n\
-			b			memcpy_By16 \n\
-			memcpy_end: \n\
-			ldmia		sp!,{r4,r5,r6,r7,r8,r9,r10,r11} \n"
-			:
-			: [source] "r" (source), [destination] "r" (destination), [length] "r" (length));
-
-		//ok, nintendo's beauty has run, now we are left to copy 4 bytes at a time
-		while(length >= 4)
+		for(u32 index = 0; index < 8; index++)
+			destination[index] = source[index];
+	}
+#endif
+	*dest = destination;
+	*src = source;
+}
+
+//same as above, but from the end of both buffers towards the start
+ARM_CODE
+static void copy_blocks_backward(u32** dest, const u32** src, u32 blocks)
+{
+	u32* destination = *dest;
+	const u32* source = *src;
+#ifdef __arm__
+	__asm__ volatile ("\
+		1: \n\
+		ldmdb		%[source]!,{r3,r4,r5,r6,r7,r8,r9,r10} \n\
+		stmdb		%[destination]!,{r3,r4,r5,r6,r7,r8,r9,r10} \n\
+		subs		%[blocks],%[blocks], #1 \n\
+		bne			1b \n"
+		: [source] "+r" (source), [destination] "+r" (destination), [blocks] "+r" (blocks)
+		:
+		: "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "cc", "memory");
+#else
+	for(; blocks != 0; blocks--)
+	{
+		source -= 8;
+		destination -= 8;
+		for(u32 index = 8; index != 0; index--)
+			destination[index - 1] = source[index - 1];
+	}
+#endif
+	*dest = destination;
+	*src = source;
+}
+
+//copies from the start to the end. safe for overlapping buffers as long as dest < src
+//the MEM1 hardware bug only affects sub-word writes, so we align the destination and only write whole words
+ARM_CODE
+static void copy_forward(u8* dest, const u8* src, size_t length)
+{
+	u32 head = (4 - ((u32)dest & 0x03)) & 0x03;
+	if(head > length)
+		head = length;
+
+	copy_partial_word(dest, src, head);
+	dest += head;
+	src += head;
+	length -= head;
+
+	u32* destination = (u32*)dest;
+	u32 words = length >> 2;
+	if(((u32)src & 0x03) == 0)
+	{
+		const u32* source = (const u32*)src;
+		if(words >= 8)
 		{
-			*(u32*)destination = *(u32*)source;
-			destination += 4;
+			copy_blocks_forward(&destination, &source, words >> 3);
+			words &= 0x07;
+		}
+
+		for(; words != 0; words--)
+			*destination++ = *source++;
+	}
+	else
+	{
+		//read aligned words from the source and merge them into the words we need
+		u32 shift = ((u32)src & 0x03) * 8;
+		const u32* source = (const u32*)(src - ((u32)src & 0x03));
+		u32 first = *source++;
+		for(; words >= 4; words -= 4)
+		{
+			u32 second = source[0];
+			u32 third = source[1];
+			u32 fourth = source[2];
+			u32 fifth = source[3];
+			destination[0] = MERGE_WORDS(first, second, shift);
+			destination[1] = MERGE_WORDS(second, third, shift);
+			destination[2] = MERGE_WORDS(third, fourth, shift);
+			destination[3] = MERGE_WORDS(fourth, fifth, shift);
+			first = fifth;
 			source += 4;
-			length -= 4;
+			destination += 4;
+		}
+
+		for(; words != 0; words--)
+		{
+			u32 second = *source++;
+			*destination++ = MERGE_WORDS(first, second, shift);
+			first = second;
 		}
 	}
 
-	//and then there is the MEM1 issue, which means single bytes they also need to be copied by 4 bytes
-	if (destination < (void *)0x1800000) 
+	src += length & (u32)~0x03;
+	copy_partial_word((u8*)destination, src, length & 0x03);
+}
+
+//copies from the end to the start. used for overlapping buffers where dest > src
+ARM_CODE
+static void copy_backward(u8* dest, const u8* src, size_t length)
+{
+	u8* destinationEnd = dest + length;
+	const u8* sourceEnd = src + length;
+	u32 tail = (u32)destinationEnd & 0x03;
+	if(tail > length)
+		tail = length;
+
+	destinationEnd -= tail;
+	sourceEnd -= tail;
+	length -= tail;
+	copy_partial_word(destinationEnd, sourceEnd, tail);
+
+	u32* destination = (u32*)destinationEnd;
+	u32 words = length >> 2;
+	if(((u32)sourceEnd & 0x03) == 0)
 	{
-		for(; length != 0; length--)
+		const u32* source = (const u32*)sourceEnd;
+		if(words >= 8)
 		{
-			u32* address = (u32*)((u32)dest & (u32)~0x03);
-			u32 offset = 24 - ((u32)dest & 0x03) * 8;
-			u8 data = *(u8*)source;
-			*address = (*address & (u32)~(0xFF << (offset & 0xFF))) | (data << (offset & 0xFF));
-			destination++;
-			source++;
+			copy_blocks_backward(&destination, &source, words >> 3);
+			words &= 0x07;
 		}
+
+		for(; words != 0; words--)
+			*--destination = *--source;
 	}
-	else 
+	else
 	{
-		while(length != 0)
+		u32 shift = ((u32)sourceEnd & 0x03) * 8;
+		const u32* source = (const u32*)(sourceEnd - ((u32)sourceEnd & 0x03));
+		u32 second = *source;
+		for(; words != 0; words--)
 		{
-			*(u8*)destination = *(u8*)source;
-			destination++;
-			source++;
-			length--;
+			u32 first = *--source;
+			*--destination = MERGE_WORDS(first, second, shift);
+			second = first;
 		}
 	}
 
-	return ret;
+	length &= 0x03;
+	copy_partial_word(dest, src, length);
+}
+
+// memcpy
+// IOS has a completely custom memcpy to deal with a MEM1 HW bug
+// MEM1 accesses of 4 bytes (strb & strh) to MEM1 will thrash 4 bytes
+// hence we only write whole words, except for the unaligned head & tail
+void *memcpy(void *dest, const void *src, size_t len)
+{
+	if(len != 0)
+		copy_forward((u8*)dest, (const u8*)src, len);
+
+	return dest;
+}
+
+// memmove
+// same as memcpy, but copies backwards if the buffers overlap & the destination is after the source
+void *memmove(void *dest, const void *src, size_t len)
+{
+	if(len == 0 || dest == src)
+		return dest;
+
+	if((u8*)dest < (const u8*)src || (u8*)dest >= ((const u8*)src) + len)
+		copy_forward((u8*)dest, (const u8*)src, len);
+	else
+		copy_backward((u8*)dest, (const u8*)src, len);
+
+	return dest;
 }
 
 int memcmp(const void *s1, const void *s2, size_t len)
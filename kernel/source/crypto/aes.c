@@ -11,8 +11,11 @@
 #include <string.h>
 #include <ios/processor.h>
 #include <ios/errno.h>
+#include <ios/gecko.h>
 
 #include "aes.h"
+#include "sha.h"
+#include "softwareCrypto.h"
 #include "panic.h"
 #include "memory/memory.h"
 #include "memory/heaps.h"
@@ -23,6 +26,7 @@
 #include "messaging/resourceManager.h"
 #include "messaging/ipc.h"
 #include "filedesc/filedesc_types.h"
+#include "filedesc/calls_inner.h"
 
 #ifndef MIOS
 
@@ -30,7 +34,8 @@ typedef enum
 { 
 	COPY = 0,
 	ENCRYPT = 2,
-	DECRYPT = 3
+	DECRYPT = 3,
+	DECRYPT_AND_VERIFY = 4
 } AESCommandTypes;
 
 typedef union {
@@ -47,36 +52,482 @@ typedef union {
 	u32 Value;
 } AESCommand;
 
+typedef enum
+{
+	AesDescriptorFree = 0,
+	AesDescriptorQueued,
+	AesDescriptorRunning,
+	AesDescriptorDone,
+	AesDescriptorFailed,
+} AesDescriptorState;
+
+//a request handed to the engine. the completion irq works through them in order, so the engine never waits on the handler thread
+typedef struct
+{
+	IpcMessage* Message;
+	u32 Ioctl;
+	const void* Input;
+	void* Output;
+	u32 Length;
+	u32 Source;
+	u32 Destination;
+	u32 BlocksLeft;
+	u32 CommandBlocks;
+	u32 Key[4];
+	u32 IV[4];
+	u32 NextIV[4];
+	u32 State;
+	u8 FirstCommand;
+	u8 Retried;
+} AesDescriptor;
+
 s32 AesEventMessageQueueId = 0;
+static s32 AesResourceQueueId = 0;
+static AesDescriptor AesDescriptors[AES_QUEUE_DEPTH];
+//oldest descriptor waiting for its reply, next free descriptor & the descriptor the engine is working on
+static u32 AesQueueHead = 0;
+static u32 AesQueueTail = 0;
+static u32 AesQueueRunning = 0;
+static u8 AesEngineBusy = 0;
+//key currently in the engine, so consecutive requests with the same key don't reprogram it.
+//the engine keeps its key until it is reset (AES_CMD = 0), mini's aes_decrypt also sets it once for all its commands.
+//the reset on an engine error clears AesKeyLoaded
+static u32 AesLoadedKey[4];
+static u8 AesKeyLoaded = 0;
+static u8 AesCompletionSignalled = 0;
+static u8 AesWaitingForDescriptor = 0;
+//set when a chunk of a DECRYPT_AND_VERIFY request failed in the engine
+static u8 AesPipelineFailed = 0;
+
+//the completion irq wakes the handler thread through its resource manager queue. AesCompletionSignalled keeps at most one
+//of these in it, and the queue has a slot for it on top of the ones for requests
+#define AES_COMPLETION_MESSAGE ((IpcMessage*)AesDescriptors)
+#define AES_RM_QUEUE_SIZE (8 + 1)
+
+//set when all requests run on the cpu, either because of SOFTWARE_CRYPTO or because the engine kept failing
+static u8 AesUseSoftware = SOFTWARE_CRYPTO_DEFAULT;
+//set when the engine failed a request twice, so it gets checked on kernel memory before the next request
+static u8 AesCheckEngineNeeded = 0;
+//failed checks of the engine
+static u32 AesEngineFailures = 0;
+//the software path keeps the expanded key of the last request, like the engine keeps its key
+static SoftwareAesKey AesSoftwareKey;
+static u32 AesSoftwareKeyData[4];
+static u8 AesSoftwareKeyExpanded = 0;
+
+//runs the whole request on the cpu, leaving a finished descriptor for AesReplyCompleted
+static void AesRunSoftware(AesDescriptor* descriptor, const void* input, void* output, const u32 length)
+{
+	if(descriptor->Ioctl == COPY)
+		memmove(output, input, length);
+	else
+	{
+		if(!AesSoftwareKeyExpanded || memcmp(AesSoftwareKeyData, descriptor->Key, sizeof(AesSoftwareKeyData)) != 0)
+		{
+			SoftwareAes_ExpandKey(&AesSoftwareKey, descriptor->Key);
+			memcpy(AesSoftwareKeyData, descriptor->Key, sizeof(AesSoftwareKeyData));
+			AesSoftwareKeyExpanded = 1;
+		}
+
+		if(descriptor->Ioctl == DECRYPT)
+			SoftwareAes_DecryptCbc(&AesSoftwareKey, descriptor->IV, input, output, length / AES_BLOCK_SIZE);
+		else
+			SoftwareAes_EncryptCbc(&AesSoftwareKey, descriptor->IV, input, output, length / AES_BLOCK_SIZE);
+	}
+
+	DCFlushRange(output, length);
+	descriptor->BlocksLeft = 0;
+	descriptor->State = AesDescriptorDone;
+}
+
+//start the next command of a descriptor. called with interrupts disabled
+static void AesIssueCommand(AesDescriptor* descriptor)
+{
+	const u32 blocks = descriptor->BlocksLeft > AES_MAX_BLOCKS ? AES_MAX_BLOCKS : descriptor->BlocksLeft;
+	const u8 firstCommand = descriptor->State == AesDescriptorQueued;
+	if(firstCommand && descriptor->Ioctl != COPY)
+	{
+		if(!AesKeyLoaded || memcmp(AesLoadedKey, descriptor->Key, sizeof(AesLoadedKey)) != 0)
+		{
+			for(int i = 0; i < 4; i++)
+			{
+				write32(AES_KEY, descriptor->Key[i]);
+				AesLoadedKey[i] = descriptor->Key[i];
+			}
+			AesKeyLoaded = 1;
+		}
+
+		for(int i = 0; i < 4; i++)
+			write32(AES_IV, descriptor->IV[i]);
+	}
+
+	//the engine handles up to AES_MAX_BLOCKS per command. larger buffers are streamed through it,
+	//keeping the iv in the engine so the cbc chain continues from one command to the next
+	AESCommand command = 
+	{
+		.Fields = {
+			.Command = 1,
+			.GenerateIrq = 1,
+			.EnableDataHandling = descriptor->Ioctl != COPY,
+			.IsDecryption = descriptor->Ioctl == DECRYPT,
+			.KeepIV = !firstCommand,
+			.NumberOfBlocks = (blocks - 1) & 0xFFF
+		}
+	};
+
+	descriptor->State = AesDescriptorRunning;
+	descriptor->CommandBlocks = blocks;
+	descriptor->FirstCommand = firstCommand;
+	write32(AES_SRC, descriptor->Source);
+	write32(AES_DEST, descriptor->Destination);
+	descriptor->Source += blocks * AES_BLOCK_SIZE;
+	descriptor->Destination += blocks * AES_BLOCK_SIZE;
+	descriptor->BlocksLeft -= blocks;
+	write32(AES_CMD, command.Value);
+}
+
+//called from the aes irq. continues the running request or starts the next queued one before waking the handler thread
+void AesCommandCompleted(void)
+{
+	if(!AesEngineBusy)
+		return;
+
+	AesDescriptor* descriptor = &AesDescriptors[AesQueueRunning];
+	const AESCommand command = { .Value = read32(AES_CMD) };
+	if(command.Fields.HasError)
+	{
+		//resetting the engine also drops the key it had loaded. the first command of a request starts from the key & iv
+		//in the descriptor, so it is retried once. later commands continue a cbc chain that was only in the engine
+		write32(AES_CMD, 0);
+		AesKeyLoaded = 0;
+		if(descriptor->FirstCommand && !descriptor->Retried)
+		{
+			descriptor->Retried = 1;
+			descriptor->State = AesDescriptorQueued;
+			descriptor->Source -= descriptor->CommandBlocks * AES_BLOCK_SIZE;
+			descriptor->Destination -= descriptor->CommandBlocks * AES_BLOCK_SIZE;
+			descriptor->BlocksLeft += descriptor->CommandBlocks;
+			AesIssueCommand(descriptor);
+			return;
+		}
+
+		descriptor->State = AesDescriptorFailed;
+	}
+	else if(descriptor->BlocksLeft != 0)
+	{
+		AesIssueCommand(descriptor);
+		return;
+	}
+	else
+		descriptor->State = AesDescriptorDone;
+
+	AesQueueRunning = (AesQueueRunning + 1) % AES_QUEUE_DEPTH;
+	AesEngineBusy = AesDescriptors[AesQueueRunning].State == AesDescriptorQueued;
+	if(AesEngineBusy)
+		AesIssueCommand(&AesDescriptors[AesQueueRunning]);
+
+	if(AesWaitingForDescriptor)
+	{
+		AesWaitingForDescriptor = 0;
+		SignalInterruptThread(IRQ_AES, &MessageQueues[AesEventMessageQueueId], NULL);
+	}
+	else if(!AesCompletionSignalled)
+	{
+		//the queue can only be full of requests. the handler replies to finished requests on every message it receives,
+		//so nothing is lost, & the next completion signals again
+		AesCompletionSignalled = SignalInterruptThread(IRQ_AES, &MessageQueues[AesResourceQueueId], AES_COMPLETION_MESSAGE) == IPC_SUCCESS;
+	}
+}
+
+//the engine failed a request, also on the retry. the engine fails on buffers it can't reach before it writes anything,
+//so when that was the first command the input is still there & only this request is run on the cpu. otherwise it fails.
+//the engine is checked on kernel memory afterwards, to tell a broken engine from a bad buffer
+static void AesRequestFailed(AesDescriptor* descriptor)
+{
+	AesCheckEngineNeeded = 1;
+	if(!descriptor->FirstCommand)
+	{
+		gecko_printf("aes: engine error halfway through a request of 0x%X bytes\n", descriptor->Length);
+		return;
+	}
+
+	gecko_printf("aes: engine error on a request of 0x%X bytes at 0x%08X, running it on the cpu\n", descriptor->Length, (u32)descriptor->Input);
+	AesRunSoftware(descriptor, descriptor->Input, descriptor->Output, descriptor->Length);
+}
+
+static void AesReplyCompleted(void)
+{
+	//clear the flag before looking at the descriptors, so a request finishing after this signals us again
+	u32 irqState = DisableInterrupts();
+	AesCompletionSignalled = 0;
+	RestoreInterrupts(irqState);
+
+	if(AesDescriptors[AesQueueHead].State < AesDescriptorDone)
+		return;
+
+	AhbFlushFrom(AHB_AES);
+	AhbFlushTo(AHB_STARLET);
+	while(AesDescriptors[AesQueueHead].State >= AesDescriptorDone)
+	{
+		AesDescriptor* descriptor = &AesDescriptors[AesQueueHead];
+		IpcMessage* ipcReply = descriptor->Message;
+		s32 ret = IPC_SUCCESS;
+		if(descriptor->State == AesDescriptorFailed)
+			AesRequestFailed(descriptor);
+
+		if(ipcReply == NULL)
+		{
+			//a chunk queued by AesDecryptAndVerify, which replies itself
+			AesPipelineFailed |= descriptor->State == AesDescriptorFailed;
+			descriptor->State = AesDescriptorFree;
+			AesQueueHead = (AesQueueHead + 1) % AES_QUEUE_DEPTH;
+			continue;
+		}
+
+		if(descriptor->State == AesDescriptorFailed)
+			ret = -1;
+		else if(descriptor->Ioctl != COPY)
+		{
+			IoctlvMessageData* vectors = ipcReply->Request.Data.Ioctlv.Data;
+			if(descriptor->Ioctl == ENCRYPT)
+				memcpy(descriptor->NextIV, (u8*)vectors[2].Data + vectors[2].Length - 0x10, 0x10);
+
+			memcpy(vectors[3].Data, descriptor->NextIV, 0x10);
+			FreeOnHeap(KernelHeapId, vectors[0].Data);
+			FreeOnHeap(KernelHeapId, vectors);
+		}
+
+		descriptor->State = AesDescriptorFree;
+		AesQueueHead = (AesQueueHead + 1) % AES_QUEUE_DEPTH;
+		ResourceReply(ipcReply, ret);
+	}
+}
+
+//reply to finished requests until the next descriptor is free, or until all of them are when waitForIdle is set.
+//sleeps on the event queue while the descriptors we wait for are still in the engine
+static void AesWaitForDescriptor(const u8 waitForIdle)
+{
+	while(1)
+	{
+		AesReplyCompleted();
+
+		u32 irqState = DisableInterrupts();
+		const u32 state = AesDescriptors[waitForIdle ? AesQueueHead : AesQueueTail].State;
+		AesWaitingForDescriptor = state == AesDescriptorQueued || state == AesDescriptorRunning;
+		RestoreInterrupts(irqState);
+		if(state == AesDescriptorFree)
+			return;
+		if(state >= AesDescriptorDone)
+			continue;
+
+		u32* eventMessage;
+		s32 ret = ReceiveMessage(AesEventMessageQueueId, (void**)&eventMessage, None);
+		if(ret != IPC_SUCCESS)
+			panic("iosReceiveMessage: %d\n", ret);
+	}
+}
+
+//hand a request to the engine. requests without an ipc message are chunks of AesDecryptAndVerify
+static void AesQueueDescriptor(IpcMessage* message, const u32 ioctl, const void* input, void* output, const u32 length, const void* key, const void* iv)
+{
+	AesWaitForDescriptor(0);
+	const u32 index = AesQueueTail;
+	AesDescriptor* descriptor = &AesDescriptors[index];
+	descriptor->Message = message;
+	descriptor->Ioctl = ioctl;
+	descriptor->Input = input;
+	descriptor->Output = output;
+	descriptor->Length = length;
+	descriptor->Retried = 0;
+	descriptor->Source = VirtualToPhysical((u32)input);
+	descriptor->Destination = VirtualToPhysical((u32)output);
+	descriptor->BlocksLeft = length / AES_BLOCK_SIZE;
+	if(ioctl != COPY)
+	{
+		//lets copy over the AES key & IV
+		memcpy(descriptor->Key, key, 0x10);
+		memcpy(descriptor->IV, iv, 0x10);
+	}
+	if(ioctl == DECRYPT)
+		memcpy(descriptor->NextIV, (const u8*)input + length - 0x10, 0x10);
+
+	if(AesUseSoftware)
+	{
+		//the request is finished before we return, & nothing else would wake the handler to reply to it
+		AesQueueTail = (index + 1) % AES_QUEUE_DEPTH;
+		AesRunSoftware(descriptor, input, output, length);
+		AesReplyCompleted();
+		return;
+	}
+
+	const CacheRangeOperation operations[] = {
+		{ input, length, CacheFlush },
+		{ output, length, CacheInvalidate },
+	};
+	DCRangeOperations(operations, 2);
+	AhbFlushTo(AHB_AES);
+
+	u32 irqState = DisableInterrupts();
+	descriptor->State = AesDescriptorQueued;
+	AesQueueTail = (index + 1) % AES_QUEUE_DEPTH;
+	if(!AesEngineBusy)
+	{
+		AesEngineBusy = 1;
+		AesQueueRunning = index;
+		AesIssueCommand(descriptor);
+	}
+	RestoreInterrupts(irqState);
+}
+
+//FIPS-197 appendix C.1
+static const u8 AesCheckKey[0x10] ALIGNED(4) = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F };
+static const u8 AesCheckPlaintext[0x10] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+static const u8 AesCheckCiphertext[0x10] = { 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A };
+static u8 AesCheckBuffer[0x40] ALIGNED(0x20);
+
+//encrypts a known block from kernel memory once the queued requests are done. only when the engine gets that wrong as well
+//was it at fault, and after AES_ENGINE_MAX_FAILURES of those all requests run on the cpu
+static void AesCheckEngine(void)
+{
+	AesCheckEngineNeeded = 0;
+	AesWaitForDescriptor(1);
+	if(AesUseSoftware)
+		return;
+
+	write32(AES_CMD, 0);
+	AesKeyLoaded = 0;
+	for(int i = 0; i < 4; i++)
+		write32(AES_KEY, ((const u32*)AesCheckKey)[i]);
+	for(int i = 0; i < 4; i++)
+		write32(AES_IV, 0);
+
+	memcpy(AesCheckBuffer, AesCheckPlaintext, sizeof(AesCheckPlaintext));
+	DCFlushRange(AesCheckBuffer, sizeof(AesCheckBuffer));
+	AhbFlushTo(AHB_AES);
+
+	const AESCommand command = { .Fields = { .Command = 1, .EnableDataHandling = 1 } };
+	write32(AES_SRC, VirtualToPhysical((u32)AesCheckBuffer));
+	write32(AES_DEST, VirtualToPhysical((u32)&AesCheckBuffer[0x20]));
+	write32(AES_CMD, command.Value);
+	while(((AESCommand)read32(AES_CMD)).Fields.Command) {}
+
+	const u32 hasError = ((AESCommand)read32(AES_CMD)).Fields.HasError;
+	write32(AES_CMD, 0);
+	AhbFlushFrom(AHB_AES);
+	AhbFlushTo(AHB_STARLET);
+	DCInvalidateRange(&AesCheckBuffer[0x20], 0x20);
+	if(!hasError && memcmp(&AesCheckBuffer[0x20], AesCheckCiphertext, sizeof(AesCheckCiphertext)) == 0)
+		return;
+
+	AesEngineFailures++;
+	if(AesEngineFailures < AES_ENGINE_MAX_FAILURES)
+		gecko_printf("aes: engine failed its check\n");
+	else
+	{
+		gecko_printf("aes: engine failed its check %u times, running on the cpu from now on\n", AesEngineFailures);
+		AesUseSoftware = 1;
+	}
+}
+
+static s32 AesDispatchSha(const ShaCommandType command, IoctlvMessageData* shaVectors, const void* input, const u32 length)
+{
+	shaVectors[0].Data = (u32*)input;
+	shaVectors[0].Length = length;
+
+	u32 irqState = DisableInterrupts();
+	s32 ret = IoctlvFD_InnerWithFlag(SHA_STATIC_FILEDESC, command, 1, 2, shaVectors, NULL, NULL, 0);
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+//decrypts the input in AES_PIPELINE_CHUNK sized chunks. the sha engine hashes the plaintext of a chunk while the aes engine
+//decrypts the next one, so the content only goes through memory once before its hash is compared to the expected one
+static s32 AesDecryptAndVerify(const IoctlvMessage* ioctlvMessage)
+{
+	const u8* input = (const u8*)ioctlvMessage->Data[0].Data;
+	const void* key = ioctlvMessage->Data[1].Data;
+	u8* output = (u8*)ioctlvMessage->Data[3].Data;
+	const u32 length = ioctlvMessage->Data[0].Length;
+	u32 iv[4];
+	u32 nextIV[4];
+	ShaContext hashContext;
+	FinalShaHash hash;
+	IoctlvMessageData shaVectors[3] = 
+	{
+		{ .Data = NULL, .Length = 0 },
+		{ .Data = (u32*)&hashContext, .Length = sizeof(ShaContext) },
+		{ .Data = hash, .Length = sizeof(FinalShaHash) },
+	};
+
+	s32 ret = AesDispatchSha(InitShaState, shaVectors, NULL, 0);
+	if(ret != IPC_SUCCESS)
+		return ret;
+
+	AesPipelineFailed = 0;
+	u32 offset = 0;
+	u32 chunkLength = length < AES_PIPELINE_CHUNK ? length : AES_PIPELINE_CHUNK;
+	memcpy(iv, ioctlvMessage->Data[4].Data, 0x10);
+	memcpy(nextIV, input + chunkLength - 0x10, 0x10);
+	AesQueueDescriptor(NULL, DECRYPT, input, output, chunkLength, key, iv);
+	AesWaitForDescriptor(1);
+
+	while(!AesPipelineFailed)
+	{
+		const u32 nextOffset = offset + chunkLength;
+		const u32 nextLength = (length - nextOffset) < AES_PIPELINE_CHUNK ? (length - nextOffset) : AES_PIPELINE_CHUNK;
+		if(nextLength != 0)
+		{
+			//the iv of a chunk is the last block of ciphertext before it, which is gone once it is decrypted in place
+			memcpy(iv, nextIV, 0x10);
+			memcpy(nextIV, input + nextOffset + nextLength - 0x10, 0x10);
+			AesQueueDescriptor(NULL, DECRYPT, input + nextOffset, output + nextOffset, nextLength, key, iv);
+		}
+
+		ret = AesDispatchSha(nextLength == 0 ? FinalizeShaState : ContributeShaState, shaVectors, output + offset, chunkLength);
+		AesWaitForDescriptor(1);
+		if(ret != IPC_SUCCESS || nextLength == 0)
+			break;
+
+		offset = nextOffset;
+		chunkLength = nextLength;
+	}
+
+	if(AesPipelineFailed)
+		return -1;
+	if(ret != IPC_SUCCESS)
+		return ret;
+
+	memcpy(ioctlvMessage->Data[4].Data, nextIV, 0x10);
+	if(memcmp(hash, ioctlvMessage->Data[2].Data, sizeof(FinalShaHash)) != 0)
+		return IPC_CHECKVALUE;
+
+	return IPC_SUCCESS;
+}
 
 void AesEngineHandler(void)
 {
 	u32 eventMessageQueue[1];
-	u32 resourceManagerMessageQueue[8];
-	u32 ivBuffer[0x10] = { 0 };
+	u32 resourceManagerMessageQueue[AES_RM_QUEUE_SIZE];
 	s32 ret;
 	IpcMessage* ipcMessage;
 	IoctlvMessage* ioctlvMessage;
-	IpcMessage* ipcReply;
 
 	ret = CreateMessageQueue((void**)&eventMessageQueue, 1);
 	AesEventMessageQueueId = ret;
 	if(ret < 0)
 		panic("Unable to create AES event queue: %d\n", ret);
 
-	ret = RegisterEventHandler(IRQ_AES, AesEventMessageQueueId, 0);
-	if(ret < 0)
-		panic("Unable to register AES event handler: %d\n", ret);
-
-	ret = CreateMessageQueue((void**)&resourceManagerMessageQueue, 8);
+	ret = CreateMessageQueue((void**)&resourceManagerMessageQueue, AES_RM_QUEUE_SIZE);
 	if(ret < 0)
 		panic("Unable to create AES rm queue: %d\n", ret);
 
 	const s32 resourceMessageQueue = ret;
+	AesResourceQueueId = resourceMessageQueue;
 	ret = RegisterResourceManager(AES_DEVICE_NAME, resourceMessageQueue);
 	if(ret < 0)
 		panic("Unable to register resource manager: %d\n", ret);
-	
+
+	write32(AES_CMD, 0);
 	while(1)
 	{
 		//main loop should start here
@@ -84,10 +535,14 @@ void AesEngineHandler(void)
 		if(ret != 0)
 			goto receiveMessageError;
 
-		ipcReply = ipcMessage;
+		//the completion irq only sends a message when it finished a request, but finished requests are picked up on every message
+		AesReplyCompleted();
+		if(AesCheckEngineNeeded)
+			AesCheckEngine();
+		if(ipcMessage == AES_COMPLETION_MESSAGE)
+			continue;
+
 		ret = IPC_EINVAL;
-		IoctlvMessageData* IVVector = NULL;
-		IoctlvMessageData* sourceVector = NULL;
 		switch (ipcMessage->Request.Command)
 		{
 			default:
@@ -107,7 +562,6 @@ void AesEngineHandler(void)
 			case IOS_IOCTLV:
 				ret = IPC_EINVAL;
 				ioctlvMessage = &ipcMessage->Request.Data.Ioctlv;
-				write32(AES_CMD, 0 );
 
 				u32 ioctl = ioctlvMessage->Ioctl;
 				switch (ioctl)
@@ -119,86 +573,46 @@ void AesEngineHandler(void)
 						if(ioctlvMessage->Data[1].Length != 0x10 || ((u32)ioctlvMessage->Data[1].Data & 3) != 0 ||
 						   ioctlvMessage->Data[3].Length != 0x10 || ((u32)ioctlvMessage->Data[3].Data & 3) != 0)
 							goto sendReply;
-
-						//lets copy over the AES key & IV
-						u32* key = ioctlvMessage->Data[1].Data;
-						u32* iv = ioctlvMessage->Data[3].Data;
-						for(int i = 0; i < 4; i++) 
-						{
-							write32(AES_KEY, *key);
-							write32(AES_IV, *iv);
-							key++;
-							iv++;
-						}
-						IVVector = &ioctlvMessage->Data[3];
-						sourceVector = &ioctlvMessage->Data[0];
 						goto processAesCommand;
+					case DECRYPT_AND_VERIFY:
+						//input, key & expected hash in, output & iv out
+						if(ioctlvMessage->InputArgc != 3 || ioctlvMessage->IoArgc != 2)
+							goto sendReply;
+						if(ioctlvMessage->Data[1].Length != 0x10 || ((u32)ioctlvMessage->Data[1].Data & 3) != 0 ||
+						   ioctlvMessage->Data[2].Length != sizeof(FinalShaHash) ||
+						   ioctlvMessage->Data[4].Length != 0x10 || ((u32)ioctlvMessage->Data[4].Data & 3) != 0)
+							goto sendReply;
+						if(ioctlvMessage->Data[0].Length != ioctlvMessage->Data[3].Length || ioctlvMessage->Data[0].Length == 0 ||
+						   (ioctlvMessage->Data[0].Length & 0x0F) != 0 ||
+						   ((u32)ioctlvMessage->Data[0].Data & 0x0F) != 0 || ((u32)ioctlvMessage->Data[3].Data & 0x0F) != 0)
+							goto sendReply;
+
+						ret = AesDecryptAndVerify(ioctlvMessage);
+						goto sendReply;
 					case COPY:
 						if(ioctlvMessage->InputArgc != 1 || ioctlvMessage->IoArgc != 1)
 							goto sendReply;
 processAesCommand:
 						IoctlvMessageData* inputData = &ioctlvMessage->Data[0];
 						IoctlvMessageData* outputData = &ioctlvMessage->Data[ioctlvMessage->InputArgc];
-						if( inputData->Length != outputData->Length || ((inputData->Length - 0x10) & 0xFFFF000F) != 0 ||
+						if( inputData->Length != outputData->Length || inputData->Length == 0 || (inputData->Length & 0x0F) != 0 ||
 							((u32)inputData->Data & 0x0F) != 0 || ((u32)outputData->Data & 0x0F) != 0)
 							goto sendReply;
-						if(ioctl == DECRYPT)
-							memcpy(ivBuffer, inputData->Data + inputData->Length - 0x10, 0x10);
-						
-						write32(AES_SRC, VirtualToPhysical((u32)inputData->Data));
-						write32(AES_DEST, VirtualToPhysical((u32)outputData->Data));
-						DCFlushRange(inputData->Data, inputData->Length);
-						DCInvalidateRange(outputData->Data, outputData->Length);
-						AhbFlushTo(AHB_AES);
-						
-						AESCommand command =
-						{
-							.Fields = {
-								.Command = 1,
-								.GenerateIrq = 1,
-								.EnableDataHandling = ioctl != COPY,
-								.IsDecryption = ioctl == DECRYPT,
-								.KeepIV = 0,
-								.NumberOfBlocks = ((inputData->Length - 0x10U) >> 4) & 0xFFF
-							}
-						};
-						write32(AES_CMD, command.Value);
-						u32* irqMessage;
-						ret = ReceiveMessage(AesEventMessageQueueId, (void**)&irqMessage,0);
-						if(ret != IPC_SUCCESS)
-							goto receiveMessageError;
-
-						AhbFlushFrom(AHB_AES);
-						AhbFlushTo(AHB_STARLET);
-						command.Value = read32(AES_CMD);
-						if(command.Fields.HasError)
-						{
-							ret = -1;
-							goto sendReply;
-						}
-						
-						if(IVVector != NULL)
-						{
-							if(ioctl == ENCRYPT)
-								memcpy(ivBuffer, outputData->Data + outputData->Length - 0x10, 0x10);
-							
-							if(ioctl <= DECRYPT)
-								memcpy(IVVector->Data, ivBuffer, 0x10);
-
-							if(sourceVector != NULL)
-								FreeOnHeap(KernelHeapId, sourceVector->Data);
-							
-							FreeOnHeap(KernelHeapId, ipcReply->Request.Data.Ioctlv.Data);
-							ret = 0;
-						}
-						goto sendReply;
+
+						if(ioctl == COPY)
+							AesQueueDescriptor(ipcMessage, ioctl, inputData->Data, outputData->Data, inputData->Length, NULL, NULL);
+						else
+							AesQueueDescriptor(ipcMessage, ioctl, inputData->Data, outputData->Data, inputData->Length,
+											   ioctlvMessage->Data[1].Data, ioctlvMessage->Data[3].Data);
+						//the reply is sent once the engine is done with it
+						continue;
 					default:
 						goto sendReply;
 				}
 				break;
 		}
 sendReply:
-		ResourceReply(ipcReply, ret);
+		ResourceReply(ipcMessage, ret);
 		continue;
 receiveMessageError:
 		panic("iosReceiveMessage: %d\n", ret);
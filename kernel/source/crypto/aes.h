@@ -13,7 +13,14 @@
 
 #define AES_DEVICE_NAME "/dev/aes"
 #define AES_DEVICE_NAME_SIZE sizeof(AES_DEVICE_NAME)
+#define AES_BLOCK_SIZE 0x10
+#define AES_MAX_BLOCKS 0x1000
+#define AES_QUEUE_DEPTH 4
+#define AES_PIPELINE_CHUNK 0x10000
+//failed checks of the engine on kernel memory, before all requests move to the cpu
+#define AES_ENGINE_MAX_FAILURES 3
 
+void AesCommandCompleted(void);
 void AesEngineHandler(void);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,843 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ecc - sect233r1 signatures & shared keys
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+
+#include "crypto/ecc.h"
+#include "crypto/softwareCrypto.h"
+
+//the field arithmetic is built as arm code on starlet, thumb has no 3 register shifts or xors
+#ifdef __arm__
+#define ECC_CODE __attribute__((target("arm")))
+#else
+#define ECC_CODE
+#endif
+
+//elements of GF(2^233) are polynomials of 8 words, least significant word first
+#define ECC_WORDS			8
+#define ECC_FIELD_BITS		233
+#define ECC_ELEMENT_SIZE	0x1E
+
+//the fixed base comb splits a scalar in 5 rows of 47 bits & looks up 1 bit of every row at once
+#define ECC_COMB_WIDTH		5
+#define ECC_COMB_SPACING	((ECC_FIELD_BITS + ECC_COMB_WIDTH - 1) / ECC_COMB_WIDTH)
+#define ECC_COMB_POINTS		(1 << ECC_COMB_WIDTH)
+
+//other points are multiplied with a width 4 naf, using P, 3P, 5P & 7P
+#define ECC_WINDOW_POINTS	4
+#define ECC_NAF_DIGITS		(ECC_FIELD_BITS + 1)
+
+typedef u32 FieldElement[ECC_WORDS];
+
+typedef struct
+{
+	FieldElement X;
+	FieldElement Y;
+} AffinePoint;
+
+//lopez-dahab coordinates : x = X/Z & y = Y/Z^2. Z = 0 is the point at infinity
+typedef struct
+{
+	FieldElement X;
+	FieldElement Y;
+	FieldElement Z;
+} ProjectivePoint;
+
+//y^2 + xy = x^3 + x^2 + b
+static const FieldElement CurveB = {
+	0x7D8F90AD, 0x81FE115F, 0x20E9CE42, 0x213B333B, 0x0923BB58, 0x332C7F8C, 0x647EDE6C, 0x00000066
+};
+static const AffinePoint CurveG = {
+	{ 0x71FD558B, 0xF8F8EB73, 0x391F8B36, 0x5FEF65BC, 0x39F1BB75, 0x8313BB21, 0xC9DFCBAC, 0x000000FA },
+	{ 0x01F81052, 0x36716F7E, 0xF867A7CA, 0xBF8A0BEF, 0xE58528BE, 0x03350678, 0x6A08A419, 0x00000100 },
+};
+static const FieldElement CurveOrder = {
+	0x03CFE0D7, 0x22031D26, 0xE72F8A69, 0x0013E974, 0x00000000, 0x00000000, 0x00000000, 0x00000100
+};
+//montgomery multiplication modulo the order uses R = 2^256. R^2 mod n converts in to it, -1/n mod 2^32 reduces a word
+static const FieldElement OrderMontgomeryR2 = {
+	0xC26DD4D1, 0xCDAA1BA1, 0xE7E89545, 0x578CD5EF, 0x9138B004, 0xCDD6D0CC, 0xB044AA57, 0x0000006A
+};
+#define ORDER_MONTGOMERY_INVERSE	0xF154ED19
+
+//the tables & scratch space are kept out of the functions, the iosc stack is only 1KB.
+//the comb table is generated on first use instead of being stored, to keep it out of the image
+static u16 EccSquareTable[256];
+static u32 EccMultiplyTable[16][ECC_WORDS];
+static AffinePoint EccCombTable[ECC_COMB_POINTS];
+static AffinePoint EccWindowTable[ECC_WINDOW_POINTS];
+static s8 EccNafDigits[ECC_NAF_DIGITS];
+static FieldElement EccDoubleScratch[4];
+static FieldElement EccAddScratch[4];
+static FieldElement EccLadderScratch[6];
+static ProjectivePoint EccAccumulator;
+static ProjectivePoint EccSum;
+static AffinePoint EccSelectedPoint;
+static u8 EccTablesGenerated = 0;
+
+static inline bool IsZero(const u32* value)
+{
+	u32 bits = 0;
+	for(u32 i = 0; i < ECC_WORDS; i++)
+		bits |= value[i];
+
+	return bits == 0;
+}
+
+static inline void FieldAdd(u32* result, const u32* a, const u32* b)
+{
+	for(u32 i = 0; i < ECC_WORDS; i++)
+		result[i] = a[i] ^ b[i];
+}
+
+//swaps a & b when swap is 1, with the same memory accesses when it is 0
+static inline void FieldConditionalSwap(u32* a, u32* b, const u32 swap)
+{
+	const u32 mask = 0 - swap;
+	for(u32 i = 0; i < ECC_WORDS; i++)
+	{
+		const u32 difference = (a[i] ^ b[i]) & mask;
+		a[i] ^= difference;
+		b[i] ^= difference;
+	}
+}
+
+//folds a 16 word product back in to the field, 32 bits at a time, using x^233 = x^74 + 1
+static ECC_CODE void FieldReduce(u32* result, u32* product)
+{
+	for(u32 i = 2 * ECC_WORDS - 1; i >= ECC_WORDS; i--)
+	{
+		const u32 word = product[i];
+		product[i - 8] ^= word << 23;
+		product[i - 7] ^= word >> 9;
+		product[i - 5] ^= word << 1;
+		product[i - 4] ^= word >> 31;
+	}
+
+	const u32 word = product[7] >> 9;
+	product[0] ^= word;
+	product[2] ^= word << 10;
+	product[3] ^= word >> 22;
+	product[7] &= 0x1FF;
+	memcpy(result, product, sizeof(FieldElement));
+}
+
+//left to right comb : every 4 bit polynomial times b is looked up from a table, so a nibble of a costs 8 xors
+static ECC_CODE void FieldMultiply(u32* result, const u32* a, const u32* b)
+{
+	u32 product[2 * ECC_WORDS];
+
+	//b has at most 233 bits, so b times a polynomial of degree 3 still fits in 8 words
+	memset(EccMultiplyTable[0], 0, sizeof(FieldElement));
+	memcpy(EccMultiplyTable[1], b, sizeof(FieldElement));
+	for(u32 i = 2; i < 16; i += 2)
+	{
+		const u32* half = EccMultiplyTable[i >> 1];
+		u32* even = EccMultiplyTable[i];
+		u32* odd = EccMultiplyTable[i + 1];
+		for(u32 word = ECC_WORDS - 1; word > 0; word--)
+			even[word] = (half[word] << 1) | (half[word - 1] >> 31);
+		even[0] = half[0] << 1;
+
+		for(u32 word = 0; word < ECC_WORDS; word++)
+			odd[word] = even[word] ^ b[word];
+	}
+
+	memset(product, 0, sizeof(product));
+	for(u32 shift = 28; ; shift -= 4)
+	{
+		for(u32 i = 0; i < ECC_WORDS; i++)
+		{
+			const u32* multiple = EccMultiplyTable[(a[i] >> shift) & 0x0F];
+			u32* destination = &product[i];
+			for(u32 word = 0; word < ECC_WORDS; word++)
+				destination[word] ^= multiple[word];
+		}
+
+		if(shift == 0)
+			break;
+
+		for(u32 i = 2 * ECC_WORDS - 1; i > 0; i--)
+			product[i] = (product[i] << 4) | (product[i - 1] >> 28);
+		product[0] <<= 4;
+	}
+
+	FieldReduce(result, product);
+}
+
+//squaring is linear in GF(2^m), it only spreads the bits out with zeroes in between
+static ECC_CODE void FieldSquare(u32* result, const u32* a)
+{
+	u32 product[2 * ECC_WORDS];
+	for(u32 i = 0; i < ECC_WORDS; i++)
+	{
+		product[2 * i] = EccSquareTable[a[i] & 0xFF] | ((u32)EccSquareTable[(a[i] >> 8) & 0xFF] << 16);
+		product[2 * i + 1] = EccSquareTable[(a[i] >> 16) & 0xFF] | ((u32)EccSquareTable[a[i] >> 24] << 16);
+	}
+
+	FieldReduce(result, product);
+}
+
+//itoh-tsujii : a^-1 = a^(2^233 - 2), with a^(2^k - 1) built along the bits of 232 for k = 1, 3, 7, 14, 29, 58, 116 & 232
+static void FieldInvert(u32* result, const u32* a)
+{
+	FieldElement power;
+	FieldElement squared;
+	u32 exponent = 1;
+
+	memcpy(power, a, sizeof(FieldElement));
+	for(s32 bit = 6; bit >= 0; bit--)
+	{
+		memcpy(squared, power, sizeof(FieldElement));
+		for(u32 i = 0; i < exponent; i++)
+			FieldSquare(squared, squared);
+
+		FieldMultiply(power, squared, power);
+		exponent *= 2;
+
+		if(((ECC_FIELD_BITS - 1) >> bit) & 1)
+		{
+			FieldSquare(squared, power);
+			FieldMultiply(power, squared, a);
+			exponent++;
+		}
+	}
+
+	FieldSquare(result, power);
+}
+
+static inline void PointFromAffine(ProjectivePoint* result, const AffinePoint* point)
+{
+	memcpy(result->X, point->X, sizeof(FieldElement));
+	memcpy(result->Y, point->Y, sizeof(FieldElement));
+	memset(result->Z, 0, sizeof(FieldElement));
+	result->Z[0] = 1;
+}
+
+static void PointToAffine(AffinePoint* result, const ProjectivePoint* point)
+{
+	FieldElement inverse;
+	FieldInvert(inverse, point->Z);
+	FieldMultiply(result->X, point->X, inverse);
+	FieldSquare(inverse, inverse);
+	FieldMultiply(result->Y, point->Y, inverse);
+}
+
+//Z3 = X1^2 Z1^2, X3 = X1^4 + b Z1^4, Y3 = b Z1^4 Z3 + X3 (Z3 + Y1^2 + b Z1^4)
+static void PointDouble(ProjectivePoint* result, const ProjectivePoint* point)
+{
+	if(IsZero(point->Z))
+	{
+		memmove(result, point, sizeof(ProjectivePoint));
+		return;
+	}
+
+	u32* x = EccDoubleScratch[0];
+	u32* z = EccDoubleScratch[1];
+	u32* t1 = EccDoubleScratch[2];
+	u32* t2 = EccDoubleScratch[3];
+	FieldSquare(t1, point->Z);
+	FieldSquare(t2, point->X);
+	FieldMultiply(z, t1, t2);
+	FieldSquare(x, t2);
+	FieldSquare(t1, t1);
+	FieldMultiply(t1, t1, CurveB);
+	FieldAdd(x, x, t1);
+	FieldSquare(t2, point->Y);
+	FieldAdd(t2, t2, z);
+	FieldAdd(t2, t2, t1);
+	FieldMultiply(t2, t2, x);
+	FieldMultiply(t1, t1, z);
+	FieldAdd(result->Y, t2, t1);
+	memcpy(result->X, x, sizeof(FieldElement));
+	memcpy(result->Z, z, sizeof(FieldElement));
+}
+
+//adds an affine point to a lopez-dahab point, which saves the multiplications by Z2
+static void PointAddMixed(ProjectivePoint* result, const ProjectivePoint* point, const AffinePoint* other)
+{
+	if(IsZero(point->Z))
+	{
+		PointFromAffine(result, other);
+		return;
+	}
+
+	u32* a = EccAddScratch[0];
+	u32* b = EccAddScratch[1];
+	u32* c = EccAddScratch[2];
+	u32* t = EccAddScratch[3];
+	//A = y2 Z1^2 + Y1, B = x2 Z1 + X1
+	FieldSquare(t, point->Z);
+	FieldMultiply(a, other->Y, t);
+	FieldAdd(a, a, point->Y);
+	FieldMultiply(b, other->X, point->Z);
+	FieldAdd(b, b, point->X);
+	if(IsZero(b))
+	{
+		//same x : either the same point, or its negative
+		if(IsZero(a))
+		{
+			PointFromAffine(result, other);
+			PointDouble(result, result);
+		}
+		else
+			memset(result, 0, sizeof(ProjectivePoint));
+		return;
+	}
+
+	//C = Z1 B, D = B^2 (C + Z1^2), Z3 = C^2, E = A C
+	FieldMultiply(c, point->Z, b);
+	FieldAdd(t, t, c);
+	FieldSquare(b, b);
+	FieldMultiply(b, b, t);
+	FieldSquare(result->Z, c);
+	FieldMultiply(c, a, c);
+
+	//X3 = A^2 + D + E, F = X3 + x2 Z3, G = (x2 + y2) Z3^2, Y3 = (E + Z3) F + G
+	FieldSquare(result->X, a);
+	FieldAdd(result->X, result->X, b);
+	FieldAdd(result->X, result->X, c);
+	FieldMultiply(a, other->X, result->Z);
+	FieldAdd(a, a, result->X);
+	FieldAdd(c, c, result->Z);
+	FieldMultiply(c, c, a);
+	FieldSquare(t, result->Z);
+	FieldAdd(b, other->X, other->Y);
+	FieldMultiply(b, b, t);
+	FieldAdd(result->Y, c, b);
+}
+
+static inline u32 ScalarBit(const u32* scalar, u32 bit)
+{
+	return (scalar[bit >> 5] >> (bit & 31)) & 1;
+}
+
+static s32 ScalarCompare(const u32* a, const u32* b)
+{
+	for(s32 i = ECC_WORDS - 1; i >= 0; i--)
+	{
+		if(a[i] != b[i])
+			return a[i] > b[i] ? 1 : -1;
+	}
+
+	return 0;
+}
+
+static u32 ScalarAdd(u32* result, const u32* a, const u32* b)
+{
+	u64 carry = 0;
+	for(u32 i = 0; i < ECC_WORDS; i++)
+	{
+		carry += (u64)a[i] + b[i];
+		result[i] = (u32)carry;
+		carry >>= 32;
+	}
+
+	return (u32)carry;
+}
+
+static u32 ScalarSubtract(u32* result, const u32* a, const u32* b)
+{
+	u32 borrow = 0;
+	for(u32 i = 0; i < ECC_WORDS; i++)
+	{
+		const u64 difference = (u64)a[i] - b[i] - borrow;
+		result[i] = (u32)difference;
+		borrow = (u32)(difference >> 63);
+	}
+
+	return borrow;
+}
+
+static void ScalarShiftRight(u32* scalar)
+{
+	for(u32 i = 0; i < ECC_WORDS - 1; i++)
+		scalar[i] = (scalar[i] >> 1) | (scalar[i + 1] << 31);
+	scalar[ECC_WORDS - 1] >>= 1;
+}
+
+static inline bool ScalarIsValid(const u32* scalar)
+{
+	return !IsZero(scalar) && ScalarCompare(scalar, CurveOrder) < 0;
+}
+
+//result = select ? a : b, without branching on select
+static inline void ScalarSelect(u32* result, const u32* a, const u32* b, const u32 select)
+{
+	const u32 mask = 0 - select;
+	for(u32 i = 0; i < ECC_WORDS; i++)
+		result[i] = (a[i] & mask) | (b[i] & ~mask);
+}
+
+//the arithmetic modulo the order handles the private key & the nonce, so none of it branches on the values
+static void ScalarModAdd(u32* result, const u32* a, const u32* b)
+{
+	FieldElement sum, difference;
+	const u32 carry = ScalarAdd(sum, a, b);
+	const u32 borrow = ScalarSubtract(difference, sum, CurveOrder);
+	ScalarSelect(result, difference, sum, carry | (borrow ^ 1));
+}
+
+//a b / R modulo the order, a word of b at a time with the reduction interleaved
+static void ScalarMontgomeryMultiply(u32* result, const u32* a, const u32* b)
+{
+	u32 product[ECC_WORDS + 2];
+	memset(product, 0, sizeof(product));
+	for(u32 i = 0; i < ECC_WORDS; i++)
+	{
+		u64 carry = 0;
+		for(u32 word = 0; word < ECC_WORDS; word++)
+		{
+			carry += (u64)a[word] * b[i] + product[word];
+			product[word] = (u32)carry;
+			carry >>= 32;
+		}
+		carry += product[ECC_WORDS];
+		product[ECC_WORDS] = (u32)carry;
+		product[ECC_WORDS + 1] = (u32)(carry >> 32);
+
+		//add the multiple of the order that clears the lowest word & shift it out
+		const u32 factor = product[0] * ORDER_MONTGOMERY_INVERSE;
+		carry = ((u64)factor * CurveOrder[0] + product[0]) >> 32;
+		for(u32 word = 1; word < ECC_WORDS; word++)
+		{
+			carry += (u64)factor * CurveOrder[word] + product[word];
+			product[word - 1] = (u32)carry;
+			carry >>= 32;
+		}
+		carry += product[ECC_WORDS];
+		product[ECC_WORDS - 1] = (u32)carry;
+		product[ECC_WORDS] = product[ECC_WORDS + 1] + (u32)(carry >> 32);
+	}
+
+	//the product is below 2n
+	FieldElement difference;
+	const u32 borrow = ScalarSubtract(difference, product, CurveOrder);
+	ScalarSelect(result, difference, product, product[ECC_WORDS] | (borrow ^ 1));
+}
+
+static void ScalarModMultiply(u32* result, const u32* a, const u32* b)
+{
+	FieldElement product;
+	ScalarMontgomeryMultiply(product, a, b);
+	ScalarMontgomeryMultiply(result, product, OrderMontgomeryR2);
+}
+
+//fermat : a^-1 = a^(n - 2). the exponent is public, so only the multiplications depend on a
+static void ScalarModInvert(u32* result, const u32* a)
+{
+	FieldElement exponent, base, power;
+	const FieldElement two = { 2 };
+	ScalarSubtract(exponent, CurveOrder, two);
+	ScalarMontgomeryMultiply(base, a, OrderMontgomeryR2);
+	memcpy(power, base, sizeof(FieldElement));
+	for(s32 bit = ECC_FIELD_BITS - 2; bit >= 0; bit--)
+	{
+		ScalarMontgomeryMultiply(power, power, power);
+		if(ScalarBit(exponent, (u32)bit))
+			ScalarMontgomeryMultiply(power, power, base);
+	}
+
+	const FieldElement one = { 1 };
+	ScalarMontgomeryMultiply(result, power, one);
+}
+
+//reads every entry of the comb table & keeps the one at index, so the memory accesses don't depend on it
+static void SelectCombPoint(AffinePoint* result, const u32 index)
+{
+	u32* selected = (u32*)result;
+	memset(result, 0, sizeof(AffinePoint));
+	for(u32 i = 0; i < ECC_COMB_POINTS; i++)
+	{
+		const u32* entry = (const u32*)&EccCombTable[i];
+		const u32 mask = 0 - (((i ^ index) - 1) >> 31);
+		for(u32 word = 0; word < 2 * ECC_WORDS; word++)
+			selected[word] |= entry[word] & mask;
+	}
+}
+
+//k G with the comb table : 47 doublings & 47 additions for every scalar. a column without bits adds entry 0 & throws the
+//sum away. the accumulator starts at G instead of infinity, so the additions never take the shortcuts of PointAddMixed,
+//and 2^47 G (entry 2) is taken off again at the end
+static void PointMultiplyBase(ProjectivePoint* result, const u32* scalar)
+{
+	AffinePoint* selected = &EccSelectedPoint;
+	ProjectivePoint* sum = &EccSum;
+	PointFromAffine(result, &CurveG);
+	for(s32 column = ECC_COMB_SPACING - 1; column >= 0; column--)
+	{
+		PointDouble(result, result);
+
+		u32 index = 0;
+		for(u32 row = 0; row < ECC_COMB_WIDTH; row++)
+			index |= ScalarBit(scalar, row * ECC_COMB_SPACING + (u32)column) << row;
+
+		SelectCombPoint(selected, index);
+		PointAddMixed(sum, result, selected);
+		const u32 keep = (index + ECC_COMB_POINTS - 1) >> ECC_COMB_WIDTH;
+		ScalarSelect(result->X, sum->X, result->X, keep);
+		ScalarSelect(result->Y, sum->Y, result->Y, keep);
+		ScalarSelect(result->Z, sum->Z, result->Z, keep);
+	}
+
+	//the negative of (x, y) is (x, x + y)
+	memcpy(selected->X, EccCombTable[2].X, sizeof(FieldElement));
+	FieldAdd(selected->Y, EccCombTable[2].X, EccCombTable[2].Y);
+	PointAddMixed(result, result, selected);
+}
+
+//x of k P with the lopez-dahab montgomery ladder, which only needs x & z. every bit of the scalar costs one addition
+//& one doubling. (X1, Z1) = j P & (X2, Z2) = (j + 1) P, swapped around the step for a bit of 0 instead of branching
+static bool PointMultiplyLadder(u32* x, const AffinePoint* point, const u32* scalar)
+{
+	u32* x1 = EccLadderScratch[0];
+	u32* z1 = EccLadderScratch[1];
+	u32* x2 = EccLadderScratch[2];
+	u32* z2 = EccLadderScratch[3];
+	u32* t1 = EccLadderScratch[4];
+	u32* t2 = EccLadderScratch[5];
+
+	//infinity is (1, 0), & the formulas handle it, so the ladder always runs over all bits
+	memset(x1, 0, sizeof(FieldElement));
+	memset(z1, 0, sizeof(FieldElement));
+	memset(z2, 0, sizeof(FieldElement));
+	x1[0] = 1;
+	z2[0] = 1;
+	memcpy(x2, point->X, sizeof(FieldElement));
+	for(s32 bit = ECC_FIELD_BITS - 1; bit >= 0; bit--)
+	{
+		const u32 swap = ScalarBit(scalar, (u32)bit) ^ 1;
+		FieldConditionalSwap(x1, x2, swap);
+		FieldConditionalSwap(z1, z2, swap);
+
+		//(X1, Z1) += (X2, Z2) : Z = (X1 Z2 + X2 Z1)^2, X = x Z + X1 Z2 X2 Z1
+		FieldMultiply(t1, x1, z2);
+		FieldMultiply(t2, x2, z1);
+		FieldAdd(z1, t1, t2);
+		FieldSquare(z1, z1);
+		FieldMultiply(t1, t1, t2);
+		FieldMultiply(x1, point->X, z1);
+		FieldAdd(x1, x1, t1);
+
+		//(X2, Z2) doubled : X = X2^4 + b Z2^4, Z = X2^2 Z2^2
+		FieldSquare(x2, x2);
+		FieldSquare(z2, z2);
+		FieldMultiply(t1, x2, z2);
+		FieldSquare(x2, x2);
+		FieldSquare(z2, z2);
+		FieldMultiply(z2, z2, CurveB);
+		FieldAdd(x2, x2, z2);
+		memcpy(z2, t1, sizeof(FieldElement));
+
+		FieldConditionalSwap(x1, x2, swap);
+		FieldConditionalSwap(z1, z2, swap);
+	}
+
+	if(IsZero(z1))
+		return false;
+
+	FieldInvert(t1, z1);
+	FieldMultiply(x, x1, t1);
+	return true;
+}
+
+//k P with a width 4 naf : 233 doublings & about 47 additions, plus the odd multiples of P.
+//it branches on the digits of k, so it is only used with the public scalars of Ecc_Verify
+static void PointMultiply(ProjectivePoint* result, const AffinePoint* point, const u32* scalar)
+{
+	AffinePoint twice;
+	memcpy(&EccWindowTable[0], point, sizeof(AffinePoint));
+	PointFromAffine(result, point);
+	PointDouble(result, result);
+	PointToAffine(&twice, result);
+	for(u32 i = 1; i < ECC_WINDOW_POINTS; i++)
+	{
+		PointFromAffine(result, &EccWindowTable[i - 1]);
+		PointAddMixed(result, result, &twice);
+		PointToAffine(&EccWindowTable[i], result);
+	}
+
+	//odd digits between -7 & 7, with at least 3 zeroes after each of them
+	FieldElement remaining;
+	u32 digits = 0;
+	memcpy(remaining, scalar, sizeof(FieldElement));
+	while(!IsZero(remaining))
+	{
+		s32 digit = 0;
+		if(remaining[0] & 1)
+		{
+			digit = (s32)(remaining[0] & 0x0F);
+			remaining[0] &= ~0x0Fu;
+			if(digit >= 8)
+			{
+				digit -= 16;
+				for(u32 i = 0; i < ECC_WORDS; i++)
+				{
+					remaining[i] += i == 0 ? 0x10 : 1;
+					if(remaining[i] != 0)
+						break;
+				}
+			}
+		}
+
+		EccNafDigits[digits++] = (s8)digit;
+		ScalarShiftRight(remaining);
+	}
+
+	//the negative of (x, y) is (x, x + y)
+	memset(result, 0, sizeof(ProjectivePoint));
+	while(digits-- != 0)
+	{
+		PointDouble(result, result);
+
+		const s32 digit = EccNafDigits[digits];
+		if(digit > 0)
+			PointAddMixed(result, result, &EccWindowTable[digit >> 1]);
+		else if(digit < 0)
+		{
+			const AffinePoint* multiple = &EccWindowTable[(-digit) >> 1];
+			memcpy(twice.X, multiple->X, sizeof(FieldElement));
+			FieldAdd(twice.Y, multiple->X, multiple->Y);
+			PointAddMixed(result, result, &twice);
+		}
+	}
+}
+
+static void Ecc_GenerateTables(void)
+{
+	if(EccTablesGenerated)
+		return;
+
+	for(u32 i = 0; i < 256; i++)
+	{
+		u32 spread = 0;
+		for(u32 bit = 0; bit < 8; bit++)
+			spread |= ((i >> bit) & 1) << (2 * bit);
+		EccSquareTable[i] = (u16)spread;
+	}
+
+	//entry i holds the sum of 2^(47 row) G for every row set in i
+	ProjectivePoint point;
+	PointFromAffine(&point, &CurveG);
+	for(u32 row = 0; row < ECC_COMB_WIDTH; row++)
+	{
+		for(u32 i = 0; row != 0 && i < ECC_COMB_SPACING; i++)
+			PointDouble(&point, &point);
+		PointToAffine(&EccCombTable[1 << row], &point);
+	}
+
+	for(u32 index = 3; index < ECC_COMB_POINTS; index++)
+	{
+		u32 highest = 1;
+		while((highest << 1) <= index)
+			highest <<= 1;
+
+		if(highest == index)
+			continue;
+
+		PointFromAffine(&point, &EccCombTable[index ^ highest]);
+		PointAddMixed(&point, &point, &EccCombTable[highest]);
+		PointToAffine(&EccCombTable[index], &point);
+	}
+
+	EccTablesGenerated = 1;
+}
+
+static void LoadBytes(u32* result, const u8* data, u32 length)
+{
+	memset(result, 0, sizeof(FieldElement));
+	for(u32 i = 0; i < length; i++)
+	{
+		const u32 bit = (length - 1 - i) * 8;
+		result[bit >> 5] |= (u32)data[i] << (bit & 31);
+	}
+}
+
+static void StoreBytes(u8* data, const u32* value)
+{
+	for(u32 i = 0; i < ECC_ELEMENT_SIZE; i++)
+	{
+		const u32 bit = (ECC_ELEMENT_SIZE - 1 - i) * 8;
+		data[i] = (u8)(value[bit >> 5] >> (bit & 31));
+	}
+}
+
+static bool LoadPrivateKey(u32* result, const u8* privateKey)
+{
+	LoadBytes(result, privateKey, ECC_ELEMENT_SIZE);
+	return ScalarIsValid(result);
+}
+
+//rejects anything that isn't on the curve, & the point of order 2 which has x = 0
+static bool LoadPublicKey(AffinePoint* result, const u8* publicKey)
+{
+	LoadBytes(result->X, publicKey, ECC_ELEMENT_SIZE);
+	LoadBytes(result->Y, publicKey + ECC_ELEMENT_SIZE, ECC_ELEMENT_SIZE);
+	if((result->X[ECC_WORDS - 1] >> 9) != 0 || (result->Y[ECC_WORDS - 1] >> 9) != 0 || IsZero(result->X))
+		return false;
+
+	FieldElement left, right, t;
+	FieldSquare(left, result->Y);
+	FieldMultiply(t, result->X, result->Y);
+	FieldAdd(left, left, t);
+
+	memcpy(t, result->X, sizeof(FieldElement));
+	t[0] ^= 1;
+	FieldSquare(right, result->X);
+	FieldMultiply(right, right, t);
+	FieldAdd(right, right, CurveB);
+	return memcmp(left, right, sizeof(FieldElement)) == 0;
+}
+
+//x is below 2^233 & the order above 2^232, so one subtraction is enough
+static inline void ReduceCoordinate(u32* coordinate)
+{
+	if(ScalarCompare(coordinate, CurveOrder) >= 0)
+		ScalarSubtract(coordinate, coordinate, CurveOrder);
+}
+
+static void EccSha1(u8* digest, const void* data, u32 length)
+{
+	SoftwareSha1Context context;
+	SoftwareSha1_Init(&context);
+	SoftwareSha1_Update(&context, data, length);
+	SoftwareSha1_Finalize(&context, digest);
+}
+
+//k = sha-1(d | hash | counter | 0) | sha-1(d | hash | counter | 1), cut to 232 bits so it stays below the order
+static void DeriveNonce(u32* nonce, const u8* privateKey, const u8* hash, u8 counter)
+{
+	u8 seed[ECC_PRIVATE_KEY_SIZE + ECC_HASH_SIZE + 2];
+	u8 digest[2 * ECC_HASH_SIZE];
+	memcpy(seed, privateKey, ECC_PRIVATE_KEY_SIZE);
+	memcpy(seed + ECC_PRIVATE_KEY_SIZE, hash, ECC_HASH_SIZE);
+	seed[ECC_PRIVATE_KEY_SIZE + ECC_HASH_SIZE] = counter;
+	for(u8 i = 0; i < 2; i++)
+	{
+		seed[ECC_PRIVATE_KEY_SIZE + ECC_HASH_SIZE + 1] = i;
+		EccSha1(digest + i * ECC_HASH_SIZE, seed, sizeof(seed));
+	}
+
+	LoadBytes(nonce, digest, (ECC_FIELD_BITS - 1) / 8);
+}
+
+bool Ecc_GeneratePublicKey(const u8* privateKey, u8* publicKey)
+{
+	FieldElement scalar;
+	ProjectivePoint* point = &EccAccumulator;
+	AffinePoint affine;
+
+	Ecc_GenerateTables();
+	if(!LoadPrivateKey(scalar, privateKey))
+		return false;
+
+	PointMultiplyBase(point, scalar);
+	PointToAffine(&affine, point);
+	StoreBytes(publicKey, affine.X);
+	StoreBytes(publicKey + ECC_ELEMENT_SIZE, affine.Y);
+	return true;
+}
+
+//r = (k G).x, s = (e + r d) / k
+bool Ecc_Sign(const u8* privateKey, const u8* hash, u8* signature)
+{
+	FieldElement privateScalar, hashScalar, nonce, s;
+	ProjectivePoint* point = &EccAccumulator;
+	AffinePoint affine;
+
+	Ecc_GenerateTables();
+	if(!LoadPrivateKey(privateScalar, privateKey))
+		return false;
+
+	LoadBytes(hashScalar, hash, ECC_HASH_SIZE);
+	for(u32 counter = 0; counter < 0x100; counter++)
+	{
+		DeriveNonce(nonce, privateKey, hash, (u8)counter);
+		if(IsZero(nonce))
+			continue;
+
+		PointMultiplyBase(point, nonce);
+		PointToAffine(&affine, point);
+		ReduceCoordinate(affine.X);
+		if(IsZero(affine.X))
+			continue;
+
+		ScalarModMultiply(s, affine.X, privateScalar);
+		ScalarModAdd(s, s, hashScalar);
+		ScalarModInvert(nonce, nonce);
+		ScalarModMultiply(s, s, nonce);
+		if(IsZero(s))
+			continue;
+
+		StoreBytes(signature, affine.X);
+		StoreBytes(signature + ECC_ELEMENT_SIZE, s);
+		return true;
+	}
+
+	return false;
+}
+
+//valid if (e/s G + r/s Q).x = r
+bool Ecc_Verify(const u8* publicKey, const u8* hash, const u8* signature)
+{
+	FieldElement r, s, hashScalar;
+	ProjectivePoint* point = &EccAccumulator;
+	AffinePoint publicPoint, basePoint;
+
+	Ecc_GenerateTables();
+	if(!LoadPublicKey(&publicPoint, publicKey))
+		return false;
+
+	LoadBytes(r, signature, ECC_ELEMENT_SIZE);
+	LoadBytes(s, signature + ECC_ELEMENT_SIZE, ECC_ELEMENT_SIZE);
+	if(!ScalarIsValid(r) || !ScalarIsValid(s))
+		return false;
+
+	LoadBytes(hashScalar, hash, ECC_HASH_SIZE);
+	ScalarModInvert(s, s);
+	ScalarModMultiply(hashScalar, hashScalar, s);
+	ScalarModMultiply(s, r, s);
+
+	PointMultiplyBase(point, hashScalar);
+	const bool hasBasePoint = !IsZero(point->Z);
+	if(hasBasePoint)
+		PointToAffine(&basePoint, point);
+
+	PointMultiply(point, &publicPoint, s);
+	if(hasBasePoint)
+		PointAddMixed(point, point, &basePoint);
+
+	if(IsZero(point->Z))
+		return false;
+
+	PointToAffine(&publicPoint, point);
+	ReduceCoordinate(publicPoint.X);
+	return ScalarCompare(publicPoint.X, r) == 0;
+}
+
+bool Ecc_ComputeSharedKey(const u8* privateKey, const u8* publicKey, u8* sharedKey)
+{
+	FieldElement scalar, x;
+	AffinePoint publicPoint;
+	u8 sharedX[ECC_ELEMENT_SIZE];
+	u8 digest[ECC_HASH_SIZE];
+
+	Ecc_GenerateTables();
+	if(!LoadPrivateKey(scalar, privateKey) || !LoadPublicKey(&publicPoint, publicKey))
+		return false;
+
+	if(!PointMultiplyLadder(x, &publicPoint, scalar))
+		return false;
+
+	StoreBytes(sharedX, x);
+	EccSha1(digest, sharedX, ECC_ELEMENT_SIZE);
+	memcpy(sharedKey, digest, ECC_SHARED_KEY_SIZE);
+	return true;
+}
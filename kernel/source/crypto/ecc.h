@@ -0,0 +1,31 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	ecc - sect233r1 signatures & shared keys
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+
+//ecc.c only depends on types.h, string.h & softwareCrypto, so it can also be built for the host (see tools/eccbench.c)
+
+#define ECC_PRIVATE_KEY_SIZE	0x1E
+#define ECC_PUBLIC_KEY_SIZE		0x3C
+#define ECC_SIGNATURE_SIZE		0x3C
+#define ECC_HASH_SIZE			0x14
+#define ECC_SHARED_KEY_SIZE		0x10
+
+//all keys, hashes & signatures are big endian byte strings like in the keyring.
+//public keys are x followed by y, signatures are r followed by s.
+//the functions share their scratch space & are not reentrant, iosc only lets one caller in at a time
+bool Ecc_GeneratePublicKey(const u8* privateKey, u8* publicKey);
+//the nonce is derived from the private key & the hash, so signing doesn't need a random number generator
+bool Ecc_Sign(const u8* privateKey, const u8* hash, u8* signature);
+bool Ecc_Verify(const u8* publicKey, const u8* hash, const u8* signature);
+//the aes key ios derives from a shared point: the first 16 bytes of the sha-1 of its x coordinate
+bool Ecc_ComputeSharedKey(const u8* privateKey, const u8* publicKey, u8* sharedKey);
@@ -9,11 +9,15 @@
 # see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
 */
 
+#include <string.h>
 #include <ios/errno.h>
 #include <ios/ipc.h>
 #include <ios/keyring.h>
 
 #include "crypto/iosc.h"
+#include "crypto/ecc.h"
+#include "crypto/rsa.h"
+#include "crypto/softwareCrypto.h"
 #include "crypto/otp.h"
 #include "crypto/keyring.h"
 #include "crypto/boot2.h"
@@ -76,7 +80,7 @@ static inline s32 IOSC_CheckCurrentProcessOwnsKey(u32 keyHandle)
 	if(ret != IPC_SUCCESS)
 		return ret;
 
-	if(((1 << (CurrentThread->ProcessId & 0xff)) & ownerProcess) == 0)
+	if(!CurrentProcessIsOwner(ownerProcess))
 		return IOSC_EACCES;
 
 	return IPC_SUCCESS;
@@ -177,6 +181,58 @@ _aes_decrypt_cleanup_return:
 
 	return ret;
 }
+//decrypts the content & compares the sha1 of the plaintext to expectedHash, see AesDecryptAndVerify
+static s32 _IOSC_DecryptAndVerify(const u32 keyHandle, void* ivData, const void* inputData, const u32 dataSize, void* outputData, const void* expectedHash)
+{
+	if(((u32)inputData & 0x1F) != 0 || ((u32)outputData & 0x1F) != 0)
+		return -2016;
+
+	void* keyBlob = AllocateOnHeap(KernelHeapId, 0x10);
+	if(keyBlob == NULL)
+		return IPC_ENOMEM;
+	
+	s32 ret = 0;
+	IoctlvMessageData* messageData = (IoctlvMessageData*)AllocateOnHeap(KernelHeapId, 0x28);
+	if(messageData == NULL)
+	{
+		ret = IPC_ENOMEM;
+		goto _aes_decrypt_verify_cleanup_return;
+	}
+
+	u32 keyRingSize = 0;
+	ret = Keyring_FindKeySize(&keyRingSize, keyHandle);
+	if(ret != 0)
+		goto _aes_decrypt_verify_cleanup_return;
+
+	ret = Keyring_GetKey(keyHandle, keyBlob, keyRingSize);
+	if(ret != 0)
+	{
+		ret = IPC_INTERNALFAIL;
+		goto _aes_decrypt_verify_cleanup_return;
+	}
+
+	messageData->Data = (void*)inputData;
+	messageData->Length = dataSize;
+	messageData[1].Data = keyBlob;
+	messageData[1].Length = 0x10;
+	messageData[2].Data = (void*)expectedHash;
+	messageData[2].Length = 0x14;
+	messageData[3].Data = outputData;
+	messageData[3].Length = dataSize;
+	messageData[4].Data = ivData;
+	messageData[4].Length = 0x10;
+
+	ret = DispatchIoctlv(AES_STATIC_FILEDESC, 4, 3, 2, messageData);
+
+_aes_decrypt_verify_cleanup_return:
+	if(keyBlob)
+		FreeOnHeap(KernelHeapId, keyBlob);
+	
+	if(messageData)
+		FreeOnHeap(KernelHeapId, messageData);
+
+	return ret;
+}
 static s32 _IOSC_Encrypt(const u32 keyHandle, void* ivData, const void* inputData, const u32 dataSize, void* outputData, const s32 MessageQueueId, IpcMessage* message )
 {
 	if(((u32)inputData & 0x1F) != 0 || ((u32)outputData & 0x1F) != 0)
@@ -270,6 +326,333 @@ _hmac_generate_cleanup_return:
 }
 
 
+//ecc keys holding both halves keep the private key in front of the public key
+#define IOSC_ECC_KEY_BLOB_SIZE (ECC_PRIVATE_KEY_SIZE + ECC_PUBLIC_KEY_SIZE)
+//big enough for any public key, rsa-4096 being the largest
+#define IOSC_PUBLIC_KEY_BLOB_SIZE RSA_MAX_MODULUS_SIZE
+//the root key only exists to verify the CA certificate, which ios always signs with 65537
+#define IOSC_ROOT_KEY_EXPONENT 0x10001
+//only the kernel & es get to set the root key
+#define IOSC_ROOT_KEY_OWNERS 3
+
+//certificates start with the signature type & the signature, padded up to the signed part.
+//the signed part is the issuer, the key type, the name & the id, followed by the key
+#define IOSC_CERT_SIGNATURE_RSA4096		0x00010000
+#define IOSC_CERT_SIGNATURE_RSA2048		0x00010001
+#define IOSC_CERT_SIGNATURE_ECC			0x00010002
+#define IOSC_CERT_KEY_RSA4096			0
+#define IOSC_CERT_KEY_RSA2048			1
+#define IOSC_CERT_KEY_ECC				2
+#define IOSC_CERT_KEY_TYPE_OFFSET		0x40
+#define IOSC_CERT_BODY_HEADER_SIZE		0x88
+
+//a chain is verified every time a title, ticket or tmd is checked, but it is nearly always the same few certificates.
+//the cache remembers the sha-1 of every certificate that verified together with its signer's key,
+//so verifying one again only costs a hash & a lookup instead of an rsa exponentiation
+#define IOSC_CERT_CACHE_ENTRIES			16
+static u8 IOSC_VerifiedCertificates[IOSC_CERT_CACHE_ENTRIES][RSA_HASH_SIZE];
+static u32 IOSC_VerifiedCertificateCount = 0;
+static u32 IOSC_NextVerifiedCertificate = 0;
+
+//copies the private or public half of an ecc key to keyData, which has to be IOSC_ECC_KEY_BLOB_SIZE bytes
+static s32 IOSC_GetEccKey(const u32 keyHandle, const KeyType half, u8* keyData)
+{
+	KeyType keyType = Other;
+	KeySubtype keySubtype = UNKNOWN1;
+	Keyring_GetKeyTypes(keyHandle, &keyType, &keySubtype);
+	if(keySubtype != ECC_233 || (keyType != half && keyType != PublicAndPrivateKey))
+		return IOSC_INVALID_OBJTYPE;
+
+	u32 keySize = 0;
+	if(Keyring_FindKeySize(&keySize, keyHandle) != IPC_SUCCESS)
+		return IPC_INTERNALFAIL;
+
+	if(Keyring_GetKey(keyHandle, keyData, keySize) != IPC_SUCCESS)
+		return IPC_INTERNALFAIL;
+
+	if(keyType == PublicAndPrivateKey && half == PublicKey)
+		memmove(keyData, keyData + ECC_PRIVATE_KEY_SIZE, ECC_PUBLIC_KEY_SIZE);
+
+	return IPC_SUCCESS;
+}
+//copies the public half of a rsa or ecc key to keyData, which has to be IOSC_PUBLIC_KEY_BLOB_SIZE bytes.
+//rsa keys also return their exponent, ecc keys return 0
+static s32 IOSC_GetPublicKey(const u32 keyHandle, u8* keyData, u32* keySize, u32* exponent, KeySubtype* keySubtype)
+{
+	KeyType keyType = Other;
+	Keyring_GetKeyTypes(keyHandle, &keyType, keySubtype);
+	*exponent = 0;
+	if(*keySubtype == ECC_233)
+	{
+		*keySize = ECC_PUBLIC_KEY_SIZE;
+		return IOSC_GetEccKey(keyHandle, PublicKey, keyData);
+	}
+
+	if(keyType != PublicKey || (*keySubtype != RSA_2048 && *keySubtype != RSA_4096))
+		return IOSC_INVALID_OBJTYPE;
+
+	if(Keyring_FindKeySize(keySize, keyHandle) != IPC_SUCCESS)
+		return IPC_INTERNALFAIL;
+
+	s32 ret = Keyring_GetKey(keyHandle, keyData, *keySize);
+	if(ret != IPC_SUCCESS)
+		return ret;
+
+	if(keyHandle == RSA4096_ROOTKEY)
+	{
+		*exponent = IOSC_ROOT_KEY_EXPONENT;
+		return IPC_SUCCESS;
+	}
+
+	return Keyring_GetKeyMetadata(keyHandle, exponent);
+}
+static bool IOSC_CheckSignature(const u8* keyData, const u32 keySize, const u32 exponent, const KeySubtype keySubtype, const u8* hash, const u8* signData)
+{
+	if(keySubtype == ECC_233)
+		return Ecc_Verify(keyData, hash, signData);
+
+	return Rsa_VerifySha1(keyData, keySize, exponent, signData, hash);
+}
+static bool IOSC_IsCertificateVerified(const u8* certificateHash)
+{
+	for(u32 i = 0; i < IOSC_VerifiedCertificateCount; i++)
+	{
+		if(memcmp(IOSC_VerifiedCertificates[i], certificateHash, RSA_HASH_SIZE) == 0)
+			return true;
+	}
+
+	return false;
+}
+static void IOSC_AddVerifiedCertificate(const u8* certificateHash)
+{
+	memcpy(IOSC_VerifiedCertificates[IOSC_NextVerifiedCertificate], certificateHash, RSA_HASH_SIZE);
+	IOSC_NextVerifiedCertificate = (IOSC_NextVerifiedCertificate + 1) % IOSC_CERT_CACHE_ENTRIES;
+	if(IOSC_VerifiedCertificateCount < IOSC_CERT_CACHE_ENTRIES)
+		IOSC_VerifiedCertificateCount++;
+}
+static inline u32 IOSC_ReadBigEndian(const u8* data)
+{
+	return ((u32)data[0] << 24) | ((u32)data[1] << 16) | ((u32)data[2] << 8) | data[3];
+}
+//size of the signature type, signature & padding in front of the signed part
+static s32 IOSC_GetCertificateHeaderSize(const u32 signatureType, u32* headerSize, KeySubtype* signerSubtype)
+{
+	switch(signatureType)
+	{
+		case IOSC_CERT_SIGNATURE_RSA4096:
+			*headerSize = 0x240;
+			*signerSubtype = RSA_4096;
+			break;
+		case IOSC_CERT_SIGNATURE_RSA2048:
+			*headerSize = 0x140;
+			*signerSubtype = RSA_2048;
+			break;
+		case IOSC_CERT_SIGNATURE_ECC:
+			*headerSize = 0x80;
+			*signerSubtype = ECC_233;
+			break;
+		default:
+			return IOSC_INVALID_FORMAT;
+	}
+
+	return IPC_SUCCESS;
+}
+//size of the certificate's key, including the rsa exponent & the padding behind it
+static s32 IOSC_GetCertificateKeySize(const u32 keyType, u32* keySize, KeySubtype* keySubtype)
+{
+	switch(keyType)
+	{
+		case IOSC_CERT_KEY_RSA4096:
+			*keySize = 0x238;
+			*keySubtype = RSA_4096;
+			break;
+		case IOSC_CERT_KEY_RSA2048:
+			*keySize = 0x138;
+			*keySubtype = RSA_2048;
+			break;
+		case IOSC_CERT_KEY_ECC:
+			*keySize = 0x78;
+			*keySubtype = ECC_233;
+			break;
+		default:
+			return IOSC_INVALID_FORMAT;
+	}
+
+	return IPC_SUCCESS;
+}
+static s32 _IOSC_ImportPublicKey(const void* publicKeyData, const void* exponent, const u32 keyHandle)
+{
+	KeyType keyType = Other;
+	KeySubtype keySubtype = UNKNOWN1;
+	Keyring_GetKeyTypes(keyHandle, &keyType, &keySubtype);
+	if(keyType != PublicKey)
+		return IOSC_INVALID_OBJTYPE;
+
+	//rsa keys keep their exponent in the metadata, except for the root key
+	const bool hasExponent = keySubtype != ECC_233 && keyHandle != RSA4096_ROOTKEY;
+	if(hasExponent && exponent == NULL)
+		return IOSC_EINVAL;
+
+	u32 keySize = 0;
+	s32 ret = Keyring_FindKeySize(&keySize, keyHandle);
+	if(ret != IPC_SUCCESS)
+		return ret;
+
+	ret = Keyring_SetKey(keyHandle, publicKeyData, keySize);
+	if(ret == IPC_SUCCESS && hasExponent)
+		ret = Keyring_SetKeyMetadata(keyHandle, exponent);
+
+	return ret;
+}
+//the shared key is an aes key, made from the sha-1 of the shared point like ios does
+static s32 _IOSC_ComputeSharedKey(const u32 privateKeyHandle, const u32 publicKeyHandle, const u32 sharedKeyHandle)
+{
+	KeyType keyType = Other;
+	KeySubtype keySubtype = UNKNOWN1;
+	Keyring_GetKeyTypes(sharedKeyHandle, &keyType, &keySubtype);
+	if(keyType != PrivateKey || keySubtype != AES_128)
+		return IOSC_INVALID_OBJTYPE;
+
+	u8* keyBlob = (u8*)AllocateOnHeap(KernelHeapId, 2 * IOSC_ECC_KEY_BLOB_SIZE);
+	if(keyBlob == NULL)
+		return IPC_ENOMEM;
+
+	u8* publicKey = keyBlob + IOSC_ECC_KEY_BLOB_SIZE;
+	u8 sharedKey[ECC_SHARED_KEY_SIZE];
+	s32 ret = IOSC_GetEccKey(privateKeyHandle, PrivateKey, keyBlob);
+	if(ret != IPC_SUCCESS)
+		goto _ecc_shared_key_cleanup_return;
+
+	ret = IOSC_GetEccKey(publicKeyHandle, PublicKey, publicKey);
+	if(ret != IPC_SUCCESS)
+		goto _ecc_shared_key_cleanup_return;
+
+	if(!Ecc_ComputeSharedKey(keyBlob, publicKey, sharedKey))
+	{
+		ret = IOSC_INVALID_FORMAT;
+		goto _ecc_shared_key_cleanup_return;
+	}
+
+	ret = Keyring_SetKey(sharedKeyHandle, sharedKey, ECC_SHARED_KEY_SIZE);
+	memset(sharedKey, 0, ECC_SHARED_KEY_SIZE);
+
+_ecc_shared_key_cleanup_return:
+	memset(keyBlob, 0, 2 * IOSC_ECC_KEY_BLOB_SIZE);
+	FreeOnHeap(KernelHeapId, keyBlob);
+	return ret;
+}
+//both rsa & ecc signatures are made over a sha-1 hash
+static s32 _IOSC_VerifyPublicKeySign(const void* hash, const u32 hashSize, const u32 keyHandle, const void* signData)
+{
+	if(hashSize != RSA_HASH_SIZE)
+		return IOSC_INVALID_SIZE;
+
+	u8* keyBlob = (u8*)AllocateOnHeap(KernelHeapId, IOSC_PUBLIC_KEY_BLOB_SIZE);
+	if(keyBlob == NULL)
+		return IPC_ENOMEM;
+
+	u32 keySize = 0;
+	u32 exponent = 0;
+	KeySubtype keySubtype = UNKNOWN1;
+	s32 ret = IOSC_GetPublicKey(keyHandle, keyBlob, &keySize, &exponent, &keySubtype);
+	if(ret == IPC_SUCCESS && !IOSC_CheckSignature(keyBlob, keySize, exponent, keySubtype, hash, signData))
+		ret = IOSC_FAIL_CHECKVALUE;
+
+	memset(keyBlob, 0, IOSC_PUBLIC_KEY_BLOB_SIZE);
+	FreeOnHeap(KernelHeapId, keyBlob);
+	return ret;
+}
+//the layout was already read by the caller, while checking the certificate can be read
+static s32 _IOSC_ImportCertificate(const u8* certData, const u32 headerSize, const KeySubtype signerSubtype, const u32 certKeySize,
+	const KeySubtype certKeySubtype, const u32 signerHandle, const u32 publicKeyHandle)
+{
+	KeyType keyType = Other;
+	KeySubtype keySubtype = UNKNOWN1;
+	Keyring_GetKeyTypes(publicKeyHandle, &keyType, &keySubtype);
+	if(keyType != PublicKey || keySubtype != certKeySubtype || publicKeyHandle == RSA4096_ROOTKEY)
+		return IOSC_INVALID_OBJTYPE;
+
+	u8* signerKey = (u8*)AllocateOnHeap(KernelHeapId, IOSC_PUBLIC_KEY_BLOB_SIZE);
+	if(signerKey == NULL)
+		return IPC_ENOMEM;
+
+	const u8* body = certData + headerSize;
+	const u32 bodySize = IOSC_CERT_BODY_HEADER_SIZE + certKeySize;
+	u32 signerKeySize = 0;
+	u32 signerExponent = 0;
+	KeySubtype signerKeySubtype = UNKNOWN1;
+	u8 certificateHash[RSA_HASH_SIZE];
+	SoftwareSha1Context context;
+
+	s32 ret = IOSC_GetPublicKey(signerHandle, signerKey, &signerKeySize, &signerExponent, &signerKeySubtype);
+	if(ret != IPC_SUCCESS)
+		goto _import_certificate_cleanup_return;
+
+	if(signerKeySubtype != signerSubtype)
+	{
+		ret = IOSC_INVALID_SIGNER;
+		goto _import_certificate_cleanup_return;
+	}
+
+	//the whole certificate & the signer's key make up the cache entry, so a hit is the exact same signature checked by the exact same key
+	SoftwareSha1_Init(&context);
+	SoftwareSha1_Update(&context, signerKey, signerKeySize);
+	SoftwareSha1_Update(&context, &signerExponent, sizeof(u32));
+	SoftwareSha1_Update(&context, certData, headerSize + bodySize);
+	SoftwareSha1_Finalize(&context, certificateHash);
+
+	if(!IOSC_IsCertificateVerified(certificateHash))
+	{
+		u8 bodyHash[RSA_HASH_SIZE];
+		SoftwareSha1_Init(&context);
+		SoftwareSha1_Update(&context, body, bodySize);
+		SoftwareSha1_Finalize(&context, bodyHash);
+		if(!IOSC_CheckSignature(signerKey, signerKeySize, signerExponent, signerKeySubtype, bodyHash, certData + sizeof(u32)))
+		{
+			ret = IOSC_FAIL_CHECKVALUE;
+			goto _import_certificate_cleanup_return;
+		}
+
+		IOSC_AddVerifiedCertificate(certificateHash);
+	}
+
+	const u8* key = body + IOSC_CERT_BODY_HEADER_SIZE;
+	u32 keySize = 0;
+	ret = Keyring_FindKeySize(&keySize, publicKeyHandle);
+	if(ret != IPC_SUCCESS)
+		goto _import_certificate_cleanup_return;
+
+	ret = Keyring_SetKey(publicKeyHandle, key, keySize);
+	if(ret == IPC_SUCCESS && certKeySubtype != ECC_233)
+	{
+		const u32 exponent = IOSC_ReadBigEndian(key + keySize);
+		ret = Keyring_SetKeyMetadata(publicKeyHandle, &exponent);
+	}
+
+_import_certificate_cleanup_return:
+	memset(signerKey, 0, IOSC_PUBLIC_KEY_BLOB_SIZE);
+	FreeOnHeap(KernelHeapId, signerKey);
+	return ret;
+}
+static s32 _IOSC_GeneratePublicKeySign(const void* hash, const u32 hashSize, const u32 keyHandle, void* signData)
+{
+	if(hashSize != ECC_HASH_SIZE)
+		return IOSC_INVALID_SIZE;
+
+	u8* keyBlob = (u8*)AllocateOnHeap(KernelHeapId, IOSC_ECC_KEY_BLOB_SIZE);
+	if(keyBlob == NULL)
+		return IPC_ENOMEM;
+
+	s32 ret = IOSC_GetEccKey(keyHandle, PrivateKey, keyBlob);
+	if(ret == IPC_SUCCESS && !Ecc_Sign(keyBlob, hash, signData))
+		ret = IOSC_INVALID_FORMAT;
+
+	memset(keyBlob, 0, IOSC_ECC_KEY_BLOB_SIZE);
+	FreeOnHeap(KernelHeapId, keyBlob);
+	return ret;
+}
+
+
 static s32 IOSC_SetNewKeyKind(u32* keyHandle, KeyType type, KeySubtype subtype)
 {
 	u32 size = 0;
@@ -296,6 +679,7 @@ static s32 IOSC_DeleteKeyringEntry(u32 keyHandle)
 		return IOSC_EINVAL;
 
 	KeyringMetadata[keyHandle].IsUsed = 0;
+	Keyring_KeyChanged(keyHandle);
 	s16 keyringIndex = KeyringMetadata[keyHandle].KeyringIndex;
 	if (keyringIndex == -1)
 		return IPC_SUCCESS;
@@ -743,6 +1127,201 @@ s32 IOSC_DecryptAsync(const u32 keyHandle, void* ivData, const void* inputData,
 	return IOSC_DecryptInner(keyHandle, ivData, inputData, dataSize, outputData, messageQueueId, message);
 }
 
+s32 IOSC_DecryptAndVerify(const u32 keyHandle, void* ivData, const void* inputData, const u32 dataSize, void* outputData, const void* expectedHash)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do {
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(keyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanReadWrite(outputData, dataSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(inputData, dataSize);
+		if (ret != IPC_SUCCESS)
+			break;
+		
+		ret = IOSC_CheckCurrentProcessCanReadWrite(ivData, 0x10);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(expectedHash, 0x14);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = _IOSC_DecryptAndVerify(keyHandle, ivData, inputData, dataSize, outputData, expectedHash);
+	} while(0);
+	
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+
+s32 IOSC_ImportPublicKey(const void* publicKeyData, const void* exponent, const u32 keyHandle)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do {
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(keyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		u32 keySize = 0;
+		ret = Keyring_FindKeySize(&keySize, keyHandle);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(publicKeyData, keySize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		if (keyHandle == RSA4096_ROOTKEY && !CurrentProcessIsOwner(IOSC_ROOT_KEY_OWNERS))
+		{
+			ret = IOSC_EACCES;
+			break;
+		}
+
+		if (exponent != NULL)
+		{
+			ret = IOSC_CheckCurrentProcessCanRead(exponent, sizeof(u32));
+			if (ret != IPC_SUCCESS)
+				break;
+		}
+
+		ret = _IOSC_ImportPublicKey(publicKeyData, exponent, keyHandle);
+	} while(0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+s32 IOSC_ComputeSharedKey(const u32 privateKeyHandle, const u32 publicKeyHandle, const u32 sharedKeyHandle)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do {
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(privateKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(publicKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(sharedKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		ret = _IOSC_ComputeSharedKey(privateKeyHandle, publicKeyHandle, sharedKeyHandle);
+	} while(0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+s32 IOSC_VerifyPublicKeySign(const void* hash, const u32 hashSize, const u32 keyHandle, const void* signData)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do {
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(keyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(hash, hashSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		u32 signatureSize = 0;
+		ret = Keyring_GetSignatureSize(&signatureSize, keyHandle);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(signData, signatureSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = _IOSC_VerifyPublicKeySign(hash, hashSize, keyHandle, signData);
+	} while(0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+s32 IOSC_ImportCertificate(const void* certData, const u32 signerHandle, const u32 publicKeyHandle)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do {
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(signerHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(publicKeyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		//the size of a certificate depends on its signature & key types, which are checked as they are read
+		const u8* certificate = (const u8*)certData;
+		ret = IOSC_CheckCurrentProcessCanRead(certificate, sizeof(u32));
+		if (ret != IPC_SUCCESS)
+			break;
+
+		u32 headerSize = 0;
+		KeySubtype signerSubtype = UNKNOWN1;
+		ret = IOSC_GetCertificateHeaderSize(IOSC_ReadBigEndian(certificate), &headerSize, &signerSubtype);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(certificate, headerSize + IOSC_CERT_BODY_HEADER_SIZE);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		u32 keySize = 0;
+		KeySubtype keySubtype = UNKNOWN1;
+		ret = IOSC_GetCertificateKeySize(IOSC_ReadBigEndian(certificate + headerSize + IOSC_CERT_KEY_TYPE_OFFSET), &keySize, &keySubtype);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(certificate, headerSize + IOSC_CERT_BODY_HEADER_SIZE + keySize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = _IOSC_ImportCertificate(certificate, headerSize, signerSubtype, keySize, keySubtype, signerHandle, publicKeyHandle);
+	} while(0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+s32 IOSC_GeneratePublicKeySign(const void* hash, const u32 hashSize, const u32 keyHandle, void* signData)
+{
+	s32 ret = IPC_SUCCESS, keyRet = IPC_SUCCESS;
+	IOSC_BEGIN_SAFETY_WRAPPER(ret, keyRet);
+
+	do {
+		keyRet = IOSC_CheckCurrentProcessOwnsKey(keyHandle);
+		if (keyRet != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanRead(hash, hashSize);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = IOSC_CheckCurrentProcessCanReadWrite(signData, ECC_SIGNATURE_SIZE);
+		if (ret != IPC_SUCCESS)
+			break;
+
+		ret = _IOSC_GeneratePublicKeySign(hash, hashSize, keyHandle, signData);
+	} while(0);
+
+	IOSC_END_SAFETY_WRAPPER(ret, keyRet)
+	return ret;
+}
+
 static inline s32 IOSC_GenerateBlockMACInner(const ShaContext* context, 
 	const void *inputData, const u32 inputSize, const void *customData, const u32 customDataSize, const u32 keyHandle, const u32 hmacCommand,
 	const void *signData, const s32 messageQueueId, IpcMessage* message)
@@ -34,6 +34,12 @@ s32 IOSC_Encrypt(const u32 keyHandle, void* ivData, const void* inputData, const
 s32 IOSC_EncryptAsync(const u32 keyHandle, void* ivData, const void* inputData, const u32 dataSize, void* outputData, const s32 messageQueueId, IpcMessage* message);
 s32 IOSC_Decrypt(const u32 keyHandle, void* ivData, const void* inputData, const u32 dataSize, void* outputData);
 s32 IOSC_DecryptAsync(const u32 keyHandle, void* ivData, const void* inputData, const u32 dataSize, void* outputData, const s32 messageQueueId, IpcMessage* message);
+s32 IOSC_DecryptAndVerify(const u32 keyHandle, void* ivData, const void* inputData, const u32 dataSize, void* outputData, const void* expectedHash);
+s32 IOSC_ImportPublicKey(const void* publicKeyData, const void* exponent, const u32 keyHandle);
+s32 IOSC_ComputeSharedKey(const u32 privateKeyHandle, const u32 publicKeyHandle, const u32 sharedKeyHandle);
+s32 IOSC_VerifyPublicKeySign(const void* hash, const u32 hashSize, const u32 keyHandle, const void* signData);
+s32 IOSC_ImportCertificate(const void* certData, const u32 signerHandle, const u32 publicKeyHandle);
+s32 IOSC_GeneratePublicKeySign(const void* hash, const u32 hashSize, const u32 keyHandle, void* signData);
 s32 IOSC_GenerateBlockMACAsync(const ShaContext* context, 
 	const void *inputData, const u32 inputSize, const void *customData, const u32 customDataSize, const u32 keyHandle, const u32 hmacCommand,
 	const void *signData, const s32 messageQueueId, IpcMessage* message);
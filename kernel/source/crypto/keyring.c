@@ -20,6 +20,10 @@
 
 KeyringEntry KeyringEntries[KEYRING_TOTAL_ENTRIES];
 KeyringMetadataType KeyringMetadata[KEYRING_METADATA_TOTAL_ENTRIES];
+u32 KeyringKeyVersions[KEYRING_METADATA_TOTAL_ENTRIES];
+//the root key has no metadata or keyring entries. es sets it once & it never changes after that
+static u8 KeyringRootKey[KEYRING_ROOTKEY_SIZE];
+static u8 KeyringRootKeyIsSet = 0;
 
 static inline void Keyring_Init_WithKey(u32 index, KeyType type, KeySubtype subType, const void* key, const u32 keySize)
 {
@@ -93,6 +97,12 @@ void Keyring_ClearEntryData(u32 keyEntryHandle)
 	memset(&KeyringEntries[keyEntryHandle], 0, sizeof(KeyringEntry));
 }
 
+void Keyring_KeyChanged(u32 keyHandle)
+{
+	if (keyHandle < KEYRING_METADATA_TOTAL_ENTRIES)
+		KeyringKeyVersions[keyHandle]++;
+}
+
 s16 Keyring_GetKeyIndexFitSize(const u32 keySize)
 {
 	u32 runningKeySize = 0;
@@ -158,6 +168,7 @@ s32 Keyring_GetHandleFitSize(u32* keyHandle, const u32 keySize)
 			}
 		}
 
+		Keyring_KeyChanged(i);
 		*keyHandle = i;
 		return IPC_SUCCESS;
 	}
@@ -246,7 +257,7 @@ s32 Keyring_FindKeySize(u32 *keySize, u32 keyHandle)
 	
 	if (keyHandle == RSA4096_ROOTKEY) 
 	{
-		*keySize = 0x200;
+		*keySize = KEYRING_ROOTKEY_SIZE;
 		return IPC_SUCCESS;
 	}
 
@@ -344,14 +355,42 @@ s32 Keyring_GetKeySizeFromType(KeyType keyType, KeySubtype keySubtype, u32 *keyS
 	return IPC_SUCCESS;
 }
 
+static s32 Keyring_SetRootKey(const void *data, u32 keySize)
+{
+	if (keySize != KEYRING_ROOTKEY_SIZE)
+		return IOSC_INVALID_SIZE;
+
+	if (KeyringRootKeyIsSet)
+		return IOSC_EEXIST;
+
+	memcpy(KeyringRootKey, data, KEYRING_ROOTKEY_SIZE);
+	KeyringRootKeyIsSet = 1;
+	return IPC_SUCCESS;
+}
+static s32 Keyring_GetRootKey(void *keyPtr, u32 keySize)
+{
+	if (keySize != KEYRING_ROOTKEY_SIZE)
+		return IOSC_INVALID_SIZE;
+
+	if (!KeyringRootKeyIsSet)
+		return IOSC_ENOENT;
+
+	memcpy(keyPtr, KeyringRootKey, KEYRING_ROOTKEY_SIZE);
+	return IPC_SUCCESS;
+}
+
 s32 Keyring_SetKey(u32 keyHandle, const void *data, u32 keySize)
 {
+	if (keyHandle == RSA4096_ROOTKEY)
+		return Keyring_SetRootKey(data, keySize);
+
 	if (keyHandle >= KEYRING_METADATA_TOTAL_ENTRIES)
 		return IOSC_EINVAL;
 
 	if(!KeyringMetadata[keyHandle].IsUsed)
 		return IOSC_EINVAL;
 
+	Keyring_KeyChanged(keyHandle);
 	s32 entryIndex = KeyringMetadata[keyHandle].KeyringIndex;
 	u32 bytesCopied = 0;
 	do {
@@ -372,6 +411,9 @@ s32 Keyring_SetKey(u32 keyHandle, const void *data, u32 keySize)
 }
 s32 Keyring_GetKey(u32 keyHandle, void *keyPtr, u32 keySize)
 {
+	if (keyHandle == RSA4096_ROOTKEY)
+		return Keyring_GetRootKey(keyPtr, keySize);
+
 	if (keyHandle >= KEYRING_METADATA_TOTAL_ENTRIES)
 		return IOSC_EINVAL;
 
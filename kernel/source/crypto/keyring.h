@@ -35,6 +35,7 @@ typedef enum
 } KeySubtype;
 
 #define RSA4096_ROOTKEY 0x0FFFFFFF
+#define KEYRING_ROOTKEY_SIZE 0x200
 
 typedef struct {
 	// most significant 4 bits (u8 value >> 4)
@@ -83,10 +84,13 @@ CHECK_OFFSET(KeyringMetadataType, 0x10, KeyringIndex);
 
 extern KeyringEntry KeyringEntries[KEYRING_TOTAL_ENTRIES];
 extern KeyringMetadataType KeyringMetadata[KEYRING_METADATA_TOTAL_ENTRIES];
+//bumped every time the key behind a handle changes, so anything derived from a key can tell it went stale
+extern u32 KeyringKeyVersions[KEYRING_METADATA_TOTAL_ENTRIES];
 
 void Keyring_Init(void);
 
 void Keyring_ClearEntryData(u32 keyEntryHandle);
+void Keyring_KeyChanged(u32 keyHandle);
 s16 Keyring_GetKeyIndexFitSize(const u32 keySize);
 s32 Keyring_GetHandleFitSize(u32* keyHandle, const u32 keySize);
 
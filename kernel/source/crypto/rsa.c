@@ -0,0 +1,254 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	rsa - rsa-2048 & rsa-4096 signature verification
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+
+#include "crypto/rsa.h"
+
+//the montgomery multiplication is built as arm code on starlet, so its 32x32 multiply accumulates become umlal's
+#ifdef __arm__
+#define RSA_CODE __attribute__((target("arm")))
+#else
+#define RSA_CODE
+#endif
+
+#define RSA_MAX_WORDS		(RSA_MAX_MODULUS_SIZE / 4)
+//x, x^3, x^5 & x^7 for exponents that are worth a 3 bit window
+#define RSA_WINDOW_POINTS	4
+
+static const u8 Sha1DigestInfo[] = { 0x30, 0x21, 0x30, 0x09, 0x06, 0x05, 0x2B, 0x0E, 0x03, 0x02, 0x1A, 0x05, 0x00, 0x04, 0x14 };
+
+//numbers are RsaWords long & least significant word first.
+//they are kept out of the functions, a rsa-4096 number alone would take half of the iosc stack
+static u32 RsaWords;
+static u32 RsaInverse;
+static u32 RsaModulus[RSA_MAX_WORDS];
+static u32 RsaSquaredRadix[RSA_MAX_WORDS];
+static u32 RsaBase[RSA_MAX_WORDS];
+static u32 RsaAccumulator[RSA_MAX_WORDS];
+static u32 RsaProduct[RSA_MAX_WORDS + 1];
+static u32 RsaWindowTable[RSA_WINDOW_POINTS][RSA_MAX_WORDS];
+static u8 RsaMessage[RSA_MAX_MODULUS_SIZE];
+
+static s32 Compare(const u32* a, const u32* b)
+{
+	for(s32 i = (s32)RsaWords - 1; i >= 0; i--)
+	{
+		if(a[i] != b[i])
+			return a[i] > b[i] ? 1 : -1;
+	}
+
+	return 0;
+}
+
+static void SubtractModulus(u32* value)
+{
+	u32 borrow = 0;
+	for(u32 i = 0; i < RsaWords; i++)
+	{
+		const u64 difference = (u64)value[i] - RsaModulus[i] - borrow;
+		value[i] = (u32)difference;
+		borrow = (u32)(difference >> 63);
+	}
+}
+
+//result = a b / R mod N, with R = 2^(32 words). the multiplication & the reduction are interleaved word by word,
+//so every step of the inner loop is 2 multiply accumulates & there is no double length product
+static RSA_CODE void MontgomeryMultiply(u32* result, const u32* a, const u32* b)
+{
+	const u32 words = RsaWords;
+	u32* product = RsaProduct;
+	memset(product, 0, (words + 1) * sizeof(u32));
+
+	for(u32 i = 0; i < words; i++)
+	{
+		const u32 multiplier = b[i];
+		u64 sum = (u64)a[0] * multiplier + product[0];
+		//picked so the lowest word becomes 0 & can be shifted out
+		const u32 quotient = (u32)sum * RsaInverse;
+		u64 reduction = (u64)quotient * RsaModulus[0] + (u32)sum;
+		u32 carry = (u32)(sum >> 32);
+		u32 reductionCarry = (u32)(reduction >> 32);
+
+		for(u32 j = 1; j < words; j++)
+		{
+			sum = (u64)a[j] * multiplier + product[j] + carry;
+			carry = (u32)(sum >> 32);
+			reduction = (u64)quotient * RsaModulus[j] + (u32)sum + reductionCarry;
+			reductionCarry = (u32)(reduction >> 32);
+			product[j - 1] = (u32)reduction;
+		}
+
+		sum = (u64)product[words] + carry + reductionCarry;
+		product[words - 1] = (u32)sum;
+		product[words] = (u32)(sum >> 32);
+	}
+
+	//the product stays below 2N, so one subtraction is enough
+	if(product[words] != 0 || Compare(product, RsaModulus) >= 0)
+		SubtractModulus(product);
+
+	memcpy(result, product, words * sizeof(u32));
+}
+
+//R^2 mod N : doubling the top bit of N up to R 2^words, followed by 5 montgomery squarings
+//which each double the power of 2, ending at R 2^(32 words) = R^2
+static void ComputeSquaredRadix(void)
+{
+	u32* value = RsaSquaredRadix;
+	u32 topWord = RsaWords - 1;
+	while(RsaModulus[topWord] == 0)
+		topWord--;
+
+	u32 topBit = 31;
+	while(((RsaModulus[topWord] >> topBit) & 1) == 0)
+		topBit--;
+
+	memset(value, 0, RsaWords * sizeof(u32));
+	value[topWord] = 1u << topBit;
+
+	const u32 doublings = 32 * RsaWords - (32 * topWord + topBit) + RsaWords;
+	for(u32 i = 0; i < doublings; i++)
+	{
+		const u32 overflow = value[RsaWords - 1] >> 31;
+		for(u32 word = RsaWords - 1; word > 0; word--)
+			value[word] = (value[word] << 1) | (value[word - 1] >> 31);
+		value[0] <<= 1;
+
+		if(overflow || Compare(value, RsaModulus) >= 0)
+			SubtractModulus(value);
+	}
+
+	for(u32 i = 0; i < 5; i++)
+		MontgomeryMultiply(value, value, value);
+}
+
+//left to right sliding window. 65537 only has 2 bits set, so it takes the plain square & multiply path :
+//16 squarings & 1 multiplication, without spending anything on a table
+static void ModularExponent(u32* result, const u32* base, u32 exponent)
+{
+	u32 bits = 0;
+	u32 setBits = 0;
+	for(u32 remaining = exponent; remaining != 0; remaining >>= 1)
+	{
+		bits++;
+		setBits += remaining & 1;
+	}
+
+	const s32 width = setBits > 6 ? 3 : 1;
+	MontgomeryMultiply(RsaWindowTable[0], base, RsaSquaredRadix);
+	if(width > 1)
+	{
+		MontgomeryMultiply(RsaAccumulator, RsaWindowTable[0], RsaWindowTable[0]);
+		for(u32 i = 1; i < RSA_WINDOW_POINTS; i++)
+			MontgomeryMultiply(RsaWindowTable[i], RsaWindowTable[i - 1], RsaAccumulator);
+	}
+
+	//R^2 isn't needed anymore, so it holds the 1 used to leave the montgomery domain
+	memset(RsaSquaredRadix, 0, RsaWords * sizeof(u32));
+	RsaSquaredRadix[0] = 1;
+
+	//the exponent isn't 0, so the top bit starts the accumulator off with a window
+	bool started = false;
+	for(s32 bit = (s32)bits - 1; bit >= 0; )
+	{
+		if(((exponent >> bit) & 1) == 0)
+		{
+			MontgomeryMultiply(RsaAccumulator, RsaAccumulator, RsaAccumulator);
+			bit--;
+			continue;
+		}
+
+		//the window runs from this bit down to the lowest set bit within reach
+		s32 low = bit - width + 1;
+		if(low < 0)
+			low = 0;
+		while(((exponent >> low) & 1) == 0)
+			low++;
+
+		const u32 value = (exponent >> low) & ((2u << (bit - low)) - 1);
+		if(started)
+		{
+			for(s32 i = low; i <= bit; i++)
+				MontgomeryMultiply(RsaAccumulator, RsaAccumulator, RsaAccumulator);
+			MontgomeryMultiply(RsaAccumulator, RsaAccumulator, RsaWindowTable[value >> 1]);
+		}
+		else
+			memcpy(RsaAccumulator, RsaWindowTable[value >> 1], RsaWords * sizeof(u32));
+
+		started = true;
+		bit = low - 1;
+	}
+
+	MontgomeryMultiply(result, RsaAccumulator, RsaSquaredRadix);
+}
+
+static void LoadBytes(u32* result, const u8* data, u32 length)
+{
+	for(u32 i = 0; i < length / 4; i++)
+	{
+		const u8* word = &data[length - 4 * (i + 1)];
+		result[i] = ((u32)word[0] << 24) | ((u32)word[1] << 16) | ((u32)word[2] << 8) | word[3];
+	}
+}
+
+static void StoreBytes(u8* data, const u32* value, u32 length)
+{
+	for(u32 i = 0; i < length / 4; i++)
+	{
+		u8* word = &data[length - 4 * (i + 1)];
+		word[0] = (u8)(value[i] >> 24);
+		word[1] = (u8)(value[i] >> 16);
+		word[2] = (u8)(value[i] >> 8);
+		word[3] = (u8)value[i];
+	}
+}
+
+bool Rsa_VerifySha1(const u8* modulus, u32 modulusSize, u32 exponent, const u8* signature, const u8* hash)
+{
+	//the message has to fit 00 01, 8 bytes of ff padding, 00, the digest info & the hash
+	if((modulusSize & 3) != 0 || modulusSize > RSA_MAX_MODULUS_SIZE
+		|| modulusSize < 11 + sizeof(Sha1DigestInfo) + RSA_HASH_SIZE)
+		return false;
+
+	//public exponents are odd, which also keeps 0 out of ModularExponent
+	if((exponent & 1) == 0)
+		return false;
+
+	RsaWords = modulusSize / 4;
+	LoadBytes(RsaModulus, modulus, modulusSize);
+	LoadBytes(RsaBase, signature, modulusSize);
+	if((RsaModulus[0] & 1) == 0 || Compare(RsaBase, RsaModulus) >= 0)
+		return false;
+
+	//-N^-1 mod 2^32 with newton's iteration, an odd number is its own inverse modulo 8 & every step doubles the correct bits
+	u32 inverse = RsaModulus[0];
+	for(u32 i = 0; i < 4; i++)
+		inverse *= 2 - RsaModulus[0] * inverse;
+	RsaInverse = 0 - inverse;
+
+	ComputeSquaredRadix();
+	ModularExponent(RsaBase, RsaBase, exponent);
+	StoreBytes(RsaMessage, RsaBase, modulusSize);
+
+	const u32 hashOffset = modulusSize - RSA_HASH_SIZE;
+	const u32 digestInfoOffset = hashOffset - sizeof(Sha1DigestInfo);
+	if(RsaMessage[0] != 0x00 || RsaMessage[1] != 0x01 || RsaMessage[digestInfoOffset - 1] != 0x00)
+		return false;
+
+	for(u32 i = 2; i < digestInfoOffset - 1; i++)
+	{
+		if(RsaMessage[i] != 0xFF)
+			return false;
+	}
+
+	return memcmp(&RsaMessage[digestInfoOffset], Sha1DigestInfo, sizeof(Sha1DigestInfo)) == 0
+		&& memcmp(&RsaMessage[hashOffset], hash, RSA_HASH_SIZE) == 0;
+}
@@ -0,0 +1,21 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	rsa - rsa-2048 & rsa-4096 signature verification
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+
+//rsa.c only depends on types.h & string.h, so it can also be built for the host
+#define RSA_MAX_MODULUS_SIZE	0x200
+#define RSA_HASH_SIZE			0x14
+
+//checks a pkcs#1 v1.5 signature of a sha-1 hash. the modulus & signature are big endian & modulusSize bytes long.
+//like ecc.c, the scratch space is shared & iosc only lets one caller in at a time
+bool Rsa_VerifySha1(const u8* modulus, u32 modulusSize, u32 exponent, const u8* signature, const u8* hash);
@@ -12,10 +12,12 @@
 #include <string.h>
 #include <ios/processor.h>
 #include <ios/errno.h>
+#include <ios/gecko.h>
 
 #include "crypto/sha.h"
 #include "crypto/hmac.h"
 #include "crypto/keyring.h"
+#include "crypto/softwareCrypto.h"
 #include "panic.h"
 #include "memory/memory.h"
 #include "memory/heaps.h"
@@ -29,6 +31,15 @@
 
 #ifndef MIOS
 
+typedef struct
+{
+	u32 KeyHandle;
+	u32 KeyVersion;
+	u32 IsValid;
+	u32 InnerState[SHA_NUM_WORDS];
+	u32 OuterState[SHA_NUM_WORDS];
+} HmacMidstates;
+
 typedef union {
 	struct {
 		u32 Execute : 1;
@@ -42,16 +53,199 @@ typedef union {
 
 static const u32 Sha1InitialState[SHA_NUM_WORDS] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
 static u8 LastBlockBuffer[(SHA_BLOCK_SIZE * 2)] ALIGNED(SHA_BLOCK_SIZE) = { 0x00 };
+static u8 BounceBuffer[SHA_BOUNCE_BLOCKS * SHA_BLOCK_SIZE] ALIGNED(SHA_BLOCK_SIZE) = { 0x00 };
+static u8 VerifyPaddingBuffer[SHA_VERIFY_BATCH * SHA_BLOCK_SIZE * 2] ALIGNED(SHA_BLOCK_SIZE) = { 0x00 };
 static FinalShaHash HmacBufferFinal = { 0x00 };
 static u8 HmacKeyPrePad[SHA_BLOCK_SIZE] = { 0x00 };
 static u8 HmacKeyPostPad[SHA_BLOCK_SIZE] = { 0x00 };
 static s32 ShaEventMessageQueueId = 0;
+static HmacMidstates HmacMidstateCache[HMAC_MIDSTATE_CACHE_SIZE];
+static u32 NextHmacMidstate = 0;
+
+//set when all hashing runs on the cpu, either because of SOFTWARE_CRYPTO or because the engine kept failing
+static u8 ShaUseSoftware = SOFTWARE_CRYPTO_DEFAULT;
+//set when the current request runs on the cpu, because the engine failed it
+static u8 ShaRequestOnCpu = SOFTWARE_CRYPTO_DEFAULT;
+//errors of the engine on BounceBuffer, which it can always read
+static u32 ShaEngineFailures = 0;
+//stands in for the SHA_H registers
+static u32 SoftwareShaStates[SHA_NUM_WORDS];
+//the command the engine is running & the states it started from, which an engine error loses
+static const void* ShaCommandInput = NULL;
+static u32 ShaCommandBlocks = 0;
+static u32 ShaCommandStates[SHA_NUM_WORDS];
+
+//every request starts out on the engine, unless it failed too often
+static void ResetShaEngine(void)
+{
+	ShaRequestOnCpu = ShaUseSoftware;
+	if(!ShaUseSoftware)
+		write32(SHA_CMD, 0);
+}
 
-static s32 GenerateSha(ShaContext* hashContext, const void* input, const u32 inputSize, const ShaCommandType command, FinalShaHash finalHashBuffer)
+static void SetShaStates(const u32* states)
+{
+	if(ShaRequestOnCpu)
+	{
+		memcpy(SoftwareShaStates, states, sizeof(SoftwareShaStates));
+		return;
+	}
+
+	for(s8 i = 0; i < SHA_NUM_WORDS; i++)
+		write32((u32)(SHA_H0 + (i*4)), states[i]);
+}
+
+static void GetShaStates(u32* states)
+{
+	if(ShaRequestOnCpu)
+	{
+		memcpy(states, SoftwareShaStates, sizeof(SoftwareShaStates));
+		return;
+	}
+
+	for(s8 i = 0; i < SHA_NUM_WORDS; i++)
+		states[i] = read32((u32)(SHA_H0 + (i * 4)));
+}
+
+static void IssueShaCommand(const void* input, const u32 numberOfBlocks, const u8 generateIrq)
+{
+	write32(SHA_SRC, VirtualToPhysical((u32)input));
+	ShaControl control = {
+		.Fields = {
+			.Execute = 1,
+			.GenerateIrq = generateIrq != 0,
+			.NumberOfBlocks = (numberOfBlocks - 1) & 0x3FF
+		}
+	};
+
+	write32(SHA_CMD, control.Value);
+}
+
+//spins until the engine is done with a command started without an irq & returns whether it reported an error
+static u32 ShaCommandHasError(void)
+{
+	while (((ShaControl)read32(SHA_CMD)).Fields.Execute == 1) {}
+	return ((ShaControl)read32(SHA_CMD)).Fields.HasError;
+}
+
+//retries the command that failed from the states it started with. the retry runs from BounceBuffer, so an error on it
+//is the engine's fault & not that of the request's buffer. the request is then finished on the cpu, and after
+//SHA_ENGINE_MAX_FAILURES of those all requests are
+static s32 ShaEngineFailed(void)
+{
+	const u8* input = ShaCommandInput;
+	u32 numberOfBlocks = ShaCommandBlocks;
+	u32 hasError = 0;
+	gecko_printf("sha: engine error on %u blocks at 0x%08X, retrying\n", ShaCommandBlocks, (u32)ShaCommandInput);
+
+	write32(SHA_CMD, 0);
+	SetShaStates(ShaCommandStates);
+	while(numberOfBlocks != 0 && !hasError)
+	{
+		const u32 blocks = numberOfBlocks > SHA_BOUNCE_BLOCKS ? SHA_BOUNCE_BLOCKS : numberOfBlocks;
+		const u8* retryInput = input;
+		if(input < BounceBuffer || input >= BounceBuffer + sizeof(BounceBuffer))
+		{
+			memcpy(BounceBuffer, input, blocks * SHA_BLOCK_SIZE);
+			DCFlushRange(BounceBuffer, blocks * SHA_BLOCK_SIZE);
+			AhbFlushTo(AHB_SHA1);
+			retryInput = BounceBuffer;
+		}
+
+		IssueShaCommand(retryInput, blocks, 0);
+		hasError = ShaCommandHasError();
+		input += blocks * SHA_BLOCK_SIZE;
+		numberOfBlocks -= blocks;
+	}
+
+	if(!hasError)
+		return IPC_SUCCESS;
+
+	write32(SHA_CMD, 0);
+	ShaEngineFailures++;
+	ShaRequestOnCpu = 1;
+	memcpy(SoftwareShaStates, ShaCommandStates, sizeof(SoftwareShaStates));
+	SoftwareSha1_HashBlocks(SoftwareShaStates, ShaCommandInput, ShaCommandBlocks);
+	if(ShaEngineFailures < SHA_ENGINE_MAX_FAILURES)
+		gecko_printf("sha: engine error on the retry, finishing the request on the cpu\n");
+	else if(!ShaUseSoftware)
+	{
+		gecko_printf("sha: engine failed %u times, hashing on the cpu from now on\n", ShaEngineFailures);
+		ShaUseSoftware = 1;
+	}
+
+	return IPC_SUCCESS;
+}
+
+//in software the blocks are hashed right away, so waiting on the engine afterwards always succeeds
+static void StartShaEngine(const void* input, const u32 numberOfBlocks, const u8 generateIrq)
+{
+	if(ShaRequestOnCpu)
+	{
+		SoftwareSha1_HashBlocks(SoftwareShaStates, input, numberOfBlocks);
+		return;
+	}
+
+	ShaCommandInput = input;
+	ShaCommandBlocks = numberOfBlocks;
+	GetShaStates(ShaCommandStates);
+	IssueShaCommand(input, numberOfBlocks, generateIrq);
+}
+
+static s32 WaitShaEngine(void)
+{
+	if(ShaRequestOnCpu)
+		return IPC_SUCCESS;
+
+	void* message;
+	s32 ret = ReceiveMessage(ShaEventMessageQueueId, &message, None);
+	if(ret != IPC_SUCCESS)
+		panic("iosReceiveMessage: %d\n", ret);
+
+	ShaControl control = { .Value = read32(SHA_CMD) };
+	if(control.Fields.HasError != 0)
+		return ShaEngineFailed();
+
+	return IPC_SUCCESS;
+}
+
+//for commands started without an irq, which are only 1 or 2 blocks
+static s32 PollShaEngine(void)
+{
+	if(ShaRequestOnCpu)
+		return IPC_SUCCESS;
+
+	if (ShaCommandHasError())
+		return ShaEngineFailed();
+
+	return IPC_SUCCESS;
+}
+
+//the engine handles up to SHA_MAX_BLOCKS per command. larger inputs are fed to it in back to back commands,
+//which keeps the hash state in the SHA_H registers in between
+static s32 RunShaEngine(const void* input, u32 numberOfBlocks)
+{
+	const u8* data = input;
+	while(numberOfBlocks != 0)
+	{
+		const u32 blocks = numberOfBlocks > SHA_MAX_BLOCKS ? SHA_MAX_BLOCKS : numberOfBlocks;
+		StartShaEngine(data, blocks, 1);
+		s32 ret = WaitShaEngine();
+		if(ret != IPC_SUCCESS)
+			return ret;
+
+		data += blocks * SHA_BLOCK_SIZE;
+		numberOfBlocks -= blocks;
+	}
+
+	return IPC_SUCCESS;
+}
+
+//hashes the input on the engine, or on the cpu if the engine already failed the current request
+static s32 GenerateSha_Inner(ShaContext* hashContext, const void* input, const u32 inputSize, const ShaCommandType command, FinalShaHash finalHashBuffer)
 {
 	u32 numberOfBlocks = 0;
 	s32 ret = IPC_EINVAL;
-	write32(SHA_CMD, 0);
 
 	//chainingMode 0 == reset. so we set the internal hash states to the initial state
 	if(command == InitShaState)
@@ -69,37 +263,16 @@ static s32 GenerateSha(ShaContext* hashContext, const void* input, const u32 inp
 	//happens with all commands
 	if(flooredDataSize != 0)
 	{
-		//check the requested blocks to be processed
-		numberOfBlocks = (flooredDataSize / 64) -1;
-		if(numberOfBlocks >= 1024)
-			return IOSC_INVALID_SIZE;
-
 		//if this isn't the last block contributed, make sure the input data is a whole multiple of blocks large
 		if ((command != FinalizeShaState) && ((inputSize & (SHA_BLOCK_SIZE-1)) != 0x0))
 			return IOSC_INVALID_SIZE;
 
 		//copy over the states from the context to the registers
-		for(s8 i = 0; i < SHA_NUM_WORDS; i++)
-			write32((u32)(SHA_H0 + (i*4)), hashContext->ShaStates[i]);
-		
-		write32(SHA_SRC, VirtualToPhysical((u32)input));
-		ShaControl control = {
-			.Fields = {
-				.Execute = 1,
-				.GenerateIrq = 1,
-				.NumberOfBlocks = numberOfBlocks & 0x3FF
-			}
-		};
+		SetShaStates(hashContext->ShaStates);
 
-		write32(SHA_CMD, control.Value);
-		void* message;
-		ret = ReceiveMessage(ShaEventMessageQueueId, &message, None);
+		ret = RunShaEngine(input, flooredDataSize / SHA_BLOCK_SIZE);
 		if(ret != IPC_SUCCESS)
-			panic("iosReceiveMessage: %d\n", ret);
-
-		control.Value = read32(SHA_CMD);
-		if(control.Fields.HasError != 0)
-			return IPC_EACCES;
+			return ret;
 	}
 
 	//FinalizeShaState : Last block contributed to hash
@@ -127,29 +300,17 @@ static s32 GenerateSha(ShaContext* hashContext, const void* input, const u32 inp
 		AhbFlushTo(AHB_SHA1);
 
 		//copy over the states from the context to the registers
-		if (flooredDataSize == 0) {
-			for(s8 i = 0; i < SHA_NUM_WORDS; i++) {
-				write32((u32)(SHA_H0 + (i*4)), hashContext->ShaStates[i]);
-			}
-		}
+		if (flooredDataSize == 0)
+			SetShaStates(hashContext->ShaStates);
 		
-		//set up hash engine
-		write32(SHA_SRC, VirtualToPhysical((u32)LastBlockBuffer));
-		ShaControl control = {
-			.Fields = {
-				.Execute = 1,
-				.GenerateIrq = 0,	//no irq for this one, instead the function idles until it detects the execution has halted
-				.NumberOfBlocks = (numberOfBlocks -1) & 0x3FF
-			}
-		};
-
-		//execute hash engine, and while waiting spin idly
-		write32(SHA_CMD, control.Value);
-		while (((ShaControl)read32(SHA_CMD)).Fields.Execute == 1) {}
+		//no irq for this one, instead the function idles until it detects the execution has halted
+		StartShaEngine(LastBlockBuffer, numberOfBlocks, 0);
+		ret = PollShaEngine();
+		if(ret != IPC_SUCCESS)
+			return ret;
 
 		//copy over the states from the registers to the context
-		for(s8 i = 0; i < SHA_NUM_WORDS; i++)
-			finalHashBuffer[i] = read32((u32)(SHA_H0 + (i * 4)));
+		GetShaStates(finalHashBuffer);
 		
 		ret = IPC_SUCCESS;
 	}
@@ -159,8 +320,7 @@ static s32 GenerateSha(ShaContext* hashContext, const void* input, const u32 inp
 	{
 		hashContext->Length += flooredDataSize * 8;
 		//copy over the states from the registers to the context
-		for(s8 i = 0; i < SHA_NUM_WORDS; i++)
-			hashContext->ShaStates[i] = read32((u32)(SHA_H0 + (i * 4)));
+		GetShaStates(hashContext->ShaStates);
 
 		ret = IPC_SUCCESS;
 	}
@@ -168,6 +328,95 @@ static s32 GenerateSha(ShaContext* hashContext, const void* input, const u32 inp
 	return ret;
 }
 
+static s32 GenerateSha(ShaContext* hashContext, const void* input, const u32 inputSize, const ShaCommandType command, FinalShaHash finalHashBuffer)
+{
+	ResetShaEngine();
+	return GenerateSha_Inner(hashContext, input, inputSize, command, finalHashBuffer);
+}
+
+static s32 HashBounceBuffer(const u32 length)
+{
+	if(length == 0)
+		return IPC_SUCCESS;
+
+	DCFlushRange(BounceBuffer, length);
+	AhbFlushTo(AHB_SHA1);
+	return RunShaEngine(BounceBuffer, length / SHA_BLOCK_SIZE);
+}
+
+//hashes the concatenation of the given segments, which can be of any length. word aligned whole blocks are hashed straight
+//from the segments. the blocks that span 2 segments are put together in BounceBuffer, and a segment that isn't word aligned
+//after its first block is copied into it in chunks of SHA_BOUNCE_BLOCKS, so the engine still gets more than a block per run
+static s32 GenerateShaVectors(const IoctlvMessageData* segments, const u32 numberOfSegments, FinalShaHash finalHashBuffer)
+{
+	ShaContext hashContext;
+	u32 bounceLength = 0;
+	u32 totalLength = 0;
+	s32 ret = IPC_SUCCESS;
+
+	ResetShaEngine();
+	SetShaStates(Sha1InitialState);
+
+	for(u32 segment = 0; segment < numberOfSegments; segment++)
+	{
+		const u8* data = (const u8*)segments[segment].Data;
+		u32 length = segments[segment].Length;
+		totalLength += length;
+
+		while(length != 0)
+		{
+			const u32 wordAligned = ((u32)data & 3) == 0;
+			if(wordAligned && length >= SHA_BLOCK_SIZE && (bounceLength & (SHA_BLOCK_SIZE-1)) == 0)
+			{
+				//the bounced blocks come first
+				ret = HashBounceBuffer(bounceLength);
+				if(ret != IPC_SUCCESS)
+					return ret;
+				bounceLength = 0;
+
+				const u32 wholeBlocksLength = length & (u32)(~(SHA_BLOCK_SIZE-1));
+				DCFlushRange(data, wholeBlocksLength);
+				AhbFlushTo(AHB_SHA1);
+				ret = RunShaEngine(data, wholeBlocksLength / SHA_BLOCK_SIZE);
+				if(ret != IPC_SUCCESS)
+					return ret;
+
+				data += wholeBlocksLength;
+				length -= wholeBlocksLength;
+				continue;
+			}
+
+			//aligned data only needs the current block completed before it can go to the engine itself,
+			//unaligned data is bounced for as much as fits
+			u32 copyLength = wordAligned
+				? SHA_BLOCK_SIZE - (bounceLength & (SHA_BLOCK_SIZE-1))
+				: sizeof(BounceBuffer) - bounceLength;
+			if(copyLength > length)
+				copyLength = length;
+
+			memcpy(&BounceBuffer[bounceLength], data, copyLength);
+			bounceLength += copyLength;
+			data += copyLength;
+			length -= copyLength;
+			if(bounceLength < sizeof(BounceBuffer))
+				continue;
+
+			ret = HashBounceBuffer(bounceLength);
+			if(ret != IPC_SUCCESS)
+				return ret;
+			bounceLength = 0;
+		}
+	}
+
+	//let the finalize hash the bounced blocks & pad whatever is left over, without sending a request the engine failed back to it
+	GetShaStates(hashContext.ShaStates);
+	hashContext.Length = (u64)(totalLength - bounceLength) * 8;
+
+	return GenerateSha_Inner(&hashContext, BounceBuffer, bounceLength, FinalizeShaState, finalHashBuffer);
+}
+
+//hashes all elements back to back & compares each hash while the engine works on the next element.
+//the data is flushed once and the padding of a batch of elements is built up front, so the engine only waits on us for the irq
 static s32 VerifyHashesArray(const void* hashData, u32 sizeHashElement, u32 amountHashElements, const void *hashes)
 {
 	if (amountHashElements == 0)
@@ -179,43 +428,80 @@ static s32 VerifyHashesArray(const void* hashData, u32 sizeHashElement, u32 amou
 
 	FinalShaHash outputHash;
 	const u32 inputSize = sizeHashElement & 0xffffffc0;
+	const u32 dataBlocks = inputSize / SHA_BLOCK_SIZE;
+	const u32 lastBlockLength = sizeHashElement - inputSize;
+	const u32 paddingBlocks = ((lastBlockLength + 1) < (SHA_BLOCK_SIZE - 7)) ? 1 : 2;
+	const u32 paddingSize = paddingBlocks * SHA_BLOCK_SIZE;
+	const u64 lengthInBits = (u64)sizeHashElement * 8;
 	const u8* hashDataPtr = hashData;
 	const u8* hashPtr = hashes;
-	ShaContext hashContext;
+	const u8* previousHashPtr = NULL;
 	s32 ret = IPC_SUCCESS;
 
-	for (u32 i = 0; i < amountHashElements; ++i)
+	ResetShaEngine();
+	DCFlushRange(hashData, sizeHashElement * amountHashElements);
+	AhbFlushTo(AHB_SHA1);
+
+	for (u32 batch = 0; batch < amountHashElements; batch += SHA_VERIFY_BATCH)
 	{
-		ret = GenerateSha(&hashContext, hashDataPtr, inputSize, InitShaState, outputHash);
-		if (ret == IPC_SUCCESS)
-			ret = GenerateSha(&hashContext, hashDataPtr + inputSize, sizeHashElement - inputSize, FinalizeShaState, outputHash);
+		const u32 batchSize = (amountHashElements - batch) < SHA_VERIFY_BATCH ? (amountHashElements - batch) : SHA_VERIFY_BATCH;
+		memset(VerifyPaddingBuffer, 0, batchSize * paddingSize);
+		for (u32 i = 0; i < batchSize; ++i)
+		{
+			u8* padding = &VerifyPaddingBuffer[i * paddingSize];
+			memcpy(padding, hashDataPtr + (i * sizeHashElement) + inputSize, lastBlockLength);
+			padding[lastBlockLength] = 0x80;
+			write32((u32)&padding[paddingSize-4], (u32)lengthInBits);
+			write32((u32)&padding[paddingSize-8], (u32)(lengthInBits >> 32));
+		}
+		DCFlushRange(VerifyPaddingBuffer, batchSize * paddingSize);
+		AhbFlushTo(AHB_SHA1);
 
-		if (ret < 0)
-			break;
+		for (u32 i = 0; i < batchSize; ++i)
+		{
+			SetShaStates(Sha1InitialState);
 
-		if (memcmp(outputHash, hashPtr, 0x14) != 0) {
-			ret = IPC_CHECKVALUE;
-			break;
-		}
+			if (dataBlocks != 0)
+				StartShaEngine(hashDataPtr, dataBlocks, 1);
+
+			//check the previous element while the engine is busy
+			if (previousHashPtr != NULL && memcmp(outputHash, previousHashPtr, 0x14) != 0)
+				ret = IPC_CHECKVALUE;
 
-		hashDataPtr += sizeHashElement;
-		hashPtr += sizeof(FinalShaHash);
+			if (dataBlocks != 0)
+			{
+				const s32 engineRet = WaitShaEngine();
+				if (engineRet != IPC_SUCCESS)
+					return engineRet;
+			}
+
+			if (ret != IPC_SUCCESS)
+				return ret;
+
+			//the padding is only 1 or 2 blocks, so spin instead of waiting for the irq
+			StartShaEngine(&VerifyPaddingBuffer[i * paddingSize], paddingBlocks, 0);
+			if (PollShaEngine() != IPC_SUCCESS)
+				return IPC_EACCES;
+
+			GetShaStates(outputHash);
+
+			previousHashPtr = hashPtr;
+			hashDataPtr += sizeHashElement;
+			hashPtr += sizeof(FinalShaHash);
+		}
 	}
 
-	return ret;
+	if (memcmp(outputHash, previousHashPtr, 0x14) != 0)
+		return IPC_CHECKVALUE;
+
+	return IPC_SUCCESS;
 }
 
 /*
  * After returning IPC_SUCCESS, HmacKeyPostPad is usable (inner/outer pad for the given key handle)
  */
-static s32 GenerateHmac_DerivedKeyPad(const void* signer, const u32 signerSize, const u8 padding)
+static s32 GenerateHmac_DerivedKeyPad(const u32 signerHandle, const u8 padding)
 {
-	if (signerSize != 4)
-		return IPC_EINVAL;
-
-	u32 signerHandle = 0;
-	memcpy(&signerHandle, signer, sizeof(u32));
-
 	u32 keySize = 0;
 	s32 keyResult = Keyring_FindKeySize(&keySize, signerHandle);
 	if (keyResult != IPC_SUCCESS)
@@ -238,20 +524,67 @@ static s32 GenerateHmac_DerivedKeyPad(const void* signer, const u32 signerSize,
 	return IPC_SUCCESS;
 }
 
-#define GenerateHmac_DerivedKeyPad_Inner(signer, signerSize) GenerateHmac_DerivedKeyPad(signer, signerSize, 0x36)
-#define GenerateHmac_DerivedKeyPad_Outer(signer, signerSize) GenerateHmac_DerivedKeyPad(signer, signerSize, 0x5c)
+/*
+ * Looks up the sha states after hashing the inner & outer pad of the given key handle.
+ * They only change when the key does, so they are cached instead of hashing both pads for every hmac
+ */
+static s32 GenerateHmac_GetMidstates(const void* signer, const u32 signerSize, const HmacMidstates** midstates)
+{
+	if (signerSize != 4)
+		return IPC_EINVAL;
+
+	u32 signerHandle = 0;
+	memcpy(&signerHandle, signer, sizeof(u32));
+	if (signerHandle >= KEYRING_METADATA_TOTAL_ENTRIES)
+		return IPC_EINVAL;
+
+	const u32 keyVersion = KeyringKeyVersions[signerHandle];
+	for (u32 i = 0; i < HMAC_MIDSTATE_CACHE_SIZE; ++i)
+	{
+		if (HmacMidstateCache[i].IsValid && HmacMidstateCache[i].KeyHandle == signerHandle && HmacMidstateCache[i].KeyVersion == keyVersion)
+		{
+			*midstates = &HmacMidstateCache[i];
+			return IPC_SUCCESS;
+		}
+	}
+
+	HmacMidstates* entry = &HmacMidstateCache[NextHmacMidstate];
+	NextHmacMidstate = (NextHmacMidstate + 1) % HMAC_MIDSTATE_CACHE_SIZE;
+	entry->IsValid = 0;
+
+	ShaContext padContext;
+	s32 ret = GenerateHmac_DerivedKeyPad(signerHandle, 0x36);
+	if (ret == IPC_SUCCESS)
+		ret = GenerateSha(&padContext, HmacKeyPostPad, SHA_BLOCK_SIZE, InitShaState, NULL);
+	if (ret != IPC_SUCCESS)
+		return ret;
+	memcpy(entry->InnerState, padContext.ShaStates, sizeof(entry->InnerState));
+
+	ret = GenerateHmac_DerivedKeyPad(signerHandle, 0x5c);
+	if (ret == IPC_SUCCESS)
+		ret = GenerateSha(&padContext, HmacKeyPostPad, SHA_BLOCK_SIZE, InitShaState, NULL);
+	if (ret != IPC_SUCCESS)
+		return ret;
+	memcpy(entry->OuterState, padContext.ShaStates, sizeof(entry->OuterState));
+
+	entry->KeyHandle = signerHandle;
+	entry->KeyVersion = keyVersion;
+	entry->IsValid = 1;
+	*midstates = entry;
+	return IPC_SUCCESS;
+}
 
-// perform inner hash, start appending message
+// start from the inner pad state, start appending message
 static s32 GenerateHmac_Init(ShaContext * const hashContext, const void* input, const u32 inputSize, const void* signer, const u32 signerSize)
 {
-	s32 ret = GenerateHmac_DerivedKeyPad_Inner(signer, signerSize);
+	const HmacMidstates* midstates;
+	s32 ret = GenerateHmac_GetMidstates(signer, signerSize, &midstates);
 	if (ret != IPC_SUCCESS)
 		return ret;
 
 	// inner pad
-	ret = GenerateSha(hashContext, HmacKeyPostPad, SHA_BLOCK_SIZE, InitShaState, NULL);
-	if (ret != IPC_SUCCESS)
-		return ret;
+	memcpy(hashContext->ShaStates, midstates->InnerState, sizeof(hashContext->ShaStates));
+	hashContext->Length = SHA_BLOCK_SIZE * 8;
 	
 	// start appending message
 	if (inputSize != 0)
@@ -278,11 +611,12 @@ static s32 GenerateHmac_Contribute(ShaContext * const hashContext, const void* f
 	return ret;
 }
 
-// finish the inner hash, perform outer hash, output
+// finish the inner hash, perform outer hash from the outer pad state, output
 static s32 GenerateHmac_Finalize(ShaContext * const hashContext, const void* firstInput, const u32 firstInputSize,
                                  const void* secondInput, const u32 secondInputsize, const void* signer, const u32 signerSize, u32* output)
 {
-	s32 ret = GenerateHmac_DerivedKeyPad_Outer(signer, signerSize);
+	const HmacMidstates* midstates;
+	s32 ret = GenerateHmac_GetMidstates(signer, signerSize, &midstates);
 	if (ret != IPC_SUCCESS)
 		return ret;
 	
@@ -298,9 +632,8 @@ static s32 GenerateHmac_Finalize(ShaContext * const hashContext, const void* fir
 		return ret;
 
 	// outer pad
-	ret = GenerateSha(hashContext, HmacKeyPostPad, SHA_BLOCK_SIZE, InitShaState, NULL);
-	if (ret != IPC_SUCCESS)
-		return ret;
+	memcpy(hashContext->ShaStates, midstates->OuterState, sizeof(hashContext->ShaStates));
+	hashContext->Length = SHA_BLOCK_SIZE * 8;
 
 	ret = GenerateSha(hashContext, HmacBufferFinal, /* sizeof(FinalShaHash) */ 0x14, FinalizeShaState, output);
 
@@ -382,6 +715,17 @@ void ShaEngineHandler(void)
 
 						break;
 
+					case HashShaVectors:
+						//all input vectors are hashed as one message, the hash is written to the io vector
+						if(ioctlvMessage->IoArgc != 1 || messageData[ioctlvMessage->InputArgc].Length < sizeof(FinalShaHash))
+							break;
+
+						ret = GenerateShaVectors(messageData, ioctlvMessage->InputArgc, messageData[ioctlvMessage->InputArgc].Data);
+						if(ret != IPC_SUCCESS)
+							goto sendReply;
+
+						break;
+
 					case InitHMacState:
 						ret = GenerateHmac_Init((ShaContext*)ioctlvMessage->Data[1].Data, ioctlvMessage->Data[4].Data,
 												ioctlvMessage->Data[4].Length, ioctlvMessage->Data[3].Data,
@@ -18,12 +18,19 @@
 #define SHA_DEVICE_NAME_SIZE 	sizeof(SHA_DEVICE_NAME)
 #define SHA_BLOCK_SIZE 			0x40
 #define SHA_NUM_WORDS 			5
+#define SHA_MAX_BLOCKS			0x400
+#define SHA_VERIFY_BATCH		8
+#define SHA_BOUNCE_BLOCKS		16
+//engine errors that a retry from kernel memory didn't fix, before all hashing moves to the cpu
+#define SHA_ENGINE_MAX_FAILURES	3
+#define HMAC_MIDSTATE_CACHE_SIZE	4
 
 typedef enum 
 {
 	InitShaState = 0x00,
 	ContributeShaState = 0x01,
 	FinalizeShaState = 0x02,
+	HashShaVectors = 0x06,
 	UnknownShaCommand = 0x0F
 } ShaCommandType;
 
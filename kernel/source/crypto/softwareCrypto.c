@@ -0,0 +1,371 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	softwareCrypto - aes-128-cbc & sha-1 in software
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <string.h>
+
+#include "crypto/softwareCrypto.h"
+
+//the hot loops are built as arm code on starlet, where rotating a table lookup is free thanks to the barrel shifter
+#ifdef __arm__
+#define SOFTWARE_CRYPTO_CODE __attribute__((target("arm")))
+#else
+#define SOFTWARE_CRYPTO_CODE
+#endif
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define BIG_ENDIAN_WORD(x) __builtin_bswap32(x)
+#else
+#define BIG_ENDIAN_WORD(x) (x)
+#endif
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> ((32 - (n)) & 31)))
+#define ROR32(x, n) (((x) >> (n)) | ((x) << ((32 - (n)) & 31)))
+
+//the tables are generated on first use instead of being stored, to keep them out of the image.
+//only one round table per direction is kept, the other 3 columns are rotations of it
+static u8 AesSbox[256];
+static u8 AesInverseSbox[256];
+static u32 AesEncryptTable[256];
+static u32 AesDecryptTable[256];
+static u8 AesTablesGenerated = 0;
+
+static void SoftwareAes_GenerateTables(void)
+{
+	u8 power[256];
+	u8 logarithm[256];
+
+	//powers of the generator 3 in GF(2^8)
+	u32 value = 1;
+	for(u32 i = 0; i < 256; i++)
+	{
+		power[i] = (u8)value;
+		logarithm[value] = (u8)i;
+		value ^= (value << 1) ^ ((value & 0x80) ? 0x11B : 0);
+	}
+
+	for(u32 i = 0; i < 256; i++)
+	{
+		u32 inverse = i == 0 ? 0 : power[255 - logarithm[i]];
+		u32 sbox = inverse ^ (inverse << 1) ^ (inverse << 2) ^ (inverse << 3) ^ (inverse << 4);
+		sbox = ((sbox ^ (sbox >> 8)) & 0xFF) ^ 0x63;
+		AesSbox[i] = (u8)sbox;
+		AesInverseSbox[sbox] = (u8)i;
+	}
+
+#define GF_MULTIPLY(a, b) ((a) == 0 ? 0u : (u32)power[(logarithm[a] + logarithm[b]) % 255])
+	for(u32 i = 0; i < 256; i++)
+	{
+		const u32 sbox = AesSbox[i];
+		const u32 inverse = AesInverseSbox[i];
+		AesEncryptTable[i] = (GF_MULTIPLY(sbox, 2) << 24) | (sbox << 16) | (sbox << 8) | GF_MULTIPLY(sbox, 3);
+		AesDecryptTable[i] = (GF_MULTIPLY(inverse, 0x0E) << 24) | (GF_MULTIPLY(inverse, 0x09) << 16) |
+							 (GF_MULTIPLY(inverse, 0x0D) << 8) | GF_MULTIPLY(inverse, 0x0B);
+	}
+#undef GF_MULTIPLY
+
+	AesTablesGenerated = 1;
+}
+
+#define TE(x, rotation)	ROR32(AesEncryptTable[(x) & 0xFF], rotation)
+#define TD(x, rotation)	ROR32(AesDecryptTable[(x) & 0xFF], rotation)
+
+void SoftwareAes_ExpandKey(SoftwareAesKey* key, const void* keyData)
+{
+	if(!AesTablesGenerated)
+		SoftwareAes_GenerateTables();
+
+	u32* encryptionKeys = key->EncryptionKeys;
+	const u32* keyWords = keyData;
+	for(u32 i = 0; i < 4; i++)
+		encryptionKeys[i] = BIG_ENDIAN_WORD(keyWords[i]);
+
+	u32 roundConstant = 0x01;
+	for(u32 i = 4; i < SOFTWARE_AES_KEY_WORDS; i++)
+	{
+		u32 word = encryptionKeys[i - 1];
+		if((i & 3) == 0)
+		{
+			word = ((u32)AesSbox[(word >> 16) & 0xFF] << 24) | ((u32)AesSbox[(word >> 8) & 0xFF] << 16) |
+				   ((u32)AesSbox[word & 0xFF] << 8) | AesSbox[word >> 24];
+			word ^= roundConstant << 24;
+			roundConstant = (roundConstant << 1) ^ ((roundConstant & 0x80) ? 0x11B : 0);
+		}
+		encryptionKeys[i] = encryptionKeys[i - 4] ^ word;
+	}
+
+	//the equivalent inverse cipher uses the round keys in reverse, with InvMixColumns applied to the middle rounds
+	u32* decryptionKeys = key->DecryptionKeys;
+	for(u32 round = 0; round <= SOFTWARE_AES_ROUNDS; round++)
+	{
+		for(u32 i = 0; i < 4; i++)
+		{
+			u32 word = encryptionKeys[(SOFTWARE_AES_ROUNDS - round) * 4 + i];
+			if(round != 0 && round != SOFTWARE_AES_ROUNDS)
+				word = TD(AesSbox[word >> 24], 0) ^ TD(AesSbox[(word >> 16) & 0xFF], 8) ^
+					   TD(AesSbox[(word >> 8) & 0xFF], 16) ^ TD(AesSbox[word & 0xFF], 24);
+			decryptionKeys[round * 4 + i] = word;
+		}
+	}
+}
+
+SOFTWARE_CRYPTO_CODE
+static void SoftwareAes_EncryptBlock(const u32* roundKeys, u32 state[4])
+{
+	u32 s0 = state[0] ^ roundKeys[0];
+	u32 s1 = state[1] ^ roundKeys[1];
+	u32 s2 = state[2] ^ roundKeys[2];
+	u32 s3 = state[3] ^ roundKeys[3];
+	for(u32 round = 1; round < SOFTWARE_AES_ROUNDS; round++)
+	{
+		roundKeys += 4;
+		const u32 t0 = TE(s0 >> 24, 0) ^ TE(s1 >> 16, 8) ^ TE(s2 >> 8, 16) ^ TE(s3, 24) ^ roundKeys[0];
+		const u32 t1 = TE(s1 >> 24, 0) ^ TE(s2 >> 16, 8) ^ TE(s3 >> 8, 16) ^ TE(s0, 24) ^ roundKeys[1];
+		const u32 t2 = TE(s2 >> 24, 0) ^ TE(s3 >> 16, 8) ^ TE(s0 >> 8, 16) ^ TE(s1, 24) ^ roundKeys[2];
+		const u32 t3 = TE(s3 >> 24, 0) ^ TE(s0 >> 16, 8) ^ TE(s1 >> 8, 16) ^ TE(s2, 24) ^ roundKeys[3];
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	//the last round has no MixColumns, so it only goes through the sbox
+	roundKeys += 4;
+#define SUBSTITUTE(a, b, c, d) \
+	(((u32)AesSbox[(a) >> 24] << 24) | ((u32)AesSbox[((b) >> 16) & 0xFF] << 16) | ((u32)AesSbox[((c) >> 8) & 0xFF] << 8) | AesSbox[(d) & 0xFF])
+	state[0] = SUBSTITUTE(s0, s1, s2, s3) ^ roundKeys[0];
+	state[1] = SUBSTITUTE(s1, s2, s3, s0) ^ roundKeys[1];
+	state[2] = SUBSTITUTE(s2, s3, s0, s1) ^ roundKeys[2];
+	state[3] = SUBSTITUTE(s3, s0, s1, s2) ^ roundKeys[3];
+#undef SUBSTITUTE
+}
+
+SOFTWARE_CRYPTO_CODE
+static void SoftwareAes_DecryptBlock(const u32* roundKeys, u32 state[4])
+{
+	u32 s0 = state[0] ^ roundKeys[0];
+	u32 s1 = state[1] ^ roundKeys[1];
+	u32 s2 = state[2] ^ roundKeys[2];
+	u32 s3 = state[3] ^ roundKeys[3];
+	for(u32 round = 1; round < SOFTWARE_AES_ROUNDS; round++)
+	{
+		roundKeys += 4;
+		const u32 t0 = TD(s0 >> 24, 0) ^ TD(s3 >> 16, 8) ^ TD(s2 >> 8, 16) ^ TD(s1, 24) ^ roundKeys[0];
+		const u32 t1 = TD(s1 >> 24, 0) ^ TD(s0 >> 16, 8) ^ TD(s3 >> 8, 16) ^ TD(s2, 24) ^ roundKeys[1];
+		const u32 t2 = TD(s2 >> 24, 0) ^ TD(s1 >> 16, 8) ^ TD(s0 >> 8, 16) ^ TD(s3, 24) ^ roundKeys[2];
+		const u32 t3 = TD(s3 >> 24, 0) ^ TD(s2 >> 16, 8) ^ TD(s1 >> 8, 16) ^ TD(s0, 24) ^ roundKeys[3];
+		s0 = t0;
+		s1 = t1;
+		s2 = t2;
+		s3 = t3;
+	}
+
+	roundKeys += 4;
+#define SUBSTITUTE(a, b, c, d) \
+	(((u32)AesInverseSbox[(a) >> 24] << 24) | ((u32)AesInverseSbox[((b) >> 16) & 0xFF] << 16) | \
+	 ((u32)AesInverseSbox[((c) >> 8) & 0xFF] << 8) | AesInverseSbox[(d) & 0xFF])
+	state[0] = SUBSTITUTE(s0, s3, s2, s1) ^ roundKeys[0];
+	state[1] = SUBSTITUTE(s1, s0, s3, s2) ^ roundKeys[1];
+	state[2] = SUBSTITUTE(s2, s1, s0, s3) ^ roundKeys[2];
+	state[3] = SUBSTITUTE(s3, s2, s1, s0) ^ roundKeys[3];
+#undef SUBSTITUTE
+}
+
+SOFTWARE_CRYPTO_CODE
+void SoftwareAes_EncryptCbc(const SoftwareAesKey* key, void* iv, const void* input, void* output, u32 numberOfBlocks)
+{
+	u32* chain = iv;
+	const u32* in = input;
+	u32* out = output;
+	u32 state[4];
+	for(u32 i = 0; i < 4; i++)
+		state[i] = BIG_ENDIAN_WORD(chain[i]);
+
+	while(numberOfBlocks-- != 0)
+	{
+		for(u32 i = 0; i < 4; i++)
+			state[i] ^= BIG_ENDIAN_WORD(in[i]);
+
+		SoftwareAes_EncryptBlock(key->EncryptionKeys, state);
+		for(u32 i = 0; i < 4; i++)
+			out[i] = BIG_ENDIAN_WORD(state[i]);
+
+		in += 4;
+		out += 4;
+	}
+
+	for(u32 i = 0; i < 4; i++)
+		chain[i] = BIG_ENDIAN_WORD(state[i]);
+}
+
+SOFTWARE_CRYPTO_CODE
+void SoftwareAes_DecryptCbc(const SoftwareAesKey* key, void* iv, const void* input, void* output, u32 numberOfBlocks)
+{
+	u32* chain = iv;
+	const u32* in = input;
+	u32* out = output;
+	u32 previous[4];
+	u32 ciphertext[4];
+	u32 state[4];
+	for(u32 i = 0; i < 4; i++)
+		previous[i] = BIG_ENDIAN_WORD(chain[i]);
+
+	while(numberOfBlocks-- != 0)
+	{
+		//read the block before writing the output, so decrypting in place works
+		for(u32 i = 0; i < 4; i++)
+		{
+			ciphertext[i] = BIG_ENDIAN_WORD(in[i]);
+			state[i] = ciphertext[i];
+		}
+
+		SoftwareAes_DecryptBlock(key->DecryptionKeys, state);
+		for(u32 i = 0; i < 4; i++)
+		{
+			out[i] = BIG_ENDIAN_WORD(state[i] ^ previous[i]);
+			previous[i] = ciphertext[i];
+		}
+
+		in += 4;
+		out += 4;
+	}
+
+	for(u32 i = 0; i < 4; i++)
+		chain[i] = BIG_ENDIAN_WORD(previous[i]);
+}
+
+//sha-1 with all 80 rounds unrolled & the message schedule kept in a 16 word ring
+#define SHA1_CHOOSE(b, c, d)	((d) ^ ((b) & ((c) ^ (d))))
+#define SHA1_PARITY(b, c, d)	((b) ^ (c) ^ (d))
+#define SHA1_MAJORITY(b, c, d)	(((b) & (c)) | ((d) & ((b) | (c))))
+#define SHA1_LOAD(i)			(schedule[i] = BIG_ENDIAN_WORD(block[i]))
+#define SHA1_EXPAND(i)			(schedule[(i) & 15] = ROL32(schedule[((i) + 13) & 15] ^ schedule[((i) + 8) & 15] ^ \
+														schedule[((i) + 2) & 15] ^ schedule[(i) & 15], 1))
+#define SHA1_ROUND(a, b, c, d, e, function, constant, word) \
+	e += ROL32(a, 5) + function(b, c, d) + (constant) + (word); \
+	b = ROL32(b, 30);
+
+#define R0(a, b, c, d, e, i) SHA1_ROUND(a, b, c, d, e, SHA1_CHOOSE, 0x5A827999, SHA1_LOAD(i))
+#define R1(a, b, c, d, e, i) SHA1_ROUND(a, b, c, d, e, SHA1_CHOOSE, 0x5A827999, SHA1_EXPAND(i))
+#define R2(a, b, c, d, e, i) SHA1_ROUND(a, b, c, d, e, SHA1_PARITY, 0x6ED9EBA1, SHA1_EXPAND(i))
+#define R3(a, b, c, d, e, i) SHA1_ROUND(a, b, c, d, e, SHA1_MAJORITY, 0x8F1BBCDC, SHA1_EXPAND(i))
+#define R4(a, b, c, d, e, i) SHA1_ROUND(a, b, c, d, e, SHA1_PARITY, 0xCA62C1D6, SHA1_EXPAND(i))
+//5 rounds bring the variables back to where they started
+#define ROUNDS5(R, i) \
+	R(a, b, c, d, e, (i)) R(e, a, b, c, d, (i) + 1) R(d, e, a, b, c, (i) + 2) R(c, d, e, a, b, (i) + 3) R(b, c, d, e, a, (i) + 4)
+
+SOFTWARE_CRYPTO_CODE
+void SoftwareSha1_HashBlocks(u32 states[5], const void* input, u32 numberOfBlocks)
+{
+	const u32* block = input;
+	u32 schedule[16];
+	while(numberOfBlocks-- != 0)
+	{
+		u32 a = states[0];
+		u32 b = states[1];
+		u32 c = states[2];
+		u32 d = states[3];
+		u32 e = states[4];
+
+		ROUNDS5(R0, 0)
+		ROUNDS5(R0, 5)
+		ROUNDS5(R0, 10)
+		R0(a, b, c, d, e, 15) R1(e, a, b, c, d, 16) R1(d, e, a, b, c, 17) R1(c, d, e, a, b, 18) R1(b, c, d, e, a, 19)
+		ROUNDS5(R2, 20)
+		ROUNDS5(R2, 25)
+		ROUNDS5(R2, 30)
+		ROUNDS5(R2, 35)
+		ROUNDS5(R3, 40)
+		ROUNDS5(R3, 45)
+		ROUNDS5(R3, 50)
+		ROUNDS5(R3, 55)
+		ROUNDS5(R4, 60)
+		ROUNDS5(R4, 65)
+		ROUNDS5(R4, 70)
+		ROUNDS5(R4, 75)
+
+		states[0] += a;
+		states[1] += b;
+		states[2] += c;
+		states[3] += d;
+		states[4] += e;
+		block += 16;
+	}
+}
+
+void SoftwareSha1_Init(SoftwareSha1Context* context)
+{
+	context->States[0] = 0x67452301;
+	context->States[1] = 0xEFCDAB89;
+	context->States[2] = 0x98BADCFE;
+	context->States[3] = 0x10325476;
+	context->States[4] = 0xC3D2E1F0;
+	context->Length = 0;
+}
+
+void SoftwareSha1_Update(SoftwareSha1Context* context, const void* data, u32 length)
+{
+	const u8* input = data;
+	u8* block = (u8*)context->Block;
+	u32 used = context->Length & 0x3F;
+	context->Length += length;
+
+	if(used != 0)
+	{
+		const u32 size = length < 0x40 - used ? length : 0x40 - used;
+		memcpy(block + used, input, size);
+		input += size;
+		length -= size;
+		used += size;
+		if(used < 0x40)
+			return;
+
+		SoftwareSha1_HashBlocks(context->States, block, 1);
+	}
+
+	//whole blocks are hashed straight from the input when it is word aligned
+	if(((size_t)input & 3) == 0)
+	{
+		SoftwareSha1_HashBlocks(context->States, input, length >> 6);
+		input += length & ~0x3Fu;
+		length &= 0x3F;
+	}
+
+	for(; length >= 0x40; input += 0x40, length -= 0x40)
+	{
+		memcpy(block, input, 0x40);
+		SoftwareSha1_HashBlocks(context->States, block, 1);
+	}
+
+	memcpy(block, input, length);
+}
+
+void SoftwareSha1_Finalize(SoftwareSha1Context* context, u8* digest)
+{
+	u8* block = (u8*)context->Block;
+	u32 used = context->Length & 0x3F;
+	block[used++] = 0x80;
+	if(used > 0x38)
+	{
+		memset(block + used, 0, 0x40 - used);
+		SoftwareSha1_HashBlocks(context->States, block, 1);
+		used = 0;
+	}
+
+	memset(block + used, 0, 0x3B - used);
+	block[0x3B] = (u8)(context->Length >> 29);
+	block[0x3C] = (u8)(context->Length >> 21);
+	block[0x3D] = (u8)(context->Length >> 13);
+	block[0x3E] = (u8)(context->Length >> 5);
+	block[0x3F] = (u8)(context->Length << 3);
+	SoftwareSha1_HashBlocks(context->States, block, 1);
+
+	for(u32 i = 0; i < 20; i++)
+		digest[i] = (u8)(context->States[i >> 2] >> (24 - 8 * (i & 3)));
+}
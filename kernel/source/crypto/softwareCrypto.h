@@ -0,0 +1,51 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	softwareCrypto - aes-128-cbc & sha-1 in software
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#pragma once
+
+#include <types.h>
+
+//building with SOFTWARE_CRYPTO (make SOFTWARE_CRYPTO=1) runs /dev/aes & /dev/sha on the cpu from the start.
+//without it the engines are used. a request the engine fails is retried, then finished on the cpu, & aes.c & sha.c only
+//switch to the cpu for good once their engine failed SHA/AES_ENGINE_MAX_FAILURES times on kernel memory.
+//softwareCrypto.c only depends on types.h & string.h, so it is also built for the host by tools/cryptotest.c
+#ifdef SOFTWARE_CRYPTO
+#define SOFTWARE_CRYPTO_DEFAULT 1
+#else
+#define SOFTWARE_CRYPTO_DEFAULT 0
+#endif
+
+#define SOFTWARE_AES_ROUNDS		10
+#define SOFTWARE_AES_KEY_WORDS	(4 * (SOFTWARE_AES_ROUNDS + 1))
+
+typedef struct
+{
+	u32 EncryptionKeys[SOFTWARE_AES_KEY_WORDS];
+	u32 DecryptionKeys[SOFTWARE_AES_KEY_WORDS];
+} SoftwareAesKey;
+
+typedef struct
+{
+	u32 States[5];
+	u32 Length;
+	u32 Block[16];
+} SoftwareSha1Context;
+
+//all buffers have to be word aligned, just like for the engines
+void SoftwareAes_ExpandKey(SoftwareAesKey* key, const void* keyData);
+//the iv is updated with the last block of ciphertext, so the chain can be continued with the next call
+void SoftwareAes_EncryptCbc(const SoftwareAesKey* key, void* iv, const void* input, void* output, u32 numberOfBlocks);
+void SoftwareAes_DecryptCbc(const SoftwareAesKey* key, void* iv, const void* input, void* output, u32 numberOfBlocks);
+//runs the sha-1 compression function over whole 64 byte blocks, like the engine does with its SHA_H registers
+void SoftwareSha1_HashBlocks(u32 states[5], const void* input, u32 numberOfBlocks);
+//a complete sha-1 with padding, for any length & alignment of the input
+void SoftwareSha1_Init(SoftwareSha1Context* context);
+void SoftwareSha1_Update(SoftwareSha1Context* context, const void* data, u32 length);
+void SoftwareSha1_Finalize(SoftwareSha1Context* context, u8* digest);
@@ -0,0 +1,108 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	deferredWork - run the bottom halves of irq's outside of the irq handler
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/processor.h>
+#include <ios/errno.h>
+
+#include "core/hollywood.h"
+#include "interrupt/irq.h"
+#include "interrupt/deferredWork.h"
+#include "messaging/messageQueue.h"
+#include "panic.h"
+
+static InterruptHandler DeferredWorkHandlers[MAX_DEVICES];
+//irq lines that have their bottom half pending. set by the irq handler, taken atomically by the deferred work thread
+static volatile u32 PendingDeferredWork = 0;
+static MessageQueue* DeferredWorkQueue = NULL;
+
+//swap the pending work out for nothing, so the work thread never has to disable interrupts to take it
+__attribute__((target("arm")))
+static u32 TakePendingDeferredWork(void)
+{
+	u32 pending;
+	__asm__ volatile (
+		"swp	%[pending], %[empty], [%[address]]"
+		: [pending] "=&r" (pending)
+		: [empty] "r" (0), [address] "r" (&PendingDeferredWork)
+		: "memory"
+	);
+	return pending;
+}
+
+s32 RegisterDeferredWork(const u32 irq, InterruptHandler handler)
+{
+	if(irq >= MAX_DEVICES)
+		return IPC_EINVAL;
+
+	const u32 irqState = DisableInterrupts();
+	DeferredWorkHandlers[irq] = handler;
+	RestoreInterrupts(irqState);
+	return IPC_SUCCESS;
+}
+
+//called by the top half of an irq, after it acked the hardware.
+//the line stays masked until its bottom half ran, so level triggered devices don't keep firing in the meantime
+void QueueDeferredWork(const u32 irq)
+{
+	const InterruptHandler handler = DeferredWorkHandlers[irq];
+	if(handler == NULL)
+		return;
+
+	//the work thread isn't running yet (early boot), so handle it right away like we used to
+	if(DeferredWorkQueue == NULL)
+	{
+		handler();
+		return;
+	}
+
+	const u32 irqFlag = 1u << irq;
+	clear32(HW_ARMIRQMASK, irqFlag);
+
+	const u32 pending = PendingDeferredWork;
+	PendingDeferredWork = pending | irqFlag;
+	if(pending == 0)
+		SignalInterruptThread(irq, DeferredWorkQueue, NULL);
+}
+
+void DeferredWorkHandler(void)
+{
+	u32 workMessages[1];
+	s32 ret = CreateMessageQueue((void**)&workMessages, 1);
+	if(ret < 0)
+		panic("Unable to create deferred work message queue: %d\n", ret);
+
+	const s32 workQueueId = ret;
+	DeferredWorkQueue = &MessageQueues[workQueueId];
+
+	while(1)
+	{
+		//wait for the irq handler to signal there is work to do
+		do
+		{
+			ret = ReceiveMessage(workQueueId, (void **)0x0, None);
+		} while (ret != 0);
+
+		u32 pending = TakePendingDeferredWork();
+		while(pending != 0)
+		{
+			const u32 irq = 31 - (u32)__builtin_clz(pending);
+			const u32 irqFlag = 1u << irq;
+			pending &= ~irqFlag;
+
+			const InterruptHandler handler = DeferredWorkHandlers[irq];
+			if(handler != NULL)
+				handler();
+
+			const u32 irqState = DisableInterrupts();
+			set32(HW_ARMIRQMASK, irqFlag);
+			RestoreInterrupts(irqState);
+		}
+	}
+}
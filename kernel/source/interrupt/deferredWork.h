@@ -0,0 +1,23 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	deferredWork - run the bottom halves of irq's outside of the irq handler
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __DEFERRED_WORK_H__
+#define __DEFERRED_WORK_H__
+
+#include <types.h>
+#include "interrupt/irq.h"
+
+#define DEFERRED_WORK_PRIORITY	0x7F
+
+void DeferredWorkHandler(void);
+s32 RegisterDeferredWork(const u32 irq, InterruptHandler handler);
+void QueueDeferredWork(const u32 irq);
+
+#endif
@@ -15,6 +15,7 @@ Copyright (C) 2008, 2009	Haxx Enterprises <bushing@gmail.com>
 #include "core/hollywood.h"
 #include "memory/memory.h"
 #include "interrupt/undefined.h"
+#include "interrupt/irq.h"
 #include "panic.h"
 
 const char *exceptions[] = {
@@ -111,5 +112,8 @@ void ExceptionHandler(u32 type, u32 spsr, u32 *regs)
 		gecko_printf("%08x: *%08x %08x %08x %08x\n", pc, read32(pc), read32(pc+4), read32(pc+8), read32(pc+12));
 		gecko_printf("%08x:  %08x %08x %08x %08x\n", pc+16, read32(pc+16), read32(pc+20), read32(pc+24), read32(pc+28));
 	}
+
+	//how long the irq handlers ran & which code kept interrupts disabled the longest, to go with the crash
+	PrintInterruptStatistics();
 	panic2(0, PANIC_EXCEPTION);
 }
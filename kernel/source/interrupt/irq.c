@@ -13,19 +13,36 @@ Copyright (C) 2009			Andre Heider "dhewg" <dhewg@wiibrew.org>
 #include <ios/processor.h>
 #include <ios/gecko.h>
 #include <ios/errno.h>
+#include <string.h>
 
 #include "interrupt/irq.h"
+#include "interrupt/deferredWork.h"
+#include "interrupt/profiler.h"
+#include "interrupt/trace.h"
 #include "scheduler/threads.h"
 #include "scheduler/timer.h"
 #include "memory/memory.h"
 #include "messaging/messageQueue.h"
 #include "core/hollywood.h"
 #include "messaging/ipc.h"
+#include "crypto/aes.h"
 
 #include "nand.h"
 #include "sdhc.h"
 
 EventHandler eventHandlers[MAX_DEVICES];
+//event handlers in counter mode & the amount of events they have not taken yet
+static u32 CountingEventHandlers = 0;
+static u32 EventCounts[MAX_DEVICES];
+
+static IrqStatistics InterruptStatistics[MAX_DEVICES];
+//the handler thread each irq line last woke up, and when that irq came in
+static const ThreadInfo* InterruptWakeThreads[MAX_DEVICES];
+static u64 InterruptWakeTimes[MAX_DEVICES];
+static u64 InterruptTime = 0;
+//longest time spent in the irq handler, which runs with interrupts disabled
+static u32 MaxInterruptTicks = 0;
+u32 PendingInterruptWakeups = 0;
 
 void IrqInit(void)
 {
@@ -154,7 +171,7 @@ s32 ClearAndEnableIPCInterrupt(void)
 }
 #endif
 
-s32 RegisterEventHandler(const u8 device, const s32 queueid, void* message)
+static s32 SetEventHandler(const u8 device, const s32 queueid, void* message, const u8 countEvents)
 {
 	u32 irqState = DisableInterrupts();
 	s32 ret = 0;
@@ -173,6 +190,47 @@ s32 RegisterEventHandler(const u8 device, const s32 queueid, void* message)
 	eventHandlers[device].Message = message;
 	eventHandlers[device].ProcessId = CurrentThread->ProcessId;
 	eventHandlers[device].MessageQueue = &MessageQueues[queueid];
+	EventCounts[device] = 0;
+	if(countEvents)
+		CountingEventHandlers |= 1u << device;
+	else
+		CountingEventHandlers &= ~(1u << device);
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+s32 RegisterEventHandler(const u8 device, const s32 queueid, void* message)
+{
+	return SetEventHandler(device, queueid, message, 0);
+}
+
+//like RegisterEventHandler, but irq's that fire while the message is still pending are counted instead of dropped.
+//the handler receives a single message & collects the amount of events with TakeEventCount
+s32 RegisterEventCounter(const u8 device, const s32 queueid, void* message)
+{
+	return SetEventHandler(device, queueid, message, 1);
+}
+
+s32 TakeEventCount(const u8 device)
+{
+	u32 irqState = DisableInterrupts();
+	s32 ret = 0;
+	if(device >= MAX_DEVICES || (CountingEventHandlers & (1u << device)) == 0)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;	
+	}
+
+	if(eventHandlers[device].ProcessId != CurrentThread->ProcessId)
+	{
+		ret = IPC_EACCES;
+		goto restore_and_return;
+	}
+
+	ret = (s32)EventCounts[device];
+	EventCounts[device] = 0;
 
 restore_and_return:
 	RestoreInterrupts(irqState);
@@ -197,34 +255,67 @@ s32 UnregisterEventHandler(const u8 device)
 
 	eventHandlers[device].MessageQueue = NULL;
 	eventHandlers[device].Message = NULL;
+	EventCounts[device] = 0;
+	CountingEventHandlers &= ~(1u << device);
 
 restore_and_return:
 	RestoreInterrupts(irqState);
 	return ret;
 }
 
-void EnqueueEventHandler(s32 device)
+//queue a message for a thread handling an irq & wake it up, without yielding to it since we are in the irq handler.
+//the message is dropped when the queue is full, which the caller has to account for
+s32 SignalInterruptThread(const u32 device, MessageQueue* queue, void* message)
 {
-	MessageQueue* queue = eventHandlers[device].MessageQueue;
 	if(queue == NULL)
-		return;
+		return IPC_EINVAL;
 
 	if((u32)queue->Used >= queue->QueueSize)
-		return;
+		return IPC_EQUEUEFULL;
 
 	u32 messageIndex = (u32)(queue->Used + queue->First);
 	queue->Used += 1;
 	if(messageIndex >= queue->QueueSize)
 		messageIndex -= queue->QueueSize;
 
-	queue->QueueHeap[messageIndex] = eventHandlers[device].Message;
+	queue->QueueHeap[messageIndex] = message;
+	TRACE(TraceSendMessage, queue - MessageQueues, message);
 	if(queue->ReceiveThreadQueue.NextThread->NextThread != NULL)
 	{
 		ThreadInfo* handlerThread = ThreadQueue_PopThread(&queue->ReceiveThreadQueue);
 		handlerThread->ThreadState = Ready;
 		handlerThread->ThreadContext.Registers[0] = IPC_SUCCESS;
 		ThreadQueue_PushThread(&SchedulerQueue, handlerThread);
+
+		InterruptWakeThreads[device] = handlerThread;
+		InterruptWakeTimes[device] = InterruptTime;
+		PendingInterruptWakeups |= 1u << device;
+	}
+
+	return IPC_SUCCESS;
+}
+
+void EnqueueEventHandler(s32 device)
+{
+	if(CountingEventHandlers & (1u << device))
+	{
+		//only the first event queues a message, the rest is picked up by the handler with that same message
+		const u32 pendingEvents = EventCounts[device];
+		if(pendingEvents != 0)
+		{
+			if(pendingEvents != 0xFFFFFFFF)
+				EventCounts[device] = pendingEvents + 1;
+			return;
+		}
+
+		//the count only starts once the message is queued. if it was dropped, a count left behind
+		//would make every later event think a message is already on its way & the handler would never wake up again
+		if(SignalInterruptThread((u32)device, eventHandlers[device].MessageQueue, eventHandlers[device].Message) == IPC_SUCCESS)
+			EventCounts[device] = 1;
+		return;
 	}
+
+	SignalInterruptThread((u32)device, eventHandlers[device].MessageQueue, eventHandlers[device].Message);
 }
 
 void irq_shutdown(void)
@@ -234,6 +325,116 @@ void irq_shutdown(void)
 	DisableInterrupts();
 }
 
+static void TimerInterrupt(void)
+{
+	write32(HW_ALARM, 0);
+	write32(HW_ARMIRQFLAG, IRQF_TIMER);
+	EnqueueEventHandler(IRQ_TIMER);
+}
+
+static void Ohci1Interrupt(void)
+{
+	clear32(HW_ARMIRQMASK, IRQF_OHCI1);
+	write32(HW_ARMIRQFLAG, IRQF_OHCI1);
+	EnqueueEventHandler(IRQ_OHCI1);
+}
+
+//power button
+static void Gpio1Interrupt(void)
+{
+#ifdef MIOS
+	clear32(HW_ARMIRQMASK, IRQF_GPIO1);
+	//MIOS Executes something here. is it like a reset?
+#else
+	write32(HW_GPIO1INTFLAG, 0xFFFFFF); // shut it up
+	write32(HW_ARMIRQFLAG, IRQF_GPIO1);
+#endif
+}
+
+#ifdef MIOS
+static void UnknownMiosInterrupt(void)
+{
+	clear32(HW_ARMIRQMASK, IRQF_UNKNMIOS);
+	//MIOS Executes something here. is it like a reset?
+}
+#else
+static void NandInterrupt(void)
+{
+	write32(NAND_CMD, 0x7fffffff); // shut it up
+	write32(HW_ARMIRQFLAG, IRQF_NAND);
+	QueueDeferredWork(IRQ_NAND);
+}
+
+static void Gpio1bInterrupt(void)
+{
+	write32(HW_GPIO1BINTFLAG, 0xFFFFFF); // shut it up
+	write32(HW_ARMIRQFLAG, IRQF_GPIO1B);
+}
+
+static void ResetInterrupt(void)
+{
+	write32(HW_ARMIRQFLAG, IRQF_RESET);
+}
+
+static void IpcInterrupt(void)
+{
+	clear32(HW_ARMIRQMASK, IRQF_IPC);
+	write32(HW_ARMIRQFLAG, IRQF_IPC);
+	EnqueueEventHandler(IRQ_IPC);
+}
+
+static void Sha1Interrupt(void)
+{
+	write32(HW_ARMIRQFLAG, IRQF_SHA1);
+	EnqueueEventHandler(IRQ_SHA1);
+}
+
+static void AesInterrupt(void)
+{
+	write32(HW_ARMIRQFLAG, IRQF_AES);
+	AesCommandCompleted();
+}
+
+static void SdhcInterrupt(void)
+{
+	write32(HW_ARMIRQFLAG, IRQF_SDHC);
+	QueueDeferredWork(IRQ_SDHC);
+}
+#endif
+
+//top halves of the irq lines we handle. lines without a handler are acked & reported as unknown
+static const InterruptHandler InterruptHandlers[MAX_DEVICES] = 
+{
+	[IRQ_TIMER]		= TimerInterrupt,
+	[IRQ_OHCI1]		= Ohci1Interrupt,
+	[IRQ_GPIO1]		= Gpio1Interrupt,
+#ifdef MIOS
+	[IRQ_UNKNMIOS]	= UnknownMiosInterrupt,
+#else
+	[IRQ_NAND]		= NandInterrupt,
+	[IRQ_GPIO1B]	= Gpio1bInterrupt,
+	[IRQ_RESET]		= ResetInterrupt,
+	[IRQ_IPC]		= IpcInterrupt,
+	[IRQ_SHA1]		= Sha1Interrupt,
+	[IRQ_AES]		= AesInterrupt,
+	[IRQ_SDHC]		= SdhcInterrupt,
+#endif
+};
+
+//order in which simultaneous irqs are handled, the same as the if chain the table replaced : the timer first
+static const u8 InterruptOrder[] = 
+{
+	IRQ_TIMER, IRQ_OHCI1, IRQ_GPIO1,
+#ifdef MIOS
+	IRQ_UNKNMIOS,
+#else
+	IRQ_NAND, IRQ_GPIO1B, IRQ_RESET, IRQ_IPC, IRQ_SHA1, IRQ_AES, IRQ_SDHC,
+#endif
+};
+
+//runs on the irq stack (__irqstack_size in kernel.ld). the deepest path is the aes completion : AesCommandCompleted
+//restarting the engine or SignalInterruptThread -> RecordTraceEvent -> DisableInterrupts, roughly 0xB0 bytes counted by hand with IRQ_OFF_TRACKING
+__attribute__((target("arm")))
 void IrqHandler(ThreadContext* context)
 {
 	//Enqueue current thread
@@ -245,90 +446,204 @@ void IrqHandler(ThreadContext* context)
 	SetDomainAccessControlRegister(0x55555555);
 #endif
 
+	InterruptTime = GetMonotonicTicks();
 	u32 flags = read32(HW_ARMIRQFLAG) & read32(HW_ARMIRQMASK);
+	const u32 pendingFlags = flags;
 	//gecko_printf("In IRQ handler: 0x%08x\n", flags);
+	TRACE(TraceIrqEntry, pendingFlags, 0);
 
-	if(flags & IRQF_TIMER) 
+#ifndef MIOS
+	if(ProfilerRunning && (flags & IRQF_TIMER))
+		RecordProfilerSample(context);
+#endif
+
+	for(u32 index = 0; index < sizeof(InterruptOrder) && flags != 0; index++)
 	{
-		//gecko_printf("IRQ: Timer\n");
-		write32(HW_ALARM, 0);
-		write32(HW_ARMIRQFLAG, IRQF_TIMER);
-		EnqueueEventHandler(IRQ_TIMER);
+		const u32 irq = InterruptOrder[index];
+		const u32 irqFlag = 1u << irq;
+		if((flags & irqFlag) == 0)
+			continue;
+
+		flags &= ~irqFlag;
+		const u64 startTime = GetMonotonicTicks();
+		InterruptHandlers[irq]();
+		const u32 ticks = (u32)(GetMonotonicTicks() - startTime);
+
+		IrqStatistics* statistics = &InterruptStatistics[irq];
+		statistics->Count++;
+		statistics->TopHalfTicks += ticks;
+		if(ticks > statistics->MaxTopHalfTicks)
+			statistics->MaxTopHalfTicks = ticks;
+	}
+
+	//whatever is left has no handler
+	const u32 unknownFlags = flags;
+	if(unknownFlags) {
+		gecko_printf("IRQ: unknown 0x%08x\n", unknownFlags);
+		write32(HW_ARMIRQFLAG, unknownFlags);
 	}
 
-	if(flags & IRQF_OHCI1) 
+	const u32 interruptTicks = (u32)(GetMonotonicTicks() - InterruptTime);
+	if(interruptTicks > MaxInterruptTicks)
+		MaxInterruptTicks = interruptTicks;
+	TRACE(TraceIrqExit, pendingFlags & ~unknownFlags, interruptTicks);
+}
+
+//called by the scheduler when switching to a thread. closes the irq -> handler thread latency of any irq that woke it
+__attribute__((target("arm")))
+void RecordInterruptWakeup(const ThreadInfo* thread)
+{
+	const u64 currentTime = GetMonotonicTicks();
+	u32 pending = PendingInterruptWakeups;
+	while(pending != 0)
 	{
-		//gecko_printf("IRQ: OHCI1\n");
-		clear32(HW_ARMIRQMASK, IRQ_OHCI1);
-		write32(HW_ARMIRQFLAG, IRQ_OHCI1);
-		EnqueueEventHandler(IRQ_OHCI1);
+		const u32 irq = 31 - (u32)__builtin_clz(pending);
+		const u32 irqFlag = 1u << irq;
+		pending &= ~irqFlag;
+		if(InterruptWakeThreads[irq] != thread)
+			continue;
+
+		const u32 ticks = (u32)(currentTime - InterruptWakeTimes[irq]);
+		IrqStatistics* statistics = &InterruptStatistics[irq];
+		statistics->Wakeups++;
+		statistics->WakeLatencyTicks += ticks;
+		if(ticks > statistics->MaxWakeLatencyTicks)
+			statistics->MaxWakeLatencyTicks = ticks;
+
+		PendingInterruptWakeups &= ~irqFlag;
 	}
+}
 
-	//power button
-	if(flags & IRQF_GPIO1) {
-		//gecko_printf("IRQ: GPIO1\n");
-#ifdef MIOS
-		clear32(HW_ARMIRQMASK, IRQ_GPIO1);
-		//MIOS Executes something here. is it like a reset?
-#else
-		write32(HW_GPIO1INTFLAG, 0xFFFFFF); // shut it up
-		write32(HW_ARMIRQFLAG, IRQF_GPIO1);
+s32 GetInterruptStatistics(const u32 irq, IrqStatistics* statistics)
+{
+	if(irq > IRQ_STATISTICS_TOTAL)
+		return IPC_EINVAL;
+
+#ifndef MIOS
+	if(CheckMemoryPointer(statistics, sizeof(IrqStatistics), 4, CurrentThread->ProcessId, 0) < 0)
+		return IPC_EINVAL;
 #endif
-	}
 
-#ifdef MIOS
-	if(flags & IRQF_UNKNMIOS) {
-		//gecko_printf("IRQ: UNKNMIOS\n");
-		clear32(HW_ARMIRQMASK, IRQ_UNKNMIOS);
-		//MIOS Executes something here. is it like a reset?
+	const u32 irqState = DisableInterrupts();
+	if(irq < MAX_DEVICES)
+	{
+		memcpy(statistics, &InterruptStatistics[irq], sizeof(IrqStatistics));
+		if(irq == IRQ_TIMER)
+			statistics->Coalesced = GetCoalescedTimerInterrupts();
+		RestoreInterrupts(irqState);
+		return IPC_SUCCESS;
 	}
-#else
 
-	if(flags & IRQF_NAND) {
-		//gecko_printf("IRQ: NAND\n");
-		write32(NAND_CMD, 0x7fffffff); // shut it up
-		write32(HW_ARMIRQFLAG, IRQF_NAND);
-		nand_irq();
+	memset(statistics, 0, sizeof(IrqStatistics));
+	for(u32 line = 0; line < MAX_DEVICES; line++)
+	{
+		const IrqStatistics* lineStatistics = &InterruptStatistics[line];
+		statistics->TopHalfTicks += lineStatistics->TopHalfTicks;
+		statistics->WakeLatencyTicks += lineStatistics->WakeLatencyTicks;
+		statistics->Count += lineStatistics->Count;
+		statistics->Wakeups += lineStatistics->Wakeups;
+		if(lineStatistics->MaxWakeLatencyTicks > statistics->MaxWakeLatencyTicks)
+			statistics->MaxWakeLatencyTicks = lineStatistics->MaxWakeLatencyTicks;
 	}
+	statistics->MaxTopHalfTicks = MaxInterruptTicks;
+	statistics->Coalesced = GetCoalescedTimerInterrupts();
+	RestoreInterrupts(irqState);
+	return IPC_SUCCESS;
+}
 
-	if(flags & IRQF_GPIO1B) {
-		//gecko_printf("IRQ: GPIO1B\n");
-		write32(HW_GPIO1BINTFLAG, 0xFFFFFF); // shut it up
-		write32(HW_ARMIRQFLAG, IRQF_GPIO1B);
-	}
-	if(flags & IRQF_RESET) {
-		//gecko_printf("IRQ: RESET\n");
-		write32(HW_ARMIRQFLAG, IRQF_RESET);
-	}
-	if(flags & IRQF_IPC) {
-		//gecko_printf("IRQ: IPC\n");
-		clear32(HW_ARMIRQMASK, IRQF_IPC);
-		write32(HW_ARMIRQFLAG, IRQF_IPC);
-		EnqueueEventHandler(IRQ_IPC);
-	}
-	if(flags & IRQF_SHA1) {
-		//gecko_printf("IRQ: SHA1\n");
-		write32(HW_ARMIRQFLAG, IRQF_SHA1);
-		EnqueueEventHandler(IRQ_SHA1);
+void PrintInterruptStatistics(void)
+{
+	gecko_printf("IRQ statistics: longest irq handler run %dus, timer alarms saved by slack %d\n",
+		ConvertTicksToDelay(MaxInterruptTicks), GetCoalescedTimerInterrupts());
+	gecko_printf("IRQ statistics (us) irq : count max-top-half wakeups max-wake-latency\n");
+	for(u32 irq = 0; irq < MAX_DEVICES; irq++)
+	{
+		const IrqStatistics* statistics = &InterruptStatistics[irq];
+		if(statistics->Count == 0)
+			continue;
+
+		gecko_printf("%d : %d %d %d %d\n", irq, statistics->Count, ConvertTicksToDelay(statistics->MaxTopHalfTicks),
+			statistics->Wakeups, ConvertTicksToDelay(statistics->MaxWakeLatencyTicks));
 	}
-	if(flags & IRQF_AES) {
-		//gecko_printf("IRQ: AES\n");
-		write32(HW_ARMIRQFLAG, IRQF_AES);
-		EnqueueEventHandler(IRQ_AES);
+#ifdef IRQ_OFF_TRACKING
+	PrintInterruptsOffSections();
+#endif
+}
+
+#ifdef IRQ_OFF_TRACKING
+static IrqOffSection InterruptsOffSections[IRQ_OFF_SECTIONS];
+static u32 InterruptsOffCaller = 0;
+static u32 InterruptsOffStart = 0;
+
+//called by DisableInterrupts when it disabled interrupts that were enabled. this can't use DisableInterrupts itself
+void InterruptsDisabled(const u32 caller)
+{
+	InterruptsOffCaller = caller & ~1u;
+	InterruptsOffStart = read32(HW_TIMER);
+}
+
+//called by RestoreInterrupts right before interrupts get enabled again & by the scheduler when switching threads
+void InterruptsRestored(void)
+{
+	const u32 caller = InterruptsOffCaller;
+	if(caller == 0)
+		return;
+
+	const u32 ticks = read32(HW_TIMER) - InterruptsOffStart;
+	InterruptsOffCaller = 0;
+
+	//keep the longest section of every caller, replacing the shortest entry when the table is full
+	IrqOffSection* shortest = &InterruptsOffSections[0];
+	for(u32 i = 0; i < IRQ_OFF_SECTIONS; i++)
+	{
+		IrqOffSection* section = &InterruptsOffSections[i];
+		if(section->Caller == caller)
+		{
+			section->Count++;
+			if(ticks > section->MaxTicks)
+				section->MaxTicks = ticks;
+			return;
+		}
+
+		if(section->MaxTicks < shortest->MaxTicks)
+			shortest = section;
 	}
-	if (flags & IRQF_SDHC) {
-		//gecko_printf("IRQ: SDHC\n");
-		write32(HW_ARMIRQFLAG, IRQF_SDHC);
-		sdhc_irq();
+
+	if(shortest->Caller != 0 && ticks <= shortest->MaxTicks)
+		return;
+
+	shortest->Caller = caller;
+	shortest->Count = 1;
+	shortest->MaxTicks = ticks;
+}
+
+void PrintInterruptsOffSections(void)
+{
+	IrqOffSection sections[IRQ_OFF_SECTIONS];
+	const u32 irqState = DisableInterrupts();
+	memcpy(sections, InterruptsOffSections, sizeof(sections));
+	RestoreInterrupts(irqState);
+
+	//sort them longest first
+	for(u32 i = 1; i < IRQ_OFF_SECTIONS; i++)
+	{
+		const IrqOffSection section = sections[i];
+		u32 j = i;
+		for(; j > 0 && sections[j-1].MaxTicks < section.MaxTicks; j--)
+			sections[j] = sections[j-1];
+		sections[j] = section;
 	}
-#endif
-	
-	flags &= ~IRQF_ALL;
-	if(flags) {
-		gecko_printf("IRQ: unknown 0x%08x\n", flags);
-		write32(HW_ARMIRQFLAG, flags);
+
+	gecko_printf("IRQ off sections (ticks) caller : count max\n");
+	for(u32 i = 0; i < IRQ_OFF_SECTIONS; i++)
+	{
+		if(sections[i].Caller == 0)
+			continue;
+
+		gecko_printf("0x%08x : %d %d\n", sections[i].Caller, sections[i].Count, sections[i].MaxTicks);
 	}
 }
+#endif
 
 void irq_enable(u32 irq)
 {
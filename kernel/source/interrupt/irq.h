@@ -50,6 +50,10 @@ Copyright (C) 2008, 2009	Sven Peter <svenpeter@gmail.com>
 
 #define IRQF_ALL			( IRQF_TIMER|IRQF_NAND|IRQF_GPIO1B|IRQF_GPIO1|IRQF_RESET|IRQF_IPC|IRQF_AES|IRQF_SHA1|IRQF_SDHC )
 
+//record the length & caller of every section that runs with interrupts disabled, and keep the longest ones
+//#define IRQ_OFF_TRACKING
+#define IRQ_OFF_SECTIONS	16
+
 #define CPSR_IRQDIS 0x80
 #define CPSR_FIQDIS 0x40
 
@@ -71,11 +75,54 @@ CHECK_OFFSET(EventHandler, 0x04, Message);
 CHECK_OFFSET(EventHandler, 0x08, ProcessId);
 CHECK_OFFSET(EventHandler, 0x0C, Unknown);
 
+typedef void (*InterruptHandler)(void);
+
+//per irq line accounting, in ticks of the monotonic clock. the totals are 64 bit so they don't wrap
+typedef struct
+{
+	u64 TopHalfTicks;
+	u64 WakeLatencyTicks;
+	u32 Count;
+	u32 MaxTopHalfTicks;
+	u32 Wakeups;
+	u32 MaxWakeLatencyTicks;
+	//interrupts the line didn't need because the work was batched into another one. only the timer does this,
+	//for timers whose slack let them share an alarm
+	u32 Coalesced;
+	u32 Reserved;
+} IrqStatistics;
+//GetInterruptStatistics returns the totals of all irq lines for this irq, with the longest run of the whole irq handler
+//as the max top half
+#define IRQ_STATISTICS_TOTAL	MAX_DEVICES
+
+#ifdef IRQ_OFF_TRACKING
+//a caller of DisableInterrupts & the longest time it kept interrupts disabled, in timer ticks
+typedef struct
+{
+	u32 Caller;
+	u32 Count;
+	u32 MaxTicks;
+} IrqOffSection;
+#endif
+
+extern u32 PendingInterruptWakeups;
+
 void IrqInit(void);
 u32 DisableInterrupts(void);
 void RestoreInterrupts(u32 cookie);
 s32 RegisterEventHandler(const u8 device, const s32 queueid, void* message);
+s32 RegisterEventCounter(const u8 device, const s32 queueid, void* message);
+s32 TakeEventCount(const u8 device);
 s32 UnregisterEventHandler(const u8 device);
+s32 SignalInterruptThread(const u32 device, MessageQueue* queue, void* message);
+void RecordInterruptWakeup(const ThreadInfo* thread);
+s32 GetInterruptStatistics(const u32 irq, IrqStatistics* statistics);
+void PrintInterruptStatistics(void);
+#ifdef IRQ_OFF_TRACKING
+void InterruptsDisabled(const u32 caller);
+void InterruptsRestored(void);
+void PrintInterruptsOffSections(void);
+#endif
 
 s32 ClearAndEnableEvent(u32 inter);
 s32 ClearAndEnableSDInterrupt(const u8 sdio);
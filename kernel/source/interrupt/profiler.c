@@ -0,0 +1,124 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	profiler - sample what the starlet is running on the timer irq
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/errno.h>
+#include <ios/gecko.h>
+
+#include "interrupt/irq.h"
+#include "interrupt/profiler.h"
+#include "memory/heaps.h"
+#include "scheduler/threads.h"
+#include "scheduler/timer.h"
+
+//only the kernel & es get to use the profiler. it allocates on the kernel heap & samples every process
+#define PROFILER_OWNERS 3
+
+u8 ProfilerRunning = 0;
+static ProfilerSample* ProfilerSamples = NULL;
+static u32 ProfilerCapacity = 0;
+//next sample to write & the amount of samples in the ring. once full, the oldest samples get overwritten
+static u32 ProfilerHead = 0;
+static u32 ProfilerUsed = 0;
+static u32 ProfilerIntervalTicks = 0;
+
+//called by the irq handler on a timer irq, with the context of the thread that got interrupted
+void RecordProfilerSample(const ThreadContext* context)
+{
+	ProfilerSample* sample = &ProfilerSamples[ProfilerHead];
+	sample->ProgramCounter = context->ProgramCounter;
+	sample->LinkRegister = context->LinkRegister;
+	sample->ProcessId = CurrentThread->ProcessId;
+
+	ProfilerHead++;
+	if(ProfilerHead >= ProfilerCapacity)
+		ProfilerHead = 0;
+	if(ProfilerUsed < ProfilerCapacity)
+		ProfilerUsed++;
+}
+
+s32 StartProfiler(u32 intervalUs, u32 samples)
+{
+	if(!CurrentProcessIsOwner(PROFILER_OWNERS))
+		return IPC_EACCES;
+
+	u32 irqState = DisableInterrupts();
+	s32 ret = IPC_SUCCESS;
+	if(intervalUs < PROFILER_MIN_INTERVAL || samples == 0 || samples > PROFILER_MAX_SAMPLES)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;
+	}
+
+	if(ProfilerRunning)
+	{
+		ret = IPC_EEXIST;
+		goto restore_and_return;
+	}
+
+	if(ProfilerCapacity != samples)
+	{
+		if(ProfilerSamples != NULL)
+			FreeOnHeap(KernelHeapId, ProfilerSamples);
+
+		ProfilerCapacity = 0;
+		ProfilerSamples = AllocateOnHeap(KernelHeapId, samples * sizeof(ProfilerSample));
+		if(ProfilerSamples == NULL)
+		{
+			ret = IPC_ENOMEM;
+			goto restore_and_return;
+		}
+		ProfilerCapacity = samples;
+	}
+
+	ProfilerHead = 0;
+	ProfilerUsed = 0;
+	ProfilerIntervalTicks = ConvertDelayToTicks(intervalUs);
+	ProfilerRunning = 1;
+	SetTimerAlarmInterval(ProfilerIntervalTicks);
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+s32 StopProfiler(void)
+{
+	if(!CurrentProcessIsOwner(PROFILER_OWNERS))
+		return IPC_EACCES;
+
+	u32 irqState = DisableInterrupts();
+	ProfilerRunning = 0;
+	SetTimerAlarmInterval(0);
+	RestoreInterrupts(irqState);
+	return IPC_SUCCESS;
+}
+
+//prints the samples, oldest first, for tools/profiler.py to symbolize
+s32 DumpProfilerSamples(void)
+{
+	if(!CurrentProcessIsOwner(PROFILER_OWNERS))
+		return IPC_EACCES;
+
+	if(ProfilerRunning)
+		return IPC_NOTREADY;
+
+	gecko_printf("profiler: begin %d samples %d ticks\n", ProfilerUsed, ProfilerIntervalTicks);
+	u32 index = ProfilerUsed < ProfilerCapacity ? 0 : ProfilerHead;
+	for(u32 i = 0; i < ProfilerUsed; i++)
+	{
+		const ProfilerSample* sample = &ProfilerSamples[index];
+		gecko_printf("profiler: %d %08x %08x\n", sample->ProcessId, sample->ProgramCounter, sample->LinkRegister);
+		index++;
+		if(index >= ProfilerCapacity)
+			index = 0;
+	}
+	gecko_printf("profiler: end\n");
+	return IPC_SUCCESS;
+}
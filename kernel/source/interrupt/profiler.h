@@ -0,0 +1,35 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	profiler - sample what the starlet is running on the timer irq
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <types.h>
+#include "scheduler/threads.h"
+
+#define PROFILER_MIN_INTERVAL	100
+#define PROFILER_MAX_SAMPLES	0x4000
+
+typedef struct
+{
+	u32 ProgramCounter;
+	u32 LinkRegister;
+	u32 ProcessId;
+} ProfilerSample;
+CHECK_SIZE(ProfilerSample, 0x0C);
+
+extern u8 ProfilerRunning;
+
+void RecordProfilerSample(const ThreadContext* context);
+s32 StartProfiler(u32 intervalUs, u32 samples);
+s32 StopProfiler(void);
+s32 DumpProfilerSamples(void);
+
+#endif
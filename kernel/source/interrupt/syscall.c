@@ -12,6 +12,8 @@
 
 #include "core/hollywood.h"
 #include "interrupt/irq.h"
+#include "interrupt/profiler.h"
+#include "interrupt/trace.h"
 #include "scheduler/timer.h"
 #include "scheduler/threads.h"
 #include "memory/memory.h"
@@ -124,9 +126,9 @@ static const void* syscall_handlers[]  __attribute__ ((section (".syscalls"))) =
 	IOSC_DeleteObject,			//0x005C
 	0x00000000,					//0x005D
 	0x00000000,					//0x005E
-	0x00000000,					//0x005F
+	IOSC_ImportPublicKey,		//0x005F
 	0x00000000,					//0x0060
-	0x00000000,					//0x0061
+	IOSC_ComputeSharedKey,		//0x0061
 	0x00000000,					//0x0062
 	IOSC_GetData,				//0x0063
 	IOSC_GetKeySize,			//0x0064
@@ -137,16 +139,16 @@ static const void* syscall_handlers[]  __attribute__ ((section (".syscalls"))) =
 	IOSC_Encrypt,				//0x0069
 	IOSC_DecryptAsync,			//0x006A
 	IOSC_Decrypt,				//0x006B
-	0x00000000,					//0x006C
+	IOSC_VerifyPublicKeySign,	//0x006C
 	IOSC_GenerateBlockMAC,		//0x006D
 	IOSC_GenerateBlockMACAsync,	//0x006E
-	0x00000000,					//0x006F
+	IOSC_ImportCertificate,		//0x006F
 	0x00000000,					//0x0070
 	0x00000000,					//0x0071
 	0x00000000,					//0x0072
 	0x00000000,					//0x0073
 	0x00000000,					//0x0074
-	0x00000000,					//0x0075
+	IOSC_GeneratePublicKeySign,	//0x0075
 	0x00000000,					//0x0076
 	0x00000000,					//0x0077
 	0x00000000,					//0x0078
@@ -157,6 +159,24 @@ static const void* syscall_handlers[]  __attribute__ ((section (".syscalls"))) =
 	0x00000000,					//0x007D
 	0x00000000,					//0x007E
 	0x00000000,					//0x007F
+	//starstruck specific syscalls, kept out of the IOS range
+	ReallocateOnHeap,			//0x0080
+	SetTimerSlack,				//0x0081
+	GetMonotonicTime,			//0x0082
+	SleepThread,				//0x0083
+	ReceiveMessageTimeout,		//0x0084
+	GetInterruptStatistics,		//0x0085
+	RegisterEventCounter,		//0x0086
+	TakeEventCount,				//0x0087
+	StartProfiler,				//0x0088
+	StopProfiler,				//0x0089
+	DumpProfilerSamples,		//0x008A
+	StartTracing,				//0x008B
+	StopTracing,				//0x008C
+	DumpTraceEvents,			//0x008D
+	IOSC_DecryptAndVerify,		//0x008E
+	GetMemoryPointerCacheStats,	//0x008F
+	GetMemoryMappingStatistics,	//0x0090
 #endif
 };
 
@@ -205,7 +225,7 @@ s32 HandleSyscall(u16 syscall)
 		return -666;
 	}
 	
-	//dive into the handler
+	//dive into the handler. arguments after the 4th one are in r4-r9, the userland stubs load them from the stack
 	return handler(reg[0], reg[1], reg[2], reg[3], reg[4], reg[5], reg[6], reg[7], reg[8], reg[9]);
 }
 
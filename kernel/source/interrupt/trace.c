@@ -0,0 +1,129 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	trace - record kernel events in a ring buffer
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#include <ios/processor.h>
+#include <ios/errno.h>
+#include <ios/gecko.h>
+
+#include "core/hollywood.h"
+#include "interrupt/irq.h"
+#include "interrupt/trace.h"
+#include "memory/heaps.h"
+#include "scheduler/threads.h"
+#include "scheduler/timer.h"
+
+//only the kernel & es get to use the tracing. it allocates on the kernel heap & records every process
+#define TRACE_OWNERS 3
+
+u8 TracingEnabled = 0;
+static TraceEvent* TraceEvents = NULL;
+static u32 TraceCapacity = 0;
+//next event to write & the amount of events in the ring. once full, the oldest events get overwritten
+static u32 TraceHead = 0;
+static u32 TraceUsed = 0;
+
+void RecordTraceEvent(const TraceEventId event, const u32 argument1, const u32 argument2)
+{
+	const u32 irqState = DisableInterrupts();
+	if(!TracingEnabled)
+		goto restore_and_return;
+
+	TraceEvent* traceEvent = &TraceEvents[TraceHead];
+	traceEvent->Timestamp = read32(HW_TIMER);
+	traceEvent->Event = (u16)event;
+	traceEvent->ThreadId = (u16)(CurrentThread - Threads);
+	traceEvent->Argument1 = argument1;
+	traceEvent->Argument2 = argument2;
+
+	TraceHead++;
+	if(TraceHead >= TraceCapacity)
+		TraceHead = 0;
+	if(TraceUsed < TraceCapacity)
+		TraceUsed++;
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+}
+
+s32 StartTracing(u32 events)
+{
+	if(!CurrentProcessIsOwner(TRACE_OWNERS))
+		return IPC_EACCES;
+
+	u32 irqState = DisableInterrupts();
+	s32 ret = IPC_SUCCESS;
+	if(events == 0 || events > TRACE_MAX_EVENTS)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;
+	}
+
+	if(TracingEnabled)
+	{
+		ret = IPC_EEXIST;
+		goto restore_and_return;
+	}
+
+	//the ring is kept for the rest of the boot, unless a different size is requested
+	if(TraceCapacity != events)
+	{
+		if(TraceEvents != NULL)
+			FreeOnHeap(KernelHeapId, TraceEvents);
+
+		TraceCapacity = 0;
+		TraceEvents = AllocateOnHeap(KernelHeapId, events * sizeof(TraceEvent));
+		if(TraceEvents == NULL)
+		{
+			ret = IPC_ENOMEM;
+			goto restore_and_return;
+		}
+		TraceCapacity = events;
+	}
+
+	TraceHead = 0;
+	TraceUsed = 0;
+	TracingEnabled = 1;
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
+s32 StopTracing(void)
+{
+	if(!CurrentProcessIsOwner(TRACE_OWNERS))
+		return IPC_EACCES;
+
+	TracingEnabled = 0;
+	return IPC_SUCCESS;
+}
+
+//prints the raw events, oldest first, for tools/trace2json.py to convert
+s32 DumpTraceEvents(void)
+{
+	if(!CurrentProcessIsOwner(TRACE_OWNERS))
+		return IPC_EACCES;
+
+	if(TracingEnabled)
+		return IPC_NOTREADY;
+
+	gecko_printf("trace: begin %d events %d ticks per ms\n", TraceUsed, ConvertDelayToTicks(1000));
+	u32 index = TraceUsed < TraceCapacity ? 0 : TraceHead;
+	for(u32 i = 0; i < TraceUsed; i++)
+	{
+		const TraceEvent* event = &TraceEvents[index];
+		gecko_printf("trace: %08x %04x%04x %08x %08x\n", event->Timestamp, event->Event, event->ThreadId, event->Argument1, event->Argument2);
+		index++;
+		if(index >= TraceCapacity)
+			index = 0;
+	}
+	gecko_printf("trace: end\n");
+	return IPC_SUCCESS;
+}
@@ -0,0 +1,55 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	trace - record kernel events in a ring buffer
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <types.h>
+
+#define TRACE_MAX_EVENTS	0x4000
+
+typedef enum
+{
+	TraceSchedule = 0,			//thread switched in. arguments : process id, priority
+	TraceUnblockThread = 1,		//arguments : thread id, return value
+	TraceSendMessage = 2,		//arguments : queue id, message
+	TraceReceiveMessage = 3,	//arguments : queue id, message
+	TraceResourceReply = 4,		//arguments : ipc message, return value
+	TraceIrqEntry = 5,			//arguments : pending irq flags, 0
+	TraceIrqExit = 6,			//arguments : handled irq flags, ticks spent
+	TraceTimerFire = 7,			//arguments : timer, message
+} TraceEventId;
+
+//a single event as it is stored in the ring & dumped
+typedef struct
+{
+	u32 Timestamp;
+	u16 Event;
+	u16 ThreadId;
+	u32 Argument1;
+	u32 Argument2;
+} TraceEvent;
+CHECK_SIZE(TraceEvent, 0x10);
+
+extern u8 TracingEnabled;
+
+void RecordTraceEvent(const TraceEventId event, const u32 argument1, const u32 argument2);
+s32 StartTracing(u32 events);
+s32 StopTracing(void);
+s32 DumpTraceEvents(void);
+
+//tracepoints cost a single branch while tracing is disabled
+#define TRACE(event, argument1, argument2) \
+	do { \
+		if(__builtin_expect(TracingEnabled, 0)) \
+			RecordTraceEvent(event, (u32)(argument1), (u32)(argument2)); \
+	} while(0)
+
+#endif
@@ -31,6 +31,7 @@ Copyright (C) 2009		John Kelley <wiidev@kelley.ca>
 #include "scheduler/timer.h"
 #include "scheduler/threads.h"
 #include "interrupt/irq.h"
+#include "interrupt/deferredWork.h"
 #include "peripherals/usb.h"
 #include "peripherals/powerpc.h"
 #include "crypto/aes.h"
@@ -125,6 +126,15 @@ void kernel_main( void )
 	if( ret < 0 || StartThread(threadId) < 0 )
 		panic("failed to start IRQ thread!\n");
 
+	//create the thread running the bottom halves of the irq handlers, as a system thread
+	ret = CreateThread((u32)DeferredWorkHandler, NULL, NULL, 0, DEFERRED_WORK_PRIORITY, 1);
+	threadId = ret;
+	if(ret >= 0)
+		Threads[threadId].ThreadContext.StatusRegister |= SPSR_SYSTEM_MODE;
+
+	if( ret < 0 || StartThread(threadId) < 0 )
+		panic("failed to start deferred work thread!\n");
+
 	//not sure what this is about, if you know please let us know.
 	u32 hardwareVersion, hardwareRevision;
 	GetHollywoodVersion(&hardwareVersion,&hardwareRevision);
@@ -215,6 +225,7 @@ void kernel_main( void )
 		if(header.p_filesz < header.p_memsz)
 			memset((void*)(header.p_vaddr + header.p_filesz), 0, header.p_memsz - header.p_filesz);
 	}
+	PrintMemoryMappingStatistics();
 
 	const u32 modules_cnt = __modules_size / sizeof(ModuleInfo);
 	for(u32 i = 0; i < modules_cnt;i++)
@@ -234,6 +245,12 @@ void kernel_main( void )
 	}
 
 	KernelHeapId = CreateHeap((void*)__headers_addr, 0xC0000);
+#ifdef MEMCPY_BENCHMARK
+	BenchmarkMemoryCopy();
+#endif
+#ifdef TIMER_BENCHMARK
+	BenchmarkTimers();
+#endif
 	printk("$IOSVersion: IOSP: %s %s 64M $", __DATE__, __TIME__);
 	SetThreadPriority(0, 0);
 	SetThreadPriority(IpcHandlerThreadId, 0x5C);
@@ -369,6 +386,7 @@ void InitialiseSystem( void )
 	InitializeGPIO();
 #endif
 	write32(HW_ALARM, 0);
+	InitializeTimerConversion();
 	write32(NAND_CMD, 0);
 	write32(AES_CMD, 0);
 	write32(SHA_CMD, 0);
@@ -381,6 +399,7 @@ void InitialiseSystem( void )
 #ifndef MIOS
 	gecko_printf("Configuring caches and MMU...\n");
 	InitializeMemory();
+	CalibrateCacheOperations();
 #else
 	//lol, mios explicitly disables the debug interface
 	write32(HW_DBGINTEN, 0);
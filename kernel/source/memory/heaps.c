@@ -171,7 +171,7 @@ void* MallocateOnHeap(s32 heapid, u32 size, u32 alignment)
 	//mark block as in use & remove it from our available heap
 	blockToAllocate->BlockState = HeapBlockInUse;
 	blockToAllocate->NextBlock = NULL;
-	blockToAllocate->PreviousBlock = NULL;
+	blockToAllocate->Alignment = alignment;
 	
 	//add the block header infront of the allocated space if needed (because of alignment)
 	currentBlock = (HeapBlock*)(((u32)blockToAllocate) + alignedOffset);
@@ -213,37 +213,32 @@ int MergeNextBlockIfUnused(HeapBlock* parentBlock)
 	return 1;
 }
 
-s32 FreeOnHeap(s32 heapid, void* ptr)
+//verifies the pointer and returns the in use block it belongs to
+static HeapBlock* GetUsedHeapBlock(s32 heapid, void* ptr)
 {
-	u32 irqState = DisableInterrupts();
-	s32 ret = 0;
-	
 	//verify incoming parameters & if the heap is in use
-	if(heapid < 0 || heapid >= 0x10 || ptr == NULL || heaps[heapid].Heap == NULL)
-	{
-		ret = IPC_EINVAL;
-		goto restore_and_return;
-	}
+	if(heapid < 0 || heapid >= MAX_HEAP || ptr == NULL || heaps[heapid].Heap == NULL)
+		return NULL;
 	
 	//verify the pointer address
 	if( ptr < (heaps[heapid].Heap + sizeof(HeapBlock)) || ptr >= (heaps[heapid].Heap + heaps[heapid].Size) )
-	{
-		ret = IPC_EINVAL;
-		goto restore_and_return;
-	}
+		return NULL;
 	
 	//verify the block that the pointer belongs to
-	HeapBlock* blockToFree = (HeapBlock*)(ptr-sizeof(HeapBlock));
+	HeapBlock* block = (HeapBlock*)(ptr-sizeof(HeapBlock));
 	
-	if(blockToFree->BlockState == HeapBlockAligned)
-		blockToFree = blockToFree->NextBlock;
+	if(block->BlockState == HeapBlockAligned)
+		block = block->NextBlock;
 	
-	if(blockToFree == NULL || blockToFree->BlockState != HeapBlockInUse)
-	{
-		ret = IPC_EINVAL;
-		goto restore_and_return;
-	}
+	if(block == NULL || block->BlockState != HeapBlockInUse)
+		return NULL;
 	
+	return block;
+}
+
+//adds the block to the list of free blocks, which is sorted by address, and merges it with its neighbours
+static void InsertFreeBlock(s32 heapid, HeapBlock* blockToFree)
+{
 	HeapBlock* firstBlock = heaps[heapid].FirstBlock;
 	HeapBlock* currBlock = firstBlock;
 	HeapBlock* nextBlock = NULL;
@@ -280,7 +275,102 @@ s32 FreeOnHeap(s32 heapid, void* ptr)
 	//merge blocks if we can
 	MergeNextBlockIfUnused(blockToFree);
 	MergeNextBlockIfUnused(blockToFree->PreviousBlock);
+}
+
+s32 FreeOnHeap(s32 heapid, void* ptr)
+{
+	u32 irqState = DisableInterrupts();
+	s32 ret = 0;
+	
+	HeapBlock* blockToFree = GetUsedHeapBlock(heapid, ptr);
+	if(blockToFree == NULL)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;
+	}
+	
+	InsertFreeBlock(heapid, blockToFree);
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
 
+//grows the block by taking in the free block right behind it, if there is one and its big enough
+static int GrowBlockInPlace(s32 heapid, HeapBlock* block, u32 requiredSize)
+{
+	HeapBlock* adjacentBlock = (HeapBlock*)(((u32)block) + block->Size);
+	HeapBlock* freeBlock = heaps[heapid].FirstBlock;
+	while(freeBlock != NULL && freeBlock < adjacentBlock)
+		freeBlock = freeBlock->NextBlock;
+	
+	if(freeBlock == NULL || freeBlock != adjacentBlock || block->Size + freeBlock->Size < requiredSize)
+		return 0;
+	
+	//remove the free block from the heap list
+	if(freeBlock->PreviousBlock == NULL)
+		heaps[heapid].FirstBlock = freeBlock->NextBlock;
+	else
+		freeBlock->PreviousBlock->NextBlock = freeBlock->NextBlock;
+	
+	if(freeBlock->NextBlock != NULL)
+		freeBlock->NextBlock->PreviousBlock = freeBlock->PreviousBlock;
+	
+	block->Size += freeBlock->Size;
+	return 1;
+}
+
+void* ReallocateOnHeap(s32 heapid, void* ptr, u32 newSize)
+{
+	if(ptr == NULL)
+		return AllocateOnHeap(heapid, newSize);
+	
+	u32 irqState = DisableInterrupts();
+	void* ret = NULL;
+	
+	HeapBlock* block = GetUsedHeapBlock(heapid, ptr);
+	if(block == NULL || heaps[heapid].Size < newSize)
+		goto restore_and_return;
+
+	//like realloc, a size of 0 frees the block & returns NULL
+	if(newSize == 0)
+	{
+		FreeOnHeap(heapid, ptr);
+		goto restore_and_return;
+	}
+	
+	//the data can be further in the block because of alignment, so take that into account
+	u32 dataOffset = (u32)ptr - (u32)block;
+	u32 usedSize = block->Size - dataOffset;
+	u32 requiredSize = dataOffset + ((newSize + 0x1F) & 0xFFFFFFE0);
+	
+	if(requiredSize <= block->Size || GrowBlockInPlace(heapid, block, requiredSize))
+	{
+		//clear the space we gained, like a fresh allocation would be
+		if(newSize > usedSize)
+			memset(((u8*)ptr) + usedSize, 0, newSize - usedSize);
+		
+		//split off what we don't need, if its big enough to be a block of its own
+		if(block->Size - requiredSize > ALIGNED_BLOCK_HEADER_SIZE)
+		{
+			HeapBlock* freeBlock = (HeapBlock*)(((u32)block) + requiredSize);
+			freeBlock->Size = block->Size - requiredSize;
+			block->Size = requiredSize;
+			InsertFreeBlock(heapid, freeBlock);
+		}
+		
+		ret = ptr;
+		goto restore_and_return;
+	}
+	
+	//nothing we can do in place. allocate a new block with the alignment it was allocated with & move the data
+	ret = MallocateOnHeap(heapid, newSize, block->Alignment);
+	if(ret == NULL)
+		goto restore_and_return;
+	
+	memcpy(ret, ptr, usedSize < newSize ? usedSize : newSize);
+	FreeOnHeap(heapid, ptr);
+	
 restore_and_return:
 	RestoreInterrupts(irqState);
 	return ret;
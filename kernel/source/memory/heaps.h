@@ -24,13 +24,18 @@ typedef struct HeapBlock
 {
 	HeapBlockState BlockState;
 	u32 Size;
-	struct HeapBlock* PreviousBlock;
+	union {
+		struct HeapBlock* PreviousBlock;
+		//blocks in use aren't in the free list, so they keep the alignment they were allocated with here
+		u32 Alignment;
+	};
 	struct HeapBlock* NextBlock;
 } HeapBlock;
 CHECK_SIZE(HeapBlock, 0x10);
 CHECK_OFFSET(HeapBlock, 0x00, BlockState);
 CHECK_OFFSET(HeapBlock, 0x04, Size);
 CHECK_OFFSET(HeapBlock, 0x08, PreviousBlock);
+CHECK_OFFSET(HeapBlock, 0x08, Alignment);
 CHECK_OFFSET(HeapBlock, 0x0C, NextBlock);
 
 typedef struct
@@ -53,5 +58,8 @@ s32 DestroyHeap(s32 heapid);
 void* MallocateOnHeap(s32 heapid, u32 size, u32 alignment);
 void* AllocateOnHeap(s32 heapid, u32 size);
 s32 FreeOnHeap(s32 heapid, void* ptr);
+//keeps the alignment ptr was allocated with. a NULL ptr allocates, a newSize of 0 frees ptr & returns NULL.
+//on failure NULL is returned & ptr stays allocated
+void* ReallocateOnHeap(s32 heapid, void* ptr, u32 newSize);
 
 #endif
\ No newline at end of file
@@ -20,6 +20,7 @@ Copyright (C) 2021			DacoTaco
 #include "utils.h"
 
 //#define NO_CACHES
+//#define CACHE_BENCHMARK
 
 #define LINESIZE 			0x20
 #define CACHESIZE 			0x4000
@@ -56,6 +57,17 @@ Copyright (C) 2021			DacoTaco
 #define ALIGN_FORWARD(addr)			((typeof(addr))((((u32)(addr)) + (LINESIZE) - 1) & (~(u32)(LINESIZE-1))))
 #define ALIGN_BACKWARD(addr)		((typeof(addr))(((u32)(addr)) & (~(u32)(LINESIZE-1))))
 
+//calibration of the per line vs whole cache crossover
+#define CALIBRATION_ROUNDS			8
+#define MIN_CACHE_THRESHOLD			(LINESIZE * 0x10)
+#define MAX_CACHE_THRESHOLD			(CACHESIZE * 4)
+
+//size of a level 2 (course) page table
+#define COURSEPAGE_TABLE_SIZE		0x400
+
+//amount of validated ranges we remember per process
+#define VALIDATED_RANGES_PER_PROCESS	4
+
 void _dc_inval_entries(const void *start, int count);
 void _dc_flush_entries(const void *start, int count);
 void _dc_flush(void);
@@ -87,6 +99,25 @@ u32* MemoryTranslationTable = NULL;
 u32 DomainAccessControlTable[MAX_PROCESSES];
 u32* HardwareRegistersAccessTable[MAX_PROCESSES];
 
+//cache of ranges that recently passed CheckMemoryPointer, so modules reusing the same buffers
+//don't have to walk the translation table on every syscall. End == 0 marks an unused entry.
+//the hardware registers entry (0xD0) is swapped on every process switch, so ranges in it are never cached
+typedef struct
+{
+	u32 Start;
+	u32 End;
+	u32 Type;
+	u32 DomainPid;
+} ValidatedRange;
+
+static ValidatedRange ValidatedRanges[MAX_PROCESSES][VALIDATED_RANGES_PER_PROCESS];
+static u8 ValidatedRangesNextEntry[MAX_PROCESSES];
+u32 ValidatedRangesHits = 0;
+u32 ValidatedRangesMisses = 0;
+
+//amount of translation table entries written, per domain. the per process numbers are summed from these through the dacr table
+static MappingStatistics MappingStats[MAX_DOMAINS];
+
 static MemorySection KernelMemoryMaps[] = 
 {
 	// physical							virtual								size							domain			access		 IsCached
@@ -116,21 +147,48 @@ static ProcessMemorySection HWRegistersMemoryMaps[] =
 };
 #endif
 
-void DCFlushRange(const void *start, u32 size)
+//sizes from which on it is cheaper to work on the whole cache instead of per line.
+//these start off at the cache size and get replaced by CalibrateCacheOperations
+static u32 CacheFlushThreshold = CACHESIZE;
+static u32 CacheInvalidateThreshold = CACHESIZE;
+
+//returns 1 if the whole cache was flushed
+static u32 _DCFlushRange(const void *start, u32 size)
 {
-	if(size == 0)
-		return;
+	if(size <= CacheFlushThreshold)
+	{
+		const void* end = ALIGN_FORWARD(((const u8*)start) + size);
+		start = ALIGN_BACKWARD(start);
+		_dc_flush_entries(start, MEMBLOCK_COUNT((u32)start, (u32)end) );
+		return 0;
+	}
 	
-	u32 cookie = DisableInterrupts();
-	if(size <= 0x4000)
+	_dc_flush();
+	return 1;
+}
+
+//returns 1 if the whole cache was invalidated
+static u32 _DCInvalidateRange(const void *start, u32 size)
+{
+	if(size <= CacheInvalidateThreshold)
 	{
+		const void* end = ALIGN_FORWARD(((const u8*)start) + size);
 		start = ALIGN_BACKWARD(start);
-		void* end = ALIGN_FORWARD(((u8*)start) + size);
-		_dc_flush_entries(start, MEMBLOCK_COUNT(start, end) );
+		_dc_inval_entries(start, MEMBLOCK_COUNT((u32)start, (u32)end) );
+		return 0;
 	}
-	else
-		_dc_flush();
 	
+	_dc_invalidate();
+	return 1;
+}
+
+void DCFlushRange(const void *start, u32 size)
+{
+	if(size == 0)
+		return;
+	
+	u32 cookie = DisableInterrupts();
+	_DCFlushRange(start, size);
 	FlushMemory();
 	_ahb_flush_from(AHB_1);
 	RestoreInterrupts(cookie);
@@ -160,17 +218,177 @@ void DCInvalidateRange(const void* start, u32 size)
 		return;
 	
 	u32 cookie = DisableInterrupts();
-	if(size <= 0x4000)
+	_DCInvalidateRange(start, size);
+	AhbFlushTo(AHB_STARLET);
+	RestoreInterrupts(cookie);
+}
+
+//does several flush/invalidate requests with interrupts disabled once and
+//only drains the write buffer & ahb once at the end
+void DCRangeOperations(const CacheRangeOperation* operations, u32 count)
+{
+	if(operations == NULL || count == 0)
+		return;
+	
+#ifndef MIOS
+	u32 pid = CurrentThread->ProcessId;
+#endif
+	u32 flushed = 0;
+	u32 invalidated = 0;
+	u32 wholeCacheFlushed = 0;
+	u32 cookie = DisableInterrupts();
+	
+	for(u32 i = 0; i < count; i++)
 	{
-		start = ALIGN_BACKWARD(start);
-		void* end = ALIGN_FORWARD(((u8*)start) + size);
-		_dc_inval_entries(start, MEMBLOCK_COUNT(start, end) );
+		const void* start = operations[i].Start;
+		u32 size = operations[i].Size;
+		if(size == 0)
+			continue;
+
+		switch(operations[i].Operation)
+		{
+			case CacheFlush:
+				//the cache is already clean, nothing left to write back
+				if(wholeCacheFlushed)
+					break;
+
+				wholeCacheFlushed = _DCFlushRange(start, size);
+				flushed = 1;
+				break;
+			case CacheInvalidate:
+#ifndef MIOS
+				if(CheckMemoryPointer(start, size, 4, pid, 0) != 0)
+				{
+					gecko_printf("bad invalidate requested: %08x (%d)\n", (u32)start, size);
+					break;
+				}
+#endif
+				//a whole cache invalidate also writes back all dirty lines
+				if(_DCInvalidateRange(start, size))
+					wholeCacheFlushed = 1;
+				invalidated = 1;
+				break;
+			default:
+				break;
+		}
 	}
-	else
+	
+	if(flushed)
+	{
+		FlushMemory();
+		_ahb_flush_from(AHB_1);
+	}
+	
+	if(invalidated)
+		AhbFlushTo(AHB_STARLET);
+	
+	RestoreInterrupts(cookie);
+}
+
+static void DirtyCacheLines(volatile u32* start, u32 size)
+{
+	//write back the value we read so the line gets marked dirty without changing memory
+	for(u32 i = 0; i < size / 4; i += LINESIZE / 4)
+		start[i] = start[i];
+}
+
+static u32 CalculateCacheThreshold(u32 lineTicks, u32 cacheTicks)
+{
+	//both measurements were taken over CACHESIZE bytes. if the lines were too quick for the timer, keep the default
+	if(lineTicks == 0)
+		return CACHESIZE;
+	
+	u32 threshold = ALIGN_BACKWARD((cacheTicks * CACHESIZE) / lineTicks);
+	if(threshold < MIN_CACHE_THRESHOLD)
+		threshold = MIN_CACHE_THRESHOLD;
+	else if(threshold > MAX_CACHE_THRESHOLD)
+		threshold = MAX_CACHE_THRESHOLD;
+	
+	return threshold;
+}
+
+#ifdef CACHE_BENCHMARK
+static void BenchmarkCacheOperations(volatile u32* buffer)
+{
+	CacheRangeOperation operations[8];
+	u32 blockSize = CACHESIZE / 8;
+	u32 separateTicks = 0;
+	u32 batchedTicks = 0;
+	
+	for(u32 i = 0; i < 8; i++)
+	{
+		operations[i].Start = (const void*)((u32)buffer + (i * blockSize));
+		operations[i].Size = blockSize;
+		operations[i].Operation = CacheFlush;
+	}
+	
+	for(u32 round = 0; round < CALIBRATION_ROUNDS; round++)
+	{
+		DirtyCacheLines(buffer, CACHESIZE);
+		u32 start = read32(HW_TIMER);
+		for(u32 i = 0; i < 8; i++)
+			DCFlushRange(operations[i].Start, operations[i].Size);
+		separateTicks += read32(HW_TIMER) - start;
+		
+		DirtyCacheLines(buffer, CACHESIZE);
+		start = read32(HW_TIMER);
+		DCRangeOperations(operations, 8);
+		batchedTicks += read32(HW_TIMER) - start;
+	}
+	
+	gecko_printf("MEM: 8x0x%X flush : separate %d ticks, batched %d ticks\n", blockSize, separateTicks, batchedTicks);
+}
+#endif
+
+//measure what a per line operation costs compared to a whole cache operation on this core clock.
+//the calibration buffer is kernel owned & cached memory, and interrupts are disabled while we use it
+void CalibrateCacheOperations(void)
+{
+	volatile u32* buffer = (volatile u32*)__thread_stacks_area_start;
+	u32 flushLineTicks = 0;
+	u32 flushCacheTicks = 0;
+	u32 invalidateLineTicks = 0;
+	u32 invalidateCacheTicks = 0;
+	u32 start;
+	
+	u32 cookie = DisableInterrupts();
+	for(u32 round = 0; round < CALIBRATION_ROUNDS; round++)
+	{
+		DirtyCacheLines(buffer, CACHESIZE);
+		start = read32(HW_TIMER);
+		_dc_flush_entries((const void*)buffer, CACHESIZE / LINESIZE);
+		flushLineTicks += read32(HW_TIMER) - start;
+		
+		DirtyCacheLines(buffer, CACHESIZE);
+		start = read32(HW_TIMER);
+		_dc_flush();
+		flushCacheTicks += read32(HW_TIMER) - start;
+		
+		//clean the lines first, so dropping them doesn't lose any data
+		DirtyCacheLines(buffer, CACHESIZE);
+		_dc_flush_entries((const void*)buffer, CACHESIZE / LINESIZE);
+		start = read32(HW_TIMER);
+		_dc_inval_entries((const void*)buffer, CACHESIZE / LINESIZE);
+		invalidateLineTicks += read32(HW_TIMER) - start;
+		
+		DirtyCacheLines(buffer, CACHESIZE);
+		start = read32(HW_TIMER);
 		_dc_invalidate();
+		invalidateCacheTicks += read32(HW_TIMER) - start;
+	}
 	
-	AhbFlushTo(AHB_STARLET);
+	FlushMemory();
+	CacheFlushThreshold = CalculateCacheThreshold(flushLineTicks, flushCacheTicks);
+	CacheInvalidateThreshold = CalculateCacheThreshold(invalidateLineTicks, invalidateCacheTicks);
 	RestoreInterrupts(cookie);
+	
+	gecko_printf("MEM: core clock 0x%X, flush %d/%d ticks, invalidate %d/%d ticks\n", GetCoreClock(), 
+		flushLineTicks, flushCacheTicks, invalidateLineTicks, invalidateCacheTicks);
+	gecko_printf("MEM: cache thresholds : flush 0x%X, invalidate 0x%X\n", CacheFlushThreshold, CacheInvalidateThreshold);
+	
+#ifdef CACHE_BENCHMARK
+	BenchmarkCacheOperations(buffer);
+#endif
 }
 
 void ICInvalidateAll(void)
@@ -290,7 +508,8 @@ s32 MapMemoryAsSection(MemorySection* memorySection)
 	
 	u32* page = &MemoryTranslationTable[PAGE_ENTRY(memorySection->VirtualAddress)];
 	*page = translationBase | (memorySection->PhysicalAddress & 0xFFF00000) | AP_VALUE(memorySection->AccessRights) | PAGE_DOMAIN(memorySection->Domain);
-	DCFlushRange(page, 4);
+	//the write buffer is drained by MapMemory once everything is mapped
+	_dc_flush_entries(ALIGN_BACKWARD(page), 1);
 	
 	memorySection->Size = memorySection->Size - 0x100000;
 	memorySection->PhysicalAddress = memorySection->PhysicalAddress + 0x100000;
@@ -332,6 +551,9 @@ s32 MapMemoryAsCoursePage(MemorySection* memorySection, u8 mode)
 			return IPC_ENOMEM;
 
 		*entry = (u32*)((0xFFFFFC00 & (u32)pageValue) | PAGE_DOMAIN(memorySection->Domain) | COURSE_PAGE);
+		//the mmu doesn't look in the cache when walking the tables, so the new (cleared) table has to reach memory
+		_dc_flush_entries(ALIGN_BACKWARD(entry), 1);
+		_dc_flush_entries(pageValue, COURSEPAGE_TABLE_SIZE / LINESIZE);
 	}
 	else
 	{
@@ -354,48 +576,113 @@ s32 MapMemoryAsCoursePage(MemorySection* memorySection, u8 mode)
 	if(memorySection->IsCached != 0)
 		type |= WRITEBACK_CACHE;
 
-	pageValue[COURSEPAGE_ENTRY_VALUE(memorySection->VirtualAddress)] = (memorySection->PhysicalAddress & 0xFFFFF000) | type | APX_VALUE(3, accessRights) | APX_VALUE(2, accessRights) | APX_VALUE(1, accessRights) | APX_VALUE(0, accessRights);
-	DCFlushRange(pageValue, 0x1000);
+	u32* pageEntry = &pageValue[COURSEPAGE_ENTRY_VALUE(memorySection->VirtualAddress)];
+	*pageEntry = (memorySection->PhysicalAddress & 0xFFFFF000) | type | APX_VALUE(3, accessRights) | APX_VALUE(2, accessRights) | APX_VALUE(1, accessRights) | APX_VALUE(0, accessRights);
+	_dc_flush_entries(ALIGN_BACKWARD(pageEntry), 1);
 	memorySection->Size -= 0x1000;
 	memorySection->PhysicalAddress += 0x1000;
 	memorySection->VirtualAddress += 0x1000;
 	return 0;
 }
 
+static s32 MapMemoryAsCoursePages(MemorySection* memorySection, u32 size)
+{
+	s32 ret = 0;
+	MappingStatistics* stats = &MappingStats[memorySection->Domain % MAX_DOMAINS];
+	for(u32 mapped = 0; ret == 0 && mapped < size; mapped += 0x1000)
+	{
+		ret = MapMemoryAsCoursePage(memorySection, 0);
+		if(ret == 0)
+			stats->CoursePages++;
+	}
+	
+	return ret;
+}
+
 //basically mmap
 s32 MapMemory(MemorySection* entry)
 {
 	if(entry == NULL)
 		return IPC_EINVAL;
 	
+	//the translation table is about to change, so any previous pointer validation is stale
+	InvalidateMemoryPointerCache();
+	
 	MemorySection memorySection;
 	memcpy(&memorySection, entry, sizeof(MemorySection));
 	
-	s32 ret = 0;
-	while(ret == 0 && memorySection.Size > 0)
+	//page table entries on arm are either 1MB (section) or at least 4KB (level 2 section)
+	if((memorySection.VirtualAddress & 0xFFF) != 0 || (memorySection.PhysicalAddress & 0xFFF) != 0 || (memorySection.Size & 0xFFF) != 0)
+		return IPC_EINVAL;
+	
+	//if the virtual & physical address have the same offset within a section, everything between the first and
+	//last section boundary can be mapped as sections. only the unaligned head & tail need course pages then.
+	u32 headSize = memorySection.Size;
+	if(((memorySection.VirtualAddress ^ memorySection.PhysicalAddress) & 0xFFFFF) == 0)
 	{
-		if(memorySection.Size == 0)
-			break;
-		
-		//page table entries on arm are either 1MB (section) or at least 4KB (level 2 section)
-		if((memorySection.VirtualAddress & 0xFFFFF) == 0 && (memorySection.PhysicalAddress & 0xFFFFF) == 0 && memorySection.Size >= 0xFFFFF)
-			ret = MapMemoryAsSection(&memorySection);
-		else if( ((memorySection.VirtualAddress & 0xFFF) != 0 || (memorySection.PhysicalAddress & 0xFFF) != 0) || memorySection.Size < 0x1000)
-		{
-			ret = IPC_EINVAL;
-			break;
-		}
-		else
-		{
-			ret = MapMemoryAsCoursePage(&memorySection, 0);
-		}
+		headSize = (0x100000 - (memorySection.VirtualAddress & 0xFFFFF)) & 0xFFFFF;
+		if(headSize > memorySection.Size)
+			headSize = memorySection.Size;
 	}
-		
+	u32 sectionsSize = (memorySection.Size - headSize) & 0xFFF00000;
+	u32 tailSize = memorySection.Size - headSize - sectionsSize;
+	
+	MappingStatistics* stats = &MappingStats[memorySection.Domain % MAX_DOMAINS];
+	s32 ret = MapMemoryAsCoursePages(&memorySection, headSize);
+	for(u32 mapped = 0; ret == 0 && mapped < sectionsSize; mapped += 0x100000)
+	{
+		ret = MapMemoryAsSection(&memorySection);
+		if(ret == 0)
+			stats->Sections++;
+	}
+	
+	if(ret == 0)
+		ret = MapMemoryAsCoursePages(&memorySection, tailSize);
+	
 	FlushMemory();
 	TlbInvalidate();
 	return ret;
 }
 
+//the entries a process can hit are those of every domain its dacr gives it access to, including the shared ones
+static void SumProcessMappingStatistics(const u32 processId, MappingStatistics* statistics)
+{
+	statistics->Sections = 0;
+	statistics->CoursePages = 0;
+	for(u32 domain = 0; domain < MAX_DOMAINS; domain++)
+	{
+		if(((DomainAccessControlTable[processId] >> (domain * 2)) & 3) == DOMAIN_NOACCESS)
+			continue;
+
+		statistics->Sections += MappingStats[domain].Sections;
+		statistics->CoursePages += MappingStats[domain].CoursePages;
+	}
+}
+
+s32 GetMemoryMappingStatistics(const u32 processId, MappingStatistics* statistics)
+{
+	if(processId >= MAX_PROCESSES)
+		return IPC_EINVAL;
+
+	if(CheckMemoryPointer(statistics, sizeof(MappingStatistics), 4, CurrentThread->ProcessId, 0) < 0)
+		return IPC_EINVAL;
+
+	u32 cookie = DisableInterrupts();
+	SumProcessMappingStatistics(processId, statistics);
+	RestoreInterrupts(cookie);
+	return IPC_SUCCESS;
+}
+
+void PrintMemoryMappingStatistics(void)
+{
+	MappingStatistics statistics;
+	for(u32 processId = 0; processId < MAX_PROCESSES; processId++)
+	{
+		SumProcessMappingStatistics(processId, &statistics);
+		gecko_printf("MEM: pid %d : %d sections, %d course pages\n", processId, statistics.Sections, statistics.CoursePages);
+	}
+}
+
 s32 MapHardwareRegisters()
 {
 	u32** page = (u32**) &MemoryTranslationTable[0xD0];
@@ -503,6 +790,41 @@ return_error:
 	return IPC_EACCES;
 }
 
+void InvalidateMemoryPointerCache(void)
+{
+	u32 cookie = DisableInterrupts();
+	memset(ValidatedRanges, 0, sizeof(ValidatedRanges));
+	memset(ValidatedRangesNextEntry, 0, sizeof(ValidatedRangesNextEntry));
+	RestoreInterrupts(cookie);
+}
+
+s32 GetMemoryPointerCacheStats(PointerCacheStatistics* statistics)
+{
+	if(CheckMemoryPointer(statistics, sizeof(PointerCacheStatistics), 4, CurrentThread->ProcessId, 0) < 0)
+		return IPC_EINVAL;
+
+	u32 cookie = DisableInterrupts();
+	statistics->Hits = ValidatedRangesHits;
+	statistics->Misses = ValidatedRangesMisses;
+	RestoreInterrupts(cookie);
+	return IPC_SUCCESS;
+}
+
+static s32 FindValidatedRange(u32 start, u32 end, u32 type, u32 pid, u32 domainPid)
+{
+	ValidatedRange* range = ValidatedRanges[pid];
+	for(u32 i = 0; i < VALIDATED_RANGES_PER_PROCESS; i++)
+	{
+		if(range[i].End == 0 || range[i].Type != type || range[i].DomainPid != domainPid)
+			continue;
+
+		if(start >= range[i].Start && end <= range[i].End)
+			return 1;
+	}
+	
+	return 0;
+}
+
 s32 CheckMemoryPointer(const void* ptr, u32 size, u32 type, u32 pid, u32 domainPid)
 {
 	if(pid == 0)
@@ -512,16 +834,55 @@ s32 CheckMemoryPointer(const void* ptr, u32 size, u32 type, u32 pid, u32 domainP
 	u32 blockSize;
 	u8* startAddress = (u8*)ptr;
 	u8* endAddress = startAddress + size;
+	
+	//a range that wraps around can't be cached, let the table walk deal with it.
+	//neither can one in the hardware registers, their entry depends on the process that is running
+	u32 cacheable = pid < MAX_PROCESSES && domainPid < MAX_PROCESSES && startAddress < endAddress
+		&& (PAGE_ENTRY((u32)startAddress) > 0xD0 || PAGE_ENTRY((u32)endAddress - 1) < 0xD0);
+	if(cacheable)
+	{
+		u32 cookie = DisableInterrupts();
+		s32 found = FindValidatedRange((u32)startAddress, (u32)endAddress, type, pid, domainPid);
+		if(found)
+			ValidatedRangesHits++;
+		else
+			ValidatedRangesMisses++;
+		RestoreInterrupts(cookie);
+		
+		if(found)
+			return 0;
+	}
+	
+	u32 rangeStart = 0;
 	while(startAddress < endAddress)
 	{
 		ret = CheckMemoryBlock(startAddress, type, pid, domainPid, &blockSize);
 		if(ret != 0)
 			return ret;
 		
+		//remember the start of the first block, the whole block was validated
+		if(startAddress == (u8*)ptr)
+			rangeStart = (u32)startAddress & -blockSize;
+		
 		//align to the next block
 		startAddress = (u8*)(((u32)startAddress + blockSize) & -blockSize);
 	}
 	
+	if(!cacheable)
+		return ret;
+	
+	//startAddress is now the end of the last validated block
+	u32 rangeEnd = (u32)startAddress;
+	u32 cookie = DisableInterrupts();
+	u8 index = ValidatedRangesNextEntry[pid];
+	ValidatedRange* range = &ValidatedRanges[pid][index];
+	range->Start = rangeStart;
+	range->End = rangeEnd;
+	range->Type = type;
+	range->DomainPid = domainPid;
+	ValidatedRangesNextEntry[pid] = (u8)((index + 1) % VALIDATED_RANGES_PER_PROCESS);
+	RestoreInterrupts(cookie);
+	
 	return ret;
 }
 
@@ -580,6 +941,7 @@ s32 InitializeMemory(void)
 	
 	//PID 15 is also special, it only gets access to domain 8
 	DomainAccessControlTable[15] = DOMAIN_VALUE(8, DOMAIN_CLIENT);
+	InvalidateMemoryPointerCache();
 	
 	//setup memory registers
 	SetDataFaultStatusRegister(0);
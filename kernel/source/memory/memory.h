@@ -93,17 +93,51 @@ typedef enum
 	Unknown = 1,
 	CoursePage = 2,
 } KernelMemoryType;
+
+//arm has 16 domains. the kernel gives every module its process id as domain
+#define MAX_DOMAINS				0x10
+
+typedef struct
+{
+	u32 Sections;
+	u32 CoursePages;
+} MappingStatistics;
+
+typedef struct
+{
+	u32 Hits;
+	u32 Misses;
+} PointerCacheStatistics;
+
+typedef enum
+{
+	CacheFlush = 0,
+	CacheInvalidate = 1,
+} CacheOperationType;
+
+typedef struct
+{
+	const void* Start;
+	u32 Size;
+	u32 Operation;
+} CacheRangeOperation;
 	
 #ifndef MIOS
 s32 InitializeMemory(void);
 void* KMalloc(u32 size);
 s32 MapMemory(MemorySection* entry);
+s32 GetMemoryMappingStatistics(const u32 processId, MappingStatistics* statistics);
+void PrintMemoryMappingStatistics(void);
 u32 VirtualToPhysical(u32 virtualAddress);
 s32 CheckMemoryPointer(const void* ptr, u32 size, u32 type, u32 pid, u32 domainPid);
+void InvalidateMemoryPointerCache(void);
+s32 GetMemoryPointerCacheStats(PointerCacheStatistics* statistics);
 #endif
 void ProtectMemory(int enable, void *start, void *end);
 void DCInvalidateRange(const void* start, u32 size);
 void DCFlushRange(const void *start, u32 size);
+void DCRangeOperations(const CacheRangeOperation* operations, u32 count);
+void CalibrateCacheOperations(void);
 void DCFlushAll(void);
 void ICInvalidateAll(void);
 u32 TlbInvalidate(void);
@@ -25,6 +25,7 @@ Copyright (C) 2009		John Kelley <wiidev@kelley.ca>
 #include "memory/memory.h"
 #include "messaging/ipc.h"
 #include "interrupt/irq.h"
+#include "interrupt/trace.h"
 #include "filedesc/filedesc_types.h"
 #include "filedesc/calls_async.h"
 
@@ -65,6 +66,9 @@ Copyright (C) 2009		John Kelley <wiidev@kelley.ca>
 #define IPC_TRIG_ACK		IPC_PPC_IY2
 
 #define IPC_MAX_FILENAME	0x1300
+//the cache operations on the buffers of a request are done this many at a time, with interrupts disabled &
+//the write buffer drained once per batch instead of once per buffer
+#define IPC_CACHE_BATCH		8
 
 #define MAX_IPCMESSAGES (MAX_THREADS + IPC_EXTRA_MESSAGES)
 
@@ -110,13 +114,34 @@ void SendIpcRequest(void)
 	mask32(HW_IPC_ARMCTRL, (u32)~(IPC_ARM_IX1 | IPC_ARM_IX2), (IpcCircBuf.WaitingInBufferAmount == (IPC_CIRCULAR_BUFFER_SIZE - 1) ? IPC_ARM_ACK_OUT : 0) | IPC_ARM_OUTGOING);
 }
 
+static void IoctlvCacheOperation(const IoctlvMessageData* vectors, const u32 vectorCount, const CacheOperationType operation)
+{
+	CacheRangeOperation operations[IPC_CACHE_BATCH];
+	u32 count = 0;
+	for(u32 i = 0; i < vectorCount; i++)
+	{
+		operations[count].Start = vectors[i].Data;
+		operations[count].Size = vectors[i].Length;
+		operations[count].Operation = operation;
+		count++;
+		if(count == IPC_CACHE_BATCH || i == vectorCount - 1)
+		{
+			DCRangeOperations(operations, count);
+			count = 0;
+		}
+	}
+}
+
 static void FlushAndSendRequest(IpcRequest *request)
 {
 	const u32 requestCommand = request->RequestCommand;
 	if (requestCommand == IOS_IOCTL)
 	{
-		DCFlushRange(request->Data.Ioctl.InputBuffer, request->Data.Ioctl.InputLength);
-		DCFlushRange(request->Data.Ioctl.IoBuffer, request->Data.Ioctl.IoLength);
+		const CacheRangeOperation operations[] = {
+			{ request->Data.Ioctl.InputBuffer, request->Data.Ioctl.InputLength, CacheFlush },
+			{ request->Data.Ioctl.IoBuffer, request->Data.Ioctl.IoLength, CacheFlush },
+		};
+		DCRangeOperations(operations, 2);
 	}
 	else if (requestCommand == IOS_READ)
 	{
@@ -125,10 +150,7 @@ static void FlushAndSendRequest(IpcRequest *request)
 	else if (requestCommand == IOS_IOCTLV)
 	{
 		const u32 totalArgc = request->Data.Ioctlv.InputArgc + request->Data.Ioctlv.IoArgc;
-		for(u32 i = 0; i < totalArgc; ++i)
-		{
-			DCFlushRange(request->Data.Ioctlv.Data[i].Data, request->Data.Ioctlv.Data[i].Length);
-		}
+		IoctlvCacheOperation(request->Data.Ioctlv.Data, totalArgc, CacheFlush);
 		DCFlushRange(request->Data.Ioctlv.Data, totalArgc * sizeof(IoctlvMessageData));
 	}
 
@@ -291,8 +313,11 @@ void IpcHandler(void)
 					ret = IPC_EACCES;
 					break;
 				}
-				DCInvalidateRange(messageFromPPC->Request.Data.Ioctl.InputBuffer, messageFromPPC->Request.Data.Ioctl.InputLength);
-				DCInvalidateRange(messageFromPPC->Request.Data.Ioctl.IoBuffer, messageFromPPC->Request.Data.Ioctl.IoLength);
+				const CacheRangeOperation operations[] = {
+					{ messageFromPPC->Request.Data.Ioctl.InputBuffer, messageFromPPC->Request.Data.Ioctl.InputLength, CacheInvalidate },
+					{ messageFromPPC->Request.Data.Ioctl.IoBuffer, messageFromPPC->Request.Data.Ioctl.IoLength, CacheInvalidate },
+				};
+				DCRangeOperations(operations, 2);
 
 				ret = IoctlFDAsync(filedescId, messageFromPPC->Request.Data.Ioctl.Ioctl, messageFromPPC->Request.Data.Ioctl.InputBuffer, messageFromPPC->Request.Data.Ioctl.InputLength,
 									messageFromPPC->Request.Data.Ioctl.IoBuffer, messageFromPPC->Request.Data.Ioctl.IoLength, messageQueue, messageFromPPC);
@@ -312,8 +337,6 @@ void IpcHandler(void)
 				{
 					if (messageFromPPC->Request.Data.Ioctlv.Data[i].Length != 0 && !ValidateAddress(messageFromPPC->Request.Data.Ioctlv.Data[i].Data, messageFromPPC->Request.Data.Ioctlv.Data[i].Length))
 						break;
-					
-					DCInvalidateRange(messageFromPPC->Request.Data.Ioctlv.Data[i].Data, messageFromPPC->Request.Data.Ioctlv.Data[i].Length);
 				}
 
 				if(i != totalArgc)
@@ -322,6 +345,8 @@ void IpcHandler(void)
 					break;
 				}
 
+				IoctlvCacheOperation(messageFromPPC->Request.Data.Ioctlv.Data, totalArgc, CacheInvalidate);
+
 				ret = IoctlvFDAsync(filedescId, messageFromPPC->Request.Data.Ioctlv.Ioctl, messageFromPPC->Request.Data.Ioctlv.InputArgc, 
 									messageFromPPC->Request.Data.Ioctlv.IoArgc, messageFromPPC->Request.Data.Ioctlv.Data, messageQueue, messageFromPPC);
 				break;
@@ -383,6 +408,7 @@ s32 ResourceReply(IpcMessage* message, s32 requestReturnValue)
 	if( ! (queue == NULL || (message->IsInQueue != 0 && message->UsedByProcessId == CurrentThread->ProcessId)) )
 		goto restore_and_return;
 
+	TRACE(TraceResourceReply, message, requestReturnValue);
 	message->Request.Result = requestReturnValue;
 	const int flag = queue != NULL;
 	if(queue != NULL)
@@ -12,7 +12,9 @@
 
 #include "core/defines.h"
 #include "interrupt/irq.h"
+#include "interrupt/trace.h"
 #include "scheduler/threads.h"
+#include "scheduler/timer.h"
 #include "memory/memory.h"
 #include "messaging/messageQueue.h"
 
@@ -191,6 +193,7 @@ s32 SendMessageToQueue(MessageQueue* messageQueue, void* message, u32 flags)
 #ifndef MIOS
 	SetDomainAccessControlRegister(DomainAccessControlTable[CurrentThread->ProcessId]);
 #endif
+	TRACE(TraceSendMessage, messageQueue - MessageQueues, message);
 	if(messageQueue->ReceiveThreadQueue.NextThread != NULL )
 		UnblockThread(&messageQueue->ReceiveThreadQueue, 0);
 
@@ -227,6 +230,47 @@ restore_and_return:
 	return ret;
 }
 
+s32 ReceiveMessageTimeout(const s32 queueId, void** message, u32 timeoutUs)
+{
+	u32 irqState = DisableInterrupts();
+	s32 ret = 0;
+
+	if(queueId < 0 || queueId >= MAX_MESSAGEQUEUES)
+	{
+		ret = IPC_EINVAL;
+		goto restore_and_return;
+	}
+
+#ifndef MIOS
+	ret = CheckMemoryPointer(message, 4, 4, CurrentThread->ProcessId, 0);
+	if(ret < 0)
+		goto restore_and_return;
+#endif
+
+	MessageQueue* messageQueue = &MessageQueues[queueId];
+	if(messageQueue->ProcessId != CurrentThread->ProcessId)
+	{
+		ret = IPC_EACCES;
+		goto restore_and_return;
+	}
+
+	//only arm the thread's timer if we actually have to wait. it wakes us with IPC_EQUEUEEMPTY
+	const u32 ticks = ConvertDelayToTicks(timeoutUs);
+	if(messageQueue->Used != 0 || ticks == 0)
+	{
+		ret = ReceiveMessageFromQueue(messageQueue, message, RegisteredEventHandler);
+		goto restore_and_return;
+	}
+
+	StartThreadTimer(CurrentThread, &messageQueue->ReceiveThreadQueue, ticks);
+	ret = ReceiveMessageFromQueue(messageQueue, message, None);
+	StopThreadTimer(CurrentThread);
+
+restore_and_return:
+	RestoreInterrupts(irqState);
+	return ret;
+}
+
 s32 ReceiveMessageFromQueue(MessageQueue* messageQueue, void **message, u32 flags)
 {
 	if(messageQueue == NULL)
@@ -246,6 +290,7 @@ s32 ReceiveMessageFromQueue(MessageQueue* messageQueue, void **message, u32 flag
 		used = messageQueue->Used;
 	}
 	
+	TRACE(TraceReceiveMessage, messageQueue - MessageQueues, messageQueue->QueueHeap[messageQueue->First]);
 	if(message != NULL)
 	{
 		*message = messageQueue->QueueHeap[messageQueue->First];
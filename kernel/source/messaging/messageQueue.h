@@ -49,6 +49,7 @@ s32 SendMessage(const s32 queueId, void* message, u32 flags);
 s32 SendMessageToQueue(MessageQueue* messageQueue, void* message, u32 flags);
 s32 ReceiveMessage(const s32 queueId, void **message, u32 flags);
 s32 ReceiveMessageFromQueue(MessageQueue* messageQueue, void **message, u32 flags);
+s32 ReceiveMessageTimeout(const s32 queueId, void** message, u32 timeoutUs);
 s32 SendMessageUnsafe(const s32 queueId, void* message, u32 flags);
 s32 ReceiveMessageUnsafe(const s32 queueId, void **message, u32 flags);
 
@@ -18,6 +18,7 @@ Copyright (C) 2008, 2009	Hector Martin "marcan" <marcan@marcansoft.com>
 #include "memory/memory.h"
 #include "messaging/ipc.h"
 #include "interrupt/irq.h"
+#include "interrupt/deferredWork.h"
 
 #include "nand.h"
 
@@ -234,6 +235,7 @@ void nand_erase_block(u32 pageno) {
 
 void nand_initialize(void)
 {
+	RegisterDeferredWork(IRQ_NAND, nand_irq);
 	nand_reset();
 	irq_enable(IRQ_NAND);
 }
@@ -19,10 +19,12 @@
 #include "core/iosElf.h"
 #include "interrupt/irq.h"
 #include "scheduler/threads.h"
+#include "interrupt/trace.h"
 #include "messaging/ipc.h"
 #include "filedesc/calls.h"
 #include "memory/memory.h"
 #include "memory/heaps.h"
+#include "scheduler/timer.h"
 
 #include "panic.h"
 
@@ -97,7 +99,7 @@ void ThreadQueue_RemoveThread( ThreadQueue* threadQueue, ThreadInfo* threadToRem
 			break;
 		}
 
-		threadQueue = (ThreadQueue*)thread->NextThread;
+		threadQueue = (ThreadQueue*)&thread->NextThread;
 		thread = thread->NextThread;
 	}
 
@@ -141,8 +143,15 @@ __attribute__((target("arm")))
 __attribute__ ((noreturn))
 void ScheduleYield( void )
 {
+#ifdef IRQ_OFF_TRACKING
+	//the next thread restores its own interrupt state, so the current section ends here
+	InterruptsRestored();
+#endif
 	CurrentThread = ThreadQueue_PopThread(&SchedulerQueue);
 	CurrentThread->ThreadState = Running;
+	if(PendingInterruptWakeups != 0)
+		RecordInterruptWakeup(CurrentThread);
+	TRACE(TraceSchedule, CurrentThread->ProcessId, CurrentThread->Priority);
 
 #ifndef MIOS
 	SetDomainAccessControlRegister(DomainAccessControlTable[CurrentThread->ProcessId]);
@@ -190,6 +199,7 @@ void YieldThread( void )
 void UnblockThread(ThreadQueue* threadQueue, s32 returnValue)
 {
 	ThreadInfo* nextThread = ThreadQueue_PopThread(threadQueue);
+	TRACE(TraceUnblockThread, nextThread - Threads, returnValue);
 	nextThread->ThreadContext.Registers[0] = (u32)returnValue;
 	nextThread->ThreadState = Ready;
 	
@@ -203,6 +213,15 @@ void UnblockThread(ThreadQueue* threadQueue, s32 returnValue)
 	}
 }
 
+//wake up a waiting thread, wherever it is in its queue. the caller is responsible for yielding to it
+void WakeThread(ThreadInfo* thread, s32 returnValue)
+{
+	ThreadQueue_RemoveThread(thread->ThreadQueue, thread);
+	thread->ThreadContext.Registers[0] = (u32)returnValue;
+	thread->ThreadState = Ready;
+	ThreadQueue_PushThread(&SchedulerQueue, thread);
+}
+
 //IOS Handlers
 s32 CreateThread(u32 main, void *arg, u32 *stack_top, u32 stacksize, u32 priority, u32 detached)
 {
@@ -347,6 +366,7 @@ s32 CancelThread(const s32 threadId, u32 return_value)
 	}
 	
 	threadToCancel->ReturnValue = return_value;	
+	StopThreadTimer(threadToCancel);
 	if(threadToCancel->ThreadState != Stopped)
 		ThreadQueue_RemoveThread(&SchedulerQueue, threadToCancel);		
 	
@@ -103,11 +103,19 @@ extern ThreadInfo* CurrentThread;
 extern ThreadInfo ThreadStartingState;
 extern ThreadQueue SchedulerQueue;
 
+//owners is a mask of process ids, bit n being pid n
+static inline bool CurrentProcessIsOwner(u32 owners)
+{
+	return ((1u << (CurrentThread->ProcessId & 0xff)) & owners) != 0;
+}
+
 void InitializeThreadContext(void);
 void ScheduleYield( void );
 void YieldThread( void );
 s32 YieldCurrentThread( ThreadQueue* threadQueue );
 void UnblockThread(ThreadQueue* threadQueue, s32 returnValue);
+void WakeThread(ThreadInfo* thread, s32 returnValue);
+void ThreadQueue_RemoveThread(ThreadQueue* threadQueue, ThreadInfo* threadToRemove);
 ThreadInfo* ThreadQueue_PopThread(ThreadQueue* queue);
 void ThreadQueue_PushThread( ThreadQueue* threadQueue, ThreadInfo* thread );
 s32 CreateThread(u32 main, void *arg, u32 *stack_top, u32 stacksize, u32 priority, u32 detached);
@@ -10,13 +10,17 @@
 
 #include <ios/processor.h>
 #include <ios/errno.h>
+#include <ios/gecko.h>
 #include <string.h>
 
 #include "core/defines.h"
 #include "core/hollywood.h"
 #include "interrupt/irq.h"
+#include "memory/heaps.h"
+#include "memory/memory.h"
 #include "messaging/messageQueue.h"
 #include "scheduler/timer.h"
+#include "interrupt/trace.h"
 #include "scheduler/threads.h"
 #include "panic.h"
 #include "utils.h"
@@ -30,12 +34,255 @@ const u8* TimerMainStack = NULL;
 
 
 u32 timerFrequency = 0;
-TimerInfo timers[MAX_TIMERS] SRAM_DATA ALIGNED(0x10);
-TimerInfo initialTimer = { 0, 0, NULL, NULL, 0, &initialTimer, &initialTimer };
-TimerInfo* CurrentTimer ALIGNED(0x10) = &initialTimer;
-u32 PreviousTimerValue = 0;
+//.data.sram is full with the threads & message queues, so the timers go in the kernel's .bss (SRAM_BSS) instead
+TimerInfo timers[MAX_TIMERS] SRAM_BSS ALIGNED(0x10);
+
+//the timer wheel buckets. a timer is put in the level of the highest 6 bit digit in which its expire time differs
+//from the wheel time, in the slot matching that digit of its expire time. timers that differ in the bits above the wheel
+//range go into the overflow bucket, which is re-sorted every time the wheel time crosses into the next range
+static TimerInfo* TimerBuckets[TIMER_BUCKETS] SRAM_DATA ALIGNED(0x10);
+//timers used by threads to sleep or to time out a wait. each thread has its own, so waiting never needs a timers[] slot.
+//like timers[], they are too big for .data.sram
+static TimerInfo ThreadTimers[MAX_THREADS] SRAM_BSS ALIGNED(0x10);
+static ThreadQueue SleepingThreads = { .NextThread = &ThreadStartingState };
+static u64 TimerBucketsUsed[TIMER_WHEEL_LEVELS] SRAM_DATA;
+static u32 WheelTime = 0;
+static u32 AlarmTime = 0;
+static u32 AlarmSet = 0;
+//upper bound on the time between alarms, used by the profiler to get a steady timer irq
+static u32 AlarmIntervalTicks = 0;
+static u32 CoalescedTimerInterrupts = 0;
+//µs <-> ticks multipliers in 16.16 fixed point, for the clock mode we booted in
+static u32 TicksPerMicrosecond = 0;
+static u32 MicrosecondsPerTick = 0;
+//the upper half of the monotonic clock & the last hardware timer value it was extended with
+static u32 ClockHigh = 0;
+static u32 ClockLastLow = 0;
+
+//the time a timer is sorted & fired at. timers with slack are moved to the roundest time within their window,
+//so timers with overlapping windows end up in the same bucket and are handled with a single alarm
+static u32 GetTimerDeadline(const TimerInfo* timerInfo)
+{
+	const u32 expireTime = timerInfo->ExpireTime;
+	const u32 latestTime = expireTime + timerInfo->SlackInTicks;
+	const u32 difference = expireTime ^ latestTime;
+	if(difference == 0)
+		return expireTime;
+
+	//keep every bit above & including the highest bit that differs within the window
+	const u32 mask = (1u << (31 - __builtin_clz(difference))) - 1;
+	return latestTime & ~mask;
+}
 
-u32 ConvertDelayToTicks(u32 delay)
+static void InsertTimer(TimerInfo* timerInfo)
+{
+	u32 bucket = TIMER_OVERFLOW_BUCKET;
+	u32 deadline = GetTimerDeadline(timerInfo);
+
+	//timers can only be put in the future of the wheel, so anything due is put on the next tick
+	if((s32)(deadline - WheelTime) <= 0)
+	{
+		timerInfo->ExpireTime = WheelTime + 1;
+		deadline = GetTimerDeadline(timerInfo);
+	}
+
+	const u32 difference = deadline ^ WheelTime;
+	if((difference >> TIMER_WHEEL_RANGE_BITS) == 0)
+	{
+		const u32 level = (u32)(31 - __builtin_clz(difference)) / TIMER_WHEEL_BITS;
+		const u32 slot = (deadline >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+		bucket = (level * TIMER_WHEEL_SLOTS) + slot;
+		TimerBucketsUsed[level] |= 1ULL << slot;
+	}
+
+	TimerInfo* nextTimer = TimerBuckets[bucket];
+	timerInfo->PreviousTimer = NULL;
+	timerInfo->NextTimer = nextTimer;
+	if(nextTimer != NULL)
+		nextTimer->PreviousTimer = timerInfo;
+
+	TimerBuckets[bucket] = timerInfo;
+	timerInfo->Bucket = (u16)(bucket + 1);
+}
+
+static void RemoveTimer(TimerInfo* timerInfo)
+{
+	if(timerInfo->Bucket == TIMER_NOT_QUEUED)
+		return;
+
+	const u32 bucket = (u32)timerInfo->Bucket - 1;
+	if(timerInfo->PreviousTimer != NULL)
+		timerInfo->PreviousTimer->NextTimer = timerInfo->NextTimer;
+	else
+		TimerBuckets[bucket] = timerInfo->NextTimer;
+
+	if(timerInfo->NextTimer != NULL)
+		timerInfo->NextTimer->PreviousTimer = timerInfo->PreviousTimer;
+
+	if(TimerBuckets[bucket] == NULL && bucket < TIMER_OVERFLOW_BUCKET)
+		TimerBucketsUsed[bucket / TIMER_WHEEL_SLOTS] &= ~(1ULL << (bucket % TIMER_WHEEL_SLOTS));
+
+	timerInfo->PreviousTimer = NULL;
+	timerInfo->NextTimer = NULL;
+	timerInfo->Bucket = TIMER_NOT_QUEUED;
+}
+
+//schedule the timer 'ticks' after 'time'. delays longer than the wheel can order are queued in parts
+static void ScheduleTimer(TimerInfo* timerInfo, u32 time, u32 ticks)
+{
+	const u32 delay = ticks > TIMER_MAX_WHEEL_TICKS
+		? TIMER_MAX_WHEEL_TICKS
+		: ticks;
+
+	timerInfo->IntervalInTicks = ticks - delay;
+	timerInfo->ExpireTime = time + delay;
+	InsertTimer(timerInfo);
+}
+
+//get the earliest bucket that has timers in it, and the time at which it is due
+static s32 GetNextTimerBucket(u32* bucketTime)
+{
+	for(u32 level = 0; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		const u32 shift = level * TIMER_WHEEL_BITS;
+		const u32 currentSlot = (WheelTime >> shift) & TIMER_WHEEL_MASK;
+		const u64 usedSlots = TimerBucketsUsed[level] & ~((2ULL << currentSlot) - 1);
+		if(usedSlots == 0)
+			continue;
+
+		const u32 slot = (u32)__builtin_ctzll(usedSlots);
+		*bucketTime = (WheelTime & ~((1u << (shift + TIMER_WHEEL_BITS)) - 1)) | (slot << shift);
+		return (s32)((level * TIMER_WHEEL_SLOTS) + slot);
+	}
+
+	if(TimerBuckets[TIMER_OVERFLOW_BUCKET] == NULL)
+		return -1;
+
+	*bucketTime = ((WheelTime >> TIMER_WHEEL_RANGE_BITS) + 1) << TIMER_WHEEL_RANGE_BITS;
+	return TIMER_OVERFLOW_BUCKET;
+}
+
+//wake the thread if it is still waiting in the queue its timer was started for.
+//if it got woken up some other way it will stop the timer itself once it runs
+static void ExpireThreadTimer(TimerInfo* timerInfo)
+{
+	ThreadInfo* thread = &Threads[timerInfo - ThreadTimers];
+	ThreadQueue* threadQueue = (ThreadQueue*)timerInfo->Message;
+	if(thread->ThreadState != Waiting || thread->ThreadQueue != threadQueue)
+		return;
+
+	WakeThread(thread, threadQueue == &SleepingThreads ? IPC_SUCCESS : IPC_EQUEUEEMPTY);
+}
+
+static void ExpireTimer(TimerInfo* timerInfo, u32 currentTime)
+{
+	//part of a long delay passed, queue the rest
+	if(timerInfo->IntervalInTicks != 0)
+	{
+		ScheduleTimer(timerInfo, timerInfo->ExpireTime, timerInfo->IntervalInTicks);
+		return;
+	}
+
+	if(timerInfo->IntervalInµs != 0)
+	{
+		//requeue from the time it was due so periodic timers don't drift, but never in the past
+		u32 interval = ConvertDelayToTicks(timerInfo->IntervalInµs);
+		if(interval == 0)
+			interval = 1;
+
+		u32 expireTime = timerInfo->ExpireTime;
+		if((s32)(expireTime + interval - currentTime) <= 0)
+		{
+			expireTime = currentTime;
+			interval = 1;
+		}
+
+		ScheduleTimer(timerInfo, expireTime, interval);
+	}
+
+	TRACE(TraceTimerFire, timerInfo, timerInfo->Message);
+	if(timerInfo >= ThreadTimers && timerInfo < &ThreadTimers[MAX_THREADS])
+		ExpireThreadTimer(timerInfo);
+	else if(timerInfo->MessageQueue != NULL)
+		SendMessageToQueue(timerInfo->MessageQueue, timerInfo->Message, RegisteredEventHandler);
+}
+
+//process all buckets that are due, cascading timers of higher levels down the wheel
+static void RunTimerWheel(u32 currentTime)
+{
+	u32 bucketTime = 0;
+	u32 expiredTimers = 0;
+	u32 delayedTimers = 0;
+	s32 bucket;
+
+	while((bucket = GetNextTimerBucket(&bucketTime)) >= 0 && (s32)(bucketTime - currentTime) <= 0)
+	{
+		TimerInfo* timerInfo = TimerBuckets[bucket];
+		TimerBuckets[bucket] = NULL;
+		if(bucket < TIMER_OVERFLOW_BUCKET)
+			TimerBucketsUsed[bucket / TIMER_WHEEL_SLOTS] &= ~(1ULL << (bucket % TIMER_WHEEL_SLOTS));
+
+		WheelTime = bucketTime;
+		while(timerInfo != NULL)
+		{
+			TimerInfo* nextTimer = timerInfo->NextTimer;
+			timerInfo->PreviousTimer = NULL;
+			timerInfo->NextTimer = NULL;
+			timerInfo->Bucket = TIMER_NOT_QUEUED;
+
+			if(GetTimerDeadline(timerInfo) != WheelTime)
+				InsertTimer(timerInfo);
+			else
+			{
+				//timers that were moved by their slack and fired together with another timer would have needed their own alarm
+				expiredTimers++;
+				if(timerInfo->ExpireTime != WheelTime)
+					delayedTimers++;
+
+				ExpireTimer(timerInfo, currentTime);
+			}
+
+			timerInfo = nextTimer;
+		}
+	}
+
+	if(expiredTimers > 1)
+		CoalescedTimerInterrupts += delayedTimers < expiredTimers - 1 ? delayedTimers : expiredTimers - 1;
+
+	WheelTime = currentTime;
+}
+
+//set the alarm for the earliest bucket, if it changed.
+//the alarm is never further away than TIMER_MAX_WHEEL_TICKS, so the handler also keeps the monotonic clock going
+static void UpdateTimerAlarm(void)
+{
+	u32 bucketTime = 0;
+	const u32 currentTime = read32(HW_TIMER);
+	if(GetNextTimerBucket(&bucketTime) < 0 || (s32)(bucketTime - currentTime) > (s32)TIMER_MAX_WHEEL_TICKS)
+		bucketTime = currentTime + TIMER_MAX_WHEEL_TICKS;
+	if(AlarmIntervalTicks != 0 && (s32)(bucketTime - currentTime) > (s32)AlarmIntervalTicks)
+		bucketTime = currentTime + AlarmIntervalTicks;
+
+	if(AlarmSet && AlarmTime == bucketTime)
+		return;
+
+	const s32 ticks = (s32)(bucketTime - currentTime);
+	AlarmSet = 1;
+	AlarmTime = bucketTime;
+	SetTimerAlarm(ticks <= 0 ? 0 : (u32)ticks);
+}
+
+//makes the alarm fire at least every given amount of ticks, even without timers being due. 0 turns it off
+void SetTimerAlarmInterval(u32 ticks)
+{
+	const u32 interupts = DisableInterrupts();
+	AlarmIntervalTicks = ticks;
+	UpdateTimerAlarm();
+	RestoreInterrupts(interupts);
+}
+
+//the shift series IOS uses to convert µs to ticks for each clock mode
+static u32 ConvertDelayToTicksSeries(u32 delay)
 {
 #ifndef MIOS
 	u32 clk = GetCoreClock();
@@ -60,77 +307,64 @@ u32 ConvertDelayToTicks(u32 delay)
 #endif
 }
 
+void InitializeTimerConversion(void)
+{
+	//the series only shifts by up to 12 bits, so running 1.0 in 16.16 fixed point through it gives the exact multiplier
+	const u32 ticksPerMicrosecond = ConvertDelayToTicksSeries(1 << 16);
+	MicrosecondsPerTick = (u32)((1ULL << 32) / ticksPerMicrosecond);
+	TicksPerMicrosecond = ticksPerMicrosecond;
+}
+
+u32 ConvertDelayToTicks(u32 delay)
+{
+	if(TicksPerMicrosecond == 0)
+		return ConvertDelayToTicksSeries(delay);
+
+	return (u32)(((u64)delay * TicksPerMicrosecond) >> 16);
+}
+
+u32 ConvertTicksToDelay(u32 ticks)
+{
+	return (u32)(((u64)ticks * MicrosecondsPerTick) >> 16);
+}
+
 void QueueTimer(TimerInfo* timerInfo)
 {
 	if(timerInfo == NULL)
 		return;
 
-	TimerInfo* nextTimer = CurrentTimer->NextTimer;
-	u32 intervalInTicks = timerInfo->IntervalInTicks;
-	u32 timePassed = read32(HW_TIMER) - PreviousTimerValue;
-	PreviousTimerValue = read32(HW_TIMER);
-
-	//if the next timer isn't the current timer & there is still time left -> correct the interval
-	//otherwise make it 0
-	if(nextTimer != CurrentTimer)
-	{
-		nextTimer->IntervalInTicks = (timePassed < nextTimer->IntervalInTicks)
-			? nextTimer->IntervalInTicks - timePassed
-			: 0;
-	}
+	//catch the wheel up with the current time before putting anything new in it.
+	//this is only possible if nothing is due, otherwise the handler will do it once it processed the due buckets
+	u32 bucketTime = 0;
+	const u32 currentTime = read32(HW_TIMER);
+	if(GetNextTimerBucket(&bucketTime) < 0 || (s32)(bucketTime - currentTime) > 0)
+		WheelTime = currentTime;
 
-	while(1)
-	{
-		if(nextTimer == CurrentTimer || nextTimer->IntervalInTicks >= intervalInTicks)
-			break;
-		
-		intervalInTicks -= nextTimer->IntervalInTicks;
-		nextTimer = nextTimer->NextTimer;
-	}
-	
-	//set timer interval that is left & fix next thread interval
-	timerInfo->IntervalInTicks = intervalInTicks;
-	if(nextTimer != CurrentTimer)
-		nextTimer->IntervalInTicks = nextTimer->IntervalInTicks - intervalInTicks;
-
-	//shove timer between our previous and next timer
-	TimerInfo* previousTimer = nextTimer->PreviousTimer;
-	timerInfo->PreviousTimer = previousTimer;
-	timerInfo->NextTimer = nextTimer;
-	nextTimer->PreviousTimer = timerInfo;
-	previousTimer->NextTimer = timerInfo;
-
-	//if the current running timer is our previous timer, we need to re-set the timer alarm with the new interval between the 2 timers
-	if(timerInfo->PreviousTimer == CurrentTimer)
-		SetTimerAlarm(timerInfo->IntervalInTicks);
+	RemoveTimer(timerInfo);
+	ScheduleTimer(timerInfo, currentTime, timerInfo->IntervalInTicks);
+	UpdateTimerAlarm();
 }
 
 void TimerHandler(void)
 {
-
 	u32 timer_messages[1];
 	s32 ret;
 	u32 interupts = 0;
-	u32 timerTicks = 0;
-	TimerInfo* previousTimer = NULL;
-	TimerInfo* nextTimer = NULL;
-
-	//IOS sets up the timer here, but we've set it up in the intial timer setup
-	/*CurrentTimer->IntervalInTicks = 0;
-	CurrentTimer->IntervalInµs = 0;
-	CurrentTimer->Message = NULL;
-	CurrentTimer->PreviousTimer = CurrentTimer;
-	CurrentTimer->NextTimer = CurrentTimer;
-	CurrentTimer->MessageQueue = NULL;*/
 
 	ret = CreateMessageQueue((void**)&timer_messages, 1);
 	if(ret < 0)
 		panic("Unable to create timer message queue: %d\n", ret);
 
 	const s32 timerQueueId = ret;
-	ret = RegisterEventHandler(IRQ_TIMER, timerQueueId, 0);
+	ret = RegisterEventCounter(IRQ_TIMER, timerQueueId, 0);
 	if(ret < 0)
 		panic("Unable to register timer event handler: %d\n", ret);
+
+	//start the alarm so the monotonic clock gets extended, even if nobody uses a timer
+	interupts = DisableInterrupts();
+	GetMonotonicTicks();
+	UpdateTimerAlarm();
+	RestoreInterrupts(interupts);
 	
 	while(1)
 	{
@@ -140,64 +374,14 @@ void TimerHandler(void)
 			ret = ReceiveMessage(timerQueueId, (void **)0x0, None);
 		} while (ret != 0);
 
-		//lets not get interrupted while processing the timer message
+		//lets not get interrupted while processing the timer message.
+		//alarms that fired while we were busy are all handled by this single run of the wheel
 		interupts = DisableInterrupts();
-
-		TimerInfo* timerInfo = CurrentTimer->NextTimer;
-		while(timerInfo != CurrentTimer)
-		{
-			while(1)
-			{
-				timerTicks = PreviousTimerValue;
-				PreviousTimerValue = read32(HW_TIMER);
-				timerTicks = read32(HW_TIMER) - timerTicks;
-
-				//will the next timer trigger before next loop?
-				//if so, fix its interval and set the hardware timer
-				if(timerTicks < timerInfo->IntervalInTicks)
-				{
-					timerTicks = timerInfo->IntervalInTicks - timerTicks;
-					timerInfo->IntervalInTicks = timerTicks;
-					SetTimerAlarm(timerTicks);
-					goto _continue_loop;
-				}
-
-				//timer passed, remove timer from queue and recalculate its position
-				u32 interval = timerInfo->IntervalInµs;
-				previousTimer = timerInfo->PreviousTimer;
-
-				//remove timer from queue
-				nextTimer = timerInfo->NextTimer;
-				previousTimer->NextTimer = nextTimer;
-				timerInfo->NextTimer = NULL;
-				nextTimer->PreviousTimer = previousTimer;
-				timerInfo->PreviousTimer = NULL;
-
-				if(interval != 0)
-				{
-					interval = ConvertDelayToTicks(interval);
-					if(timerInfo->IntervalInTicks + interval < timerTicks)
-						timerTicks = 1;
-					else
-						timerTicks = ((timerInfo->IntervalInTicks - timerTicks) + interval) - 1;
-					
-					timerInfo->IntervalInTicks = timerTicks;
-					QueueTimer(timerInfo);
-				}
-
-				if(timerInfo->MessageQueue == NULL)
-					break;
-
-				SendMessageToQueue(timerInfo->MessageQueue, timerInfo->Message, RegisteredEventHandler);
-				timerInfo = CurrentTimer->NextTimer;
-				if(timerInfo == CurrentTimer)
-					goto _reset_previous_and_continue;
-			}
-		}
-
-_reset_previous_and_continue:
-		PreviousTimerValue = 0;
-_continue_loop:
+		TakeEventCount(IRQ_TIMER);
+		AlarmSet = 0;
+		GetMonotonicTicks();
+		RunTimerWheel(read32(HW_TIMER));
+		UpdateTimerAlarm();
 		RestoreInterrupts(interupts);
 	}
 	return;
@@ -208,13 +392,36 @@ u32 GetTimerValue(void)
 	return read32(HW_TIMER);
 }
 
+u64 GetMonotonicTicks(void)
+{
+	const u32 interupts = DisableInterrupts();
+	const u32 currentTime = read32(HW_TIMER);
+	if(currentTime < ClockLastLow)
+		ClockHigh++;
+
+	ClockLastLow = currentTime;
+	const u64 ticks = ((u64)ClockHigh << 32) | currentTime;
+	RestoreInterrupts(interupts);
+	return ticks;
+}
+
+#ifndef MIOS
+s32 GetMonotonicTime(u64* ticks)
+{
+	if(CheckMemoryPointer(ticks, sizeof(u64), 4, CurrentThread->ProcessId, 0) < 0)
+		return IPC_EINVAL;
+
+	*ticks = GetMonotonicTicks();
+	return IPC_SUCCESS;
+}
+#endif
+
 void SetTimerAlarm(u32 ticks)
 {
 	if (ticks < 2)
 		ticks = 2;
 
 	write32(HW_ALARM, read32(HW_TIMER) + ticks);
-	PreviousTimerValue = read32(HW_TIMER);
 	return;
 }
 
@@ -224,7 +431,7 @@ s32 CreateTimer(u32 delayUs, u32 periodUs, const s32 queueid, void *message)
 	u32 interupts = DisableInterrupts();
 	u32 ticks = 0;
 
-	if(queueid < 0 || queueid > MAX_MESSAGEQUEUES)
+	if(queueid < 0 || queueid >= MAX_MESSAGEQUEUES)
 	{
 		ret = IPC_EINVAL;
 		goto return_create_timer;
@@ -272,7 +479,7 @@ s32 RestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs)
 	u32 interupts = DisableInterrupts();
 	s32 ret = 0;
 
-	if(timerId >= MAX_TIMERS)
+	if(timerId < 0 || timerId >= MAX_TIMERS)
 	{
 		ret = IPC_EINVAL;
 		goto return_restart_timer;
@@ -284,8 +491,7 @@ s32 RestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs)
 		goto return_restart_timer;
 	}
 
-	if( timers[timerId].IntervalInµs != 0 || timers[timerId].IntervalInTicks != 0 || 
-		timers[timerId].NextTimer != NULL || timers[timerId].PreviousTimer != NULL)
+	if(timers[timerId].IntervalInµs != 0 || timers[timerId].Bucket != TIMER_NOT_QUEUED)
 		goto return_restart_timer;
 
 	timers[timerId].IntervalInµs = repeatTimeUs;
@@ -306,11 +512,8 @@ s32 StopOrDestroyTimer(s32 timerId, s32 destroyTimer)
 	s32 ret = 0;
 	u32 interupts = DisableInterrupts();
 	TimerInfo* timerInfo = NULL;
-	TimerInfo* nextTimer = NULL;
-	TimerInfo* previousTimer = NULL;
-	u32 prevTimerValue = PreviousTimerValue;
 
-	if(timerId > MAX_TIMERS)
+	if(timerId < 0 || timerId >= MAX_TIMERS)
 	{
 		ret = IPC_EINVAL;
 		goto return_stop_timer;
@@ -323,50 +526,103 @@ s32 StopOrDestroyTimer(s32 timerId, s32 destroyTimer)
 		goto return_stop_timer;
 	}
 
-	nextTimer = timerInfo->NextTimer;
-	if(nextTimer == NULL)
-		goto clear_timer;
+	//the alarm is left as is. if this was the earliest timer, the handler will find nothing due and set the next one
+	RemoveTimer(timerInfo);
+	if(destroyTimer)
+		memset(timerInfo, 0, sizeof(TimerInfo));
+	else
+	{
+		timerInfo->IntervalInµs = 0;
+		timerInfo->IntervalInTicks = 0;
+	}
+
+return_stop_timer:
+	RestoreInterrupts(interupts);
+	return ret;
+}
+s32 SetTimerSlack(s32 timerId, u32 slackUs)
+{
+	s32 ret = 0;
+	u32 interupts = DisableInterrupts();
+	TimerInfo* timerInfo = NULL;
 
-	if(nextTimer != CurrentTimer)
-		goto clear_previousTimer;
+	if(timerId < 0 || timerId >= MAX_TIMERS)
+	{
+		ret = IPC_EINVAL;
+		goto return_set_slack;
+	}
 
-	//if we are destroying the next timer, we need to recalculate all the timer timings
-	if(CurrentTimer->NextTimer == timerInfo)
+	timerInfo = &timers[timerId];
+	if(timerInfo->MessageQueue == NULL)
 	{
-		PreviousTimerValue = read32(HW_TIMER);
-		if(nextTimer->IntervalInTicks + timerInfo->IntervalInTicks <= read32(HW_TIMER - prevTimerValue))
-		{
-			nextTimer->IntervalInTicks = 0;
-			goto clear_previousTimer;
-		}
-		prevTimerValue = nextTimer->IntervalInTicks + (timerInfo->IntervalInTicks - read32(HW_TIMER) - prevTimerValue);
+		ret = IPC_EINVAL;
+		goto return_set_slack;
+	}
+
+	if(timerInfo->ProcessId != CurrentThread->ProcessId)
+	{
+		ret = IPC_EACCES;
+		goto return_set_slack;
 	}
-	else
-		PreviousTimerValue = nextTimer->IntervalInTicks + timerInfo->IntervalInTicks;
 
-	nextTimer->IntervalInTicks = PreviousTimerValue;
+	const u32 slackTicks = ConvertDelayToTicks(slackUs);
+	timerInfo->SlackInTicks = slackTicks > TIMER_MAX_SLACK_TICKS
+		? TIMER_MAX_SLACK_TICKS
+		: (u16)slackTicks;
 
-//clear the previous timer and connect it to the next timer
-clear_previousTimer:
-	previousTimer = timers[timerId].PreviousTimer;
-	previousTimer->NextTimer = nextTimer;
-	(timers[timerId].NextTimer)->PreviousTimer = previousTimer;
+	//re-sort the timer with its new deadline
+	if(timerInfo->Bucket != TIMER_NOT_QUEUED)
+	{
+		RemoveTimer(timerInfo);
+		InsertTimer(timerInfo);
+		UpdateTimerAlarm();
+	}
 
-//clear the timer struct
-clear_timer:
-	if(destroyTimer)
-		memset(timerInfo, 0, sizeof(TimerInfo));
+return_set_slack:
+	RestoreInterrupts(interupts);
+	return ret;
+}
+u32 GetCoalescedTimerInterrupts(void)
+{
+	return CoalescedTimerInterrupts;
+}
+
+//start the thread's timer to wake it out of the given queue. interrupts must be disabled
+void StartThreadTimer(ThreadInfo* thread, ThreadQueue* threadQueue, u32 ticks)
+{
+	TimerInfo* timerInfo = &ThreadTimers[thread - Threads];
+	RemoveTimer(timerInfo);
+	timerInfo->Message = threadQueue;
+	timerInfo->IntervalInTicks = ticks;
+	QueueTimer(timerInfo);
+}
+void StopThreadTimer(ThreadInfo* thread)
+{
+	const u32 interupts = DisableInterrupts();
+	RemoveTimer(&ThreadTimers[thread - Threads]);
+	RestoreInterrupts(interupts);
+}
+s32 SleepThread(u32 delayUs)
+{
+	const u32 interupts = DisableInterrupts();
+	const u32 ticks = ConvertDelayToTicks(delayUs);
+
+	if(ticks == 0)
+	{
+		CurrentThread->ThreadState = Ready;
+		YieldCurrentThread(&SchedulerQueue);
+	}
 	else
 	{
-		timerInfo->PreviousTimer = NULL;
-		timerInfo->NextTimer = NULL;
-		timerInfo->IntervalInµs = 0;
-		timerInfo->IntervalInTicks = 0;
+		StartThreadTimer(CurrentThread, &SleepingThreads, ticks);
+		CurrentThread->ThreadState = Waiting;
+		YieldCurrentThread(&SleepingThreads);
+		//we could have been started again after being suspended, so make sure the timer is gone
+		RemoveTimer(&ThreadTimers[CurrentThread - Threads]);
 	}
 
-return_stop_timer:
 	RestoreInterrupts(interupts);
-	return ret;
+	return IPC_SUCCESS;
 }
 s32 StopTimer(s32 timerId)
 {
@@ -376,3 +632,57 @@ s32 DestroyTimer(s32 timerId)
 {
 	return StopOrDestroyTimer(timerId, 1);
 }
+
+#ifdef TIMER_BENCHMARK
+#define BENCHMARK_ROUNDS	0x400
+
+void BenchmarkTimers(void)
+{
+	static const u32 counts[] = { 16, 64, 256 };
+	TimerInfo* scratchTimers = (TimerInfo*)AllocateOnHeap(KernelHeapId, sizeof(TimerInfo) * 256);
+	if(scratchTimers == NULL)
+	{
+		gecko_printf("timer benchmark: failed to allocate timers\n");
+		return;
+	}
+
+	//the scratch timers have no queue, so they never send anything while they sit in the wheel
+	gecko_printf("timer benchmark (%d rounds, ticks) timers : insert cancel requeue\n", BENCHMARK_ROUNDS);
+	memset(scratchTimers, 0, sizeof(TimerInfo) * 256);
+	for(u32 index = 0; index < sizeof(counts) / sizeof(counts[0]); index++)
+	{
+		const u32 count = counts[index];
+		const u32 interupts = DisableInterrupts();
+		const u32 currentTime = read32(HW_TIMER);
+
+		//periodic timers with periods between ~1ms and ~1s
+		u32 start = read32(HW_TIMER);
+		for(u32 timer = 0; timer < count; timer++)
+		{
+			scratchTimers[timer].IntervalInµs = 1000 + (timer * 3907);
+			ScheduleTimer(&scratchTimers[timer], currentTime, ConvertDelayToTicks(scratchTimers[timer].IntervalInµs));
+		}
+		const u32 insertTicks = read32(HW_TIMER) - start;
+
+		//what the handler does for a periodic timer : take it out and put it back one period later
+		start = read32(HW_TIMER);
+		for(u32 round = 0; round < BENCHMARK_ROUNDS; round++)
+		{
+			TimerInfo* timerInfo = &scratchTimers[round % count];
+			RemoveTimer(timerInfo);
+			ScheduleTimer(timerInfo, timerInfo->ExpireTime, ConvertDelayToTicks(timerInfo->IntervalInµs));
+		}
+		const u32 requeueTicks = read32(HW_TIMER) - start;
+
+		start = read32(HW_TIMER);
+		for(u32 timer = 0; timer < count; timer++)
+			RemoveTimer(&scratchTimers[timer]);
+		const u32 cancelTicks = read32(HW_TIMER) - start;
+
+		RestoreInterrupts(interupts);
+		gecko_printf("%d : %d %d %d\n", count, insertTicks, cancelTicks, requeueTicks);
+	}
+
+	FreeOnHeap(KernelHeapId, scratchTimers);
+}
+#endif
@@ -8,8 +8,10 @@
 # see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
 */
 
+#pragma once
 #include <types.h>
 #include "messaging/messageQueue.h"
+#include "scheduler/threads.h"
 
 #ifdef MIOS
 
@@ -23,6 +25,22 @@
 
 #endif
 
+//prints the timer wheel insert & cancel timings at boot
+//#define TIMER_BENCHMARK
+
+//the timer wheel has 5 levels of 64 slots, covering 2^30 ticks. anything beyond that goes in the overflow bucket
+#define TIMER_WHEEL_LEVELS		5
+#define TIMER_WHEEL_BITS		6
+#define TIMER_WHEEL_SLOTS		(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK		(TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_RANGE_BITS	(TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)
+#define TIMER_OVERFLOW_BUCKET	(TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS)
+#define TIMER_BUCKETS			(TIMER_OVERFLOW_BUCKET + 1)
+#define TIMER_NOT_QUEUED		0
+//longest delay queued in one go, so expire times never get ambiguous when the hardware timer wraps
+#define TIMER_MAX_WHEEL_TICKS	(1u << (TIMER_WHEEL_RANGE_BITS - 1))
+#define TIMER_MAX_SLACK_TICKS	0xFFFF
+
 typedef struct TimerInfo
 {
 	u32 IntervalInTicks;
@@ -32,6 +50,9 @@ typedef struct TimerInfo
 	u32 ProcessId;
 	struct TimerInfo* PreviousTimer;
 	struct TimerInfo* NextTimer;
+	u32 ExpireTime;
+	u16 Bucket;
+	u16 SlackInTicks;
 } TimerInfo;
 CHECK_OFFSET(TimerInfo, 0x00, IntervalInTicks);
 CHECK_OFFSET(TimerInfo, 0x04, IntervalInµs);
@@ -40,18 +61,34 @@ CHECK_OFFSET(TimerInfo, 0x0C, Message);
 CHECK_OFFSET(TimerInfo, 0x10, ProcessId);
 CHECK_OFFSET(TimerInfo, 0x14, PreviousTimer);
 CHECK_OFFSET(TimerInfo, 0x18, NextTimer);
-CHECK_SIZE(TimerInfo, 0x1C);
+CHECK_OFFSET(TimerInfo, 0x1C, ExpireTime);
+CHECK_OFFSET(TimerInfo, 0x20, Bucket);
+CHECK_OFFSET(TimerInfo, 0x22, SlackInTicks);
+CHECK_SIZE(TimerInfo, 0x24);
 
-extern TimerInfo* CurrentTimer;
-extern u32 PreviousTimerValue;
 extern const u8* TimerMainStack;
 
 void TimerHandler(void);
 void QueueTimer(TimerInfo* timerInfo);
+void InitializeTimerConversion(void);
 u32 ConvertDelayToTicks(u32 delay);
+u32 ConvertTicksToDelay(u32 ticks);
 s32 CreateTimer(u32 delayUs, u32 periodUs, const s32 queueid, void *message);
 s32 RestartTimer(s32 timerId, u32 timeUs, u32 repeatTimeUs);
 s32 StopTimer(s32 timerId);
 s32 DestroyTimer(s32 timerId);
+s32 SetTimerSlack(s32 timerId, u32 slackUs);
+u32 GetCoalescedTimerInterrupts(void);
+void StartThreadTimer(ThreadInfo* thread, ThreadQueue* threadQueue, u32 ticks);
+void StopThreadTimer(ThreadInfo* thread);
+s32 SleepThread(u32 delayUs);
 u32 GetTimerValue(void);
+u64 GetMonotonicTicks(void);
+#ifndef MIOS
+s32 GetMonotonicTime(u64* ticks);
+#endif
 void SetTimerAlarm(u32 ticks);
+void SetTimerAlarmInterval(u32 ticks);
+#ifdef TIMER_BENCHMARK
+void BenchmarkTimers(void);
+#endif
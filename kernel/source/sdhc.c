@@ -27,6 +27,7 @@
 #include "memory/memory.h"
 #include "messaging/ipc.h"
 #include "interrupt/irq.h"
+#include "interrupt/deferredWork.h"
 
 #include "utils.h"
 #include "bsdtypes.h"
@@ -835,6 +836,7 @@ void sdhc_irq(void)
 
 void sdhc_init(void)
 {
+	RegisterDeferredWork(IRQ_SDHC, sdhc_irq);
 	irq_enable(IRQ_SDHC);
 	sdhc_host_found(0, SDHC_REG_BASE, 1);
 }
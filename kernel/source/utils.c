@@ -10,6 +10,7 @@ Copyright (C) 2008, 2009	Hector Martin "marcan" <marcan@marcansoft.com>
 
 #include <stdarg.h>
 #include <types.h>
+#include <string.h>
 #include <vsprintf.h>
 #include <ios/gecko.h>
 #include <ios/processor.h>
@@ -17,6 +18,7 @@ Copyright (C) 2008, 2009	Hector Martin "marcan" <marcan@marcansoft.com>
 #include "core/gpio.h"
 #include "core/hollywood.h"
 #include "scheduler/timer.h"
+#include "memory/heaps.h"
 #include "utils.h"
 
 bool IsWiiMode = true;
@@ -44,4 +46,54 @@ void udelay(u32 delay)
 		while(read32(HW_TIMER) > 0);
 		while(read32(HW_TIMER) < then);
 	}
-}
\ No newline at end of file
+}
+
+#ifdef MEMCPY_BENCHMARK
+#define BENCHMARK_ROUNDS	0x10
+
+void BenchmarkMemoryCopy(void)
+{
+	static const u32 sizes[] = { 0x10, 0x40, 0x100, 0x400, 0x1000 };
+	u8* buffer = (u8*)AllocateOnHeap(KernelHeapId, 0x2040);
+	if(buffer == NULL)
+	{
+		gecko_printf("memcpy benchmark: failed to allocate buffer\n");
+		return;
+	}
+
+	//ticks for BENCHMARK_ROUNDS copies of each size, for all source & destination alignments
+	gecko_printf("memcpy benchmark (%d rounds, ticks) size src dst : memcpy memmove memmove(overlap)\n", BENCHMARK_ROUNDS);
+	for(u32 index = 0; index < sizeof(sizes) / sizeof(sizes[0]); index++)
+	{
+		u32 size = sizes[index];
+		for(u32 sourceAlignment = 0; sourceAlignment < 4; sourceAlignment++)
+		{
+			for(u32 destinationAlignment = 0; destinationAlignment < 4; destinationAlignment++)
+			{
+				u8* source = buffer + sourceAlignment;
+				u8* destination = buffer + 0x1020 + destinationAlignment;
+				u32 start = read32(HW_TIMER);
+				for(u32 round = 0; round < BENCHMARK_ROUNDS; round++)
+					memcpy(destination, source, size);
+				u32 memcpyTicks = read32(HW_TIMER) - start;
+
+				start = read32(HW_TIMER);
+				for(u32 round = 0; round < BENCHMARK_ROUNDS; round++)
+					memmove(destination, source, size);
+				u32 memmoveTicks = read32(HW_TIMER) - start;
+
+				//overlapping, destination after the source so it has to copy backwards
+				destination = source + 0x08 + destinationAlignment;
+				start = read32(HW_TIMER);
+				for(u32 round = 0; round < BENCHMARK_ROUNDS; round++)
+					memmove(destination, source, size);
+				u32 overlapTicks = read32(HW_TIMER) - start;
+
+				gecko_printf("0x%04X %d %d : %d %d %d\n", size, sourceAlignment, destinationAlignment, memcpyTicks, memmoveTicks, overlapTicks);
+			}
+		}
+	}
+
+	FreeOnHeap(KernelHeapId, buffer);
+}
+#endif
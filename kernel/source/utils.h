@@ -12,8 +12,15 @@ Copyright (C) 2008, 2009	Hector Martin "marcan" <marcan@marcansoft.com>
 #define __UTILS_H__
 
 #include <types.h>
+
+//prints a memcpy/memmove timing matrix over sizes & alignments at boot
+//#define MEMCPY_BENCHMARK
+
 extern bool IsWiiMode;
 
 void udelay(u32 d);
+#ifdef MEMCPY_BENCHMARK
+void BenchmarkMemoryCopy(void);
+#endif
 
 #endif
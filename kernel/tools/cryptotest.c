@@ -0,0 +1,237 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	cryptotest - host known answer tests & benchmark of crypto/softwareCrypto.c
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// checks the software aes-128-cbc & sha-1 against the FIPS-197, SP 800-38A & FIPS 180 vectors,
+// then prints their throughput, and that of decrypting & hashing content in one pass of AES_PIPELINE_CHUNK
+// sized chunks (like IOSC_DecryptAndVerify does) against a full decrypt followed by a full hash. usage (from kernel/tools) :
+//   make test   or   make cryptotest && ./cryptotest [seconds]
+// a duration of 0 only runs the tests. the numbers are for the host cpu, starlet runs the same code at 243MHz
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// types.h assumes a 32 bit target, so provide the types ourselves & keep it from being included
+#define __TYPES_H__
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#include "../source/crypto/softwareCrypto.c"
+
+#define BENCHMARK_SIZE	0x10000
+//a title's content is far bigger than the cache, and so is this
+#define CONTENT_SIZE	0x1000000
+//AES_PIPELINE_CHUNK, aes.h pulls in too much of the kernel to include it here
+#define PIPELINE_CHUNK	0x10000
+
+static u32 Failures = 0;
+
+static void ParseHex(u8* output, const char* hex)
+{
+	for(u32 i = 0; hex[2 * i] != '\0'; i++)
+		sscanf(&hex[2 * i], "%2hhx", &output[i]);
+}
+
+static void Check(const char* name, const void* result, const char* expectedHex)
+{
+	u8 expected[0x40];
+	const u32 length = (u32)strlen(expectedHex) / 2;
+	ParseHex(expected, expectedHex);
+	const bool passed = memcmp(result, expected, length) == 0;
+	printf("%-32s %s\n", name, passed ? "ok" : "FAILED");
+	Failures += !passed;
+}
+
+static void Sha1(u8* digest, const void* data, u32 length, u32 pieceLength)
+{
+	SoftwareSha1Context context;
+	SoftwareSha1_Init(&context);
+	for(u32 offset = 0; offset < length; offset += pieceLength)
+		SoftwareSha1_Update(&context, (const u8*)data + offset, length - offset < pieceLength ? length - offset : pieceLength);
+	SoftwareSha1_Finalize(&context, digest);
+}
+
+static void TestAes(void)
+{
+	SoftwareAesKey key;
+	u32 keyData[4];
+	u32 iv[4];
+	u32 input[16];
+	u32 output[16];
+
+	//FIPS-197 appendix C.1, a single block with a zero iv is plain ecb
+	ParseHex((u8*)keyData, "000102030405060708090a0b0c0d0e0f");
+	ParseHex((u8*)input, "00112233445566778899aabbccddeeff");
+	SoftwareAes_ExpandKey(&key, keyData);
+	memset(iv, 0, sizeof(iv));
+	SoftwareAes_EncryptCbc(&key, iv, input, output, 1);
+	Check("aes-128 encrypt (FIPS-197)", output, "69c4e0d86a7b0430d8cdb78070b4c55a");
+	memset(iv, 0, sizeof(iv));
+	SoftwareAes_DecryptCbc(&key, iv, output, output, 1);
+	Check("aes-128 decrypt (FIPS-197)", output, "00112233445566778899aabbccddeeff");
+
+	//SP 800-38A F.2.1 & F.2.2
+	static const char* plaintext = "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+		"30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+	static const char* ciphertext = "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+		"73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7";
+	ParseHex((u8*)keyData, "2b7e151628aed2a6abf7158809cf4f3c");
+	ParseHex((u8*)input, plaintext);
+	SoftwareAes_ExpandKey(&key, keyData);
+	ParseHex((u8*)iv, "000102030405060708090a0b0c0d0e0f");
+	SoftwareAes_EncryptCbc(&key, iv, input, output, 4);
+	Check("aes-128-cbc encrypt (SP 800-38A)", output, ciphertext);
+	Check("aes-128-cbc encrypt next iv", iv, "3ff1caa1681fac09120eca307586e1a7");
+
+	//in place & split in two calls, continuing the chain with the returned iv
+	ParseHex((u8*)iv, "000102030405060708090a0b0c0d0e0f");
+	SoftwareAes_DecryptCbc(&key, iv, output, output, 1);
+	SoftwareAes_DecryptCbc(&key, iv, &output[4], &output[4], 3);
+	Check("aes-128-cbc decrypt (SP 800-38A)", output, plaintext);
+	Check("aes-128-cbc decrypt next iv", iv, "3ff1caa1681fac09120eca307586e1a7");
+}
+
+static void TestSha1(void)
+{
+	static const char* twoBlocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+	u8 digest[20];
+
+	Sha1(digest, "", 0, 1);
+	Check("sha-1 empty", digest, "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+	Sha1(digest, "abc", 3, 3);
+	Check("sha-1 abc", digest, "a9993e364706816aba3e25717850c26c9cd0d89d");
+	Sha1(digest, twoBlocks, (u32)strlen(twoBlocks), 64);
+	Check("sha-1 448 bits", digest, "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+	Sha1(digest, twoBlocks, (u32)strlen(twoBlocks), 7);
+	Check("sha-1 448 bits in 7 byte pieces", digest, "84983e441c3bd26ebaae4aa1f95129e5e54670f1");
+
+	//a million 'a's, hashed both from an aligned & from a misaligned buffer
+	u8* buffer = malloc(1000001);
+	memset(buffer, 'a', 1000001);
+	Sha1(digest, buffer, 1000000, 1000000);
+	Check("sha-1 million a", digest, "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	Sha1(digest, buffer + 1, 1000000, 4099);
+	Check("sha-1 million a, misaligned", digest, "34aa973cd4c4daa4f61eeb2bdbad27316534016f");
+	free(buffer);
+}
+
+static double GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void Benchmark(const double duration)
+{
+	static u32 buffer[BENCHMARK_SIZE / 4];
+	static SoftwareAesKey key;
+	u32 keyData[4] = { 1, 2, 3, 4 };
+	u32 iv[4] = { 0 };
+	u32 states[5] = { 0 };
+	const char* names[] = { "aes-128-cbc encrypt", "aes-128-cbc decrypt", "sha-1" };
+
+	SoftwareAes_ExpandKey(&key, keyData);
+	for(u32 test = 0; test < 3; test++)
+	{
+		u32 count = 0;
+		double elapsed = 0;
+		const double start = GetSeconds();
+		for(; elapsed < duration; elapsed = GetSeconds() - start, count++)
+		{
+			if(test == 0)
+				SoftwareAes_EncryptCbc(&key, iv, buffer, buffer, BENCHMARK_SIZE / 16);
+			else if(test == 1)
+				SoftwareAes_DecryptCbc(&key, iv, buffer, buffer, BENCHMARK_SIZE / 16);
+			else
+				SoftwareSha1_HashBlocks(states, buffer, BENCHMARK_SIZE / 64);
+		}
+
+		printf("%-24s : %8.1f MB/s\n", names[test], count * (double)BENCHMARK_SIZE / elapsed / 1e6);
+	}
+}
+
+//the cpu does both the decrypt & the hash here, so this only measures the content going through memory once instead of twice.
+//on starlet the engines also run at the same time, which the host can't show
+static void BenchmarkDecryptAndVerify(const double duration)
+{
+	static SoftwareAesKey key;
+	u32 keyData[4] = { 1, 2, 3, 4 };
+	u8 digests[2][20];
+	const char* names[] = { "decrypt, then sha-1", "decrypt + sha-1 chunks" };
+	u8* input = malloc(CONTENT_SIZE);
+	u8* output = malloc(CONTENT_SIZE);
+	memset(input, 0x5A, CONTENT_SIZE);
+	SoftwareAes_ExpandKey(&key, keyData);
+
+	for(u32 test = 0; test < 2; test++)
+	{
+		u32 count = 0;
+		double elapsed = 0;
+		const double start = GetSeconds();
+		for(; elapsed < duration || count == 0; elapsed = GetSeconds() - start, count++)
+		{
+			u32 iv[4] = { 0 };
+			SoftwareSha1Context context;
+			SoftwareSha1_Init(&context);
+			if(test == 0)
+			{
+				SoftwareAes_DecryptCbc(&key, iv, input, output, CONTENT_SIZE / 16);
+				SoftwareSha1_Update(&context, output, CONTENT_SIZE);
+			}
+			else
+			{
+				for(u32 offset = 0; offset < CONTENT_SIZE; offset += PIPELINE_CHUNK)
+				{
+					SoftwareAes_DecryptCbc(&key, iv, input + offset, output + offset, PIPELINE_CHUNK / 16);
+					SoftwareSha1_Update(&context, output + offset, PIPELINE_CHUNK);
+				}
+			}
+			SoftwareSha1_Finalize(&context, digests[test]);
+		}
+
+		printf("%-24s : %8.1f MB/s\n", names[test], count * (double)CONTENT_SIZE / elapsed / 1e6);
+	}
+
+	if(memcmp(digests[0], digests[1], sizeof(digests[0])) != 0)
+		printf("the chunked decrypt + sha-1 hashed different plaintext\n");
+
+	free(input);
+	free(output);
+}
+
+int main(int argc, char** argv)
+{
+	const double duration = argc > 1 ? atof(argv[1]) : 1.0;
+	TestAes();
+	TestSha1();
+	if(Failures != 0)
+	{
+		printf("%u tests failed\n", Failures);
+		return 1;
+	}
+
+	if(duration > 0)
+	{
+		Benchmark(duration);
+		BenchmarkDecryptAndVerify(duration);
+	}
+
+	return 0;
+}
@@ -0,0 +1,248 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	eccbench - host tests & benchmark of the sect233r1 code in crypto/ecc.c
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// builds the kernel's ecc & software sha-1 code for the host, checks it against known answers & prints how many signatures
+// it signs & verifies per second. usage (from kernel/tools) :
+//   make test   or   make eccbench && ./eccbench [seconds]
+// a duration of 0 only runs the tests. the numbers are for the host cpu, starlet runs the same code at 243MHz
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// types.h assumes a 32 bit target, so provide the types ourselves & keep it from being included
+#define __TYPES_H__
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#include "../source/crypto/softwareCrypto.c"
+#include "../source/crypto/ecc.c"
+
+//2 keys, a signature of Hash by KeyA & the shared key of both, generated with openssl 3.0 :
+//  openssl ecparam -name sect233r1 -genkey -noout -out a.pem, openssl ec -in a.pem -text -noout
+//  openssl pkeyutl -sign -inkey a.pem -in hash.bin, openssl pkeyutl -derive -inkey a.pem -peerkey b.pub
+//the shared key is the first 16 bytes of the sha-1 of the derived x
+static const u8 PrivateKeyA[ECC_PRIVATE_KEY_SIZE] =
+{
+	0x00, 0xF6, 0xE1, 0x29, 0xC7, 0x64, 0xA7, 0x59, 0x93, 0x32, 0x44, 0x79, 0x73, 0x1B, 0x13,
+	0xD2, 0xB9, 0x97, 0x00, 0x80, 0x4D, 0x07, 0xFF, 0xB6, 0x48, 0x1D, 0x83, 0x46, 0x57, 0x67,
+};
+static const u8 PublicKeyA[ECC_PUBLIC_KEY_SIZE] =
+{
+	0x01, 0x98, 0xB4, 0x8C, 0xD0, 0x3D, 0x73, 0x07, 0x8C, 0x74, 0x21, 0xF8, 0xE8, 0x3B, 0xAE,
+	0x64, 0x5B, 0x50, 0xC8, 0x54, 0xAA, 0x2F, 0x9A, 0x94, 0x52, 0x28, 0xB8, 0x06, 0x97, 0x23,
+	0x00, 0x28, 0x4A, 0xD7, 0xD9, 0xD8, 0xAD, 0xA4, 0xEA, 0x0A, 0x46, 0x7B, 0x1F, 0x8A, 0x21,
+	0x7B, 0xF8, 0xC0, 0x56, 0x7D, 0x96, 0x0D, 0xBA, 0x65, 0xEB, 0xB3, 0xFE, 0xE8, 0x77, 0xF6,
+};
+static const u8 PrivateKeyB[ECC_PRIVATE_KEY_SIZE] =
+{
+	0x00, 0xE7, 0xA3, 0x84, 0x95, 0xBC, 0xD9, 0x3F, 0x2A, 0x54, 0xE6, 0x6C, 0xB4, 0x19, 0x59,
+	0xD3, 0xF8, 0x55, 0xCF, 0x99, 0x76, 0x95, 0x4B, 0x00, 0x84, 0x56, 0x0D, 0xF7, 0xAB, 0x7E,
+};
+static const u8 PublicKeyB[ECC_PUBLIC_KEY_SIZE] =
+{
+	0x01, 0x6A, 0xF1, 0x14, 0x9F, 0x11, 0x40, 0xE0, 0x66, 0x2E, 0xD7, 0xDF, 0xA2, 0xE5, 0x1E,
+	0xC7, 0x19, 0x45, 0xFF, 0x1B, 0xDD, 0x8D, 0x29, 0x43, 0x0D, 0xC9, 0x84, 0x68, 0x38, 0xE2,
+	0x01, 0xAA, 0xAC, 0x91, 0x08, 0x4C, 0x5D, 0xFA, 0xDD, 0xC6, 0x57, 0xF2, 0x4B, 0x74, 0xB6,
+	0xCE, 0x43, 0x17, 0x40, 0x0B, 0xF7, 0x2E, 0x20, 0x51, 0xB4, 0x37, 0x1A, 0x14, 0x2D, 0xB4,
+};
+//sha-1 of "starstruck ecc known answer"
+static const u8 Hash[ECC_HASH_SIZE] =
+{
+	0xD5, 0xE3, 0x7A, 0x73, 0x17, 0x71, 0x30, 0xC9, 0x13, 0x25, 0x7D, 0xA5, 0x95, 0x3D, 0xAB,
+	0x6E, 0x80, 0x3F, 0xED, 0xBF,
+};
+static const u8 OpensslSignature[ECC_SIGNATURE_SIZE] =
+{
+	0x00, 0xFB, 0xAD, 0x1E, 0xB3, 0xA5, 0x01, 0x95, 0x6E, 0x5C, 0x1A, 0x35, 0x57, 0x32, 0xE0,
+	0x0B, 0x39, 0x97, 0x44, 0x8B, 0x79, 0xFB, 0x01, 0xE8, 0x91, 0x9F, 0x58, 0xA4, 0xD4, 0x92,
+	0x00, 0x99, 0x28, 0x02, 0xEB, 0x3D, 0xDB, 0x1D, 0x1F, 0x98, 0xCA, 0xE4, 0xF8, 0xCA, 0x14,
+	0x5E, 0xE5, 0x24, 0x08, 0x2A, 0x92, 0x8D, 0xA8, 0xC0, 0xA8, 0x58, 0xE5, 0x80, 0x25, 0x4D,
+};
+static const u8 SharedKey[ECC_SHARED_KEY_SIZE] =
+{
+	0x60, 0x34, 0xA9, 0x45, 0x4D, 0xDF, 0xD9, 0x5E, 0x69, 0xF1, 0x83, 0x89, 0x37, 0xB3, 0x25, 0xA1,
+};
+
+//the curve's G & n, from openssl ecparam -name sect233r1 -param_enc explicit -text
+static const u8 BasePoint[ECC_PUBLIC_KEY_SIZE] =
+{
+	0x00, 0xFA, 0xC9, 0xDF, 0xCB, 0xAC, 0x83, 0x13, 0xBB, 0x21, 0x39, 0xF1, 0xBB, 0x75, 0x5F,
+	0xEF, 0x65, 0xBC, 0x39, 0x1F, 0x8B, 0x36, 0xF8, 0xF8, 0xEB, 0x73, 0x71, 0xFD, 0x55, 0x8B,
+	0x01, 0x00, 0x6A, 0x08, 0xA4, 0x19, 0x03, 0x35, 0x06, 0x78, 0xE5, 0x85, 0x28, 0xBE, 0xBF,
+	0x8A, 0x0B, 0xEF, 0xF8, 0x67, 0xA7, 0xCA, 0x36, 0x71, 0x6F, 0x7E, 0x01, 0xF8, 0x10, 0x52,
+};
+static const u8 Order[ECC_PRIVATE_KEY_SIZE] =
+{
+	0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x13, 0xE9, 0x74, 0xE7, 0x2F, 0x8A, 0x69, 0x22, 0x03, 0x1D, 0x26, 0x03, 0xCF, 0xE0, 0xD7,
+};
+//what Ecc_Sign gives for Hash with KeyA, checked with openssl pkeyutl -verify
+static const u8 SignatureA[ECC_SIGNATURE_SIZE] =
+{
+	0x00, 0x4B, 0x43, 0x7B, 0x2C, 0xDF, 0x51, 0x21, 0x8A, 0xCA, 0x5F, 0xEB, 0x80, 0xAC, 0x1A,
+	0xBA, 0x6D, 0x2C, 0x25, 0x97, 0x63, 0x19, 0x23, 0xA6, 0x2D, 0xE9, 0xE4, 0xE0, 0x60, 0x80,
+	0x00, 0x12, 0x0F, 0xA7, 0x42, 0xAC, 0x23, 0x2F, 0x59, 0x85, 0xD0, 0xFD, 0xC4, 0xF5, 0xD5,
+	0x70, 0x45, 0x8D, 0x0D, 0xE2, 0x01, 0x20, 0x2E, 0xA0, 0xFD, 0x61, 0xA7, 0x7B, 0x58, 0xAD,
+};
+
+static u32 Failures = 0;
+
+static void Check(const char* name, const bool passed)
+{
+	if(passed)
+		return;
+
+	printf("%s FAILED\n", name);
+	Failures++;
+}
+
+static void TestKnownAnswers(void)
+{
+	u8 publicKey[ECC_PUBLIC_KEY_SIZE];
+	u8 signature[ECC_SIGNATURE_SIZE];
+	u8 sharedKey[ECC_SHARED_KEY_SIZE];
+
+	Check("public key A", Ecc_GeneratePublicKey(PrivateKeyA, publicKey) && memcmp(publicKey, PublicKeyA, sizeof(publicKey)) == 0);
+	Check("public key B", Ecc_GeneratePublicKey(PrivateKeyB, publicKey) && memcmp(publicKey, PublicKeyB, sizeof(publicKey)) == 0);
+	Check("openssl signature", Ecc_Verify(PublicKeyA, Hash, OpensslSignature));
+	Check("openssl signature with the other key", !Ecc_Verify(PublicKeyB, Hash, OpensslSignature));
+	memcpy(signature, OpensslSignature, sizeof(signature));
+	signature[ECC_SIGNATURE_SIZE - 1] ^= 1;
+	Check("broken signature", !Ecc_Verify(PublicKeyA, Hash, signature));
+	memcpy(signature, OpensslSignature, sizeof(signature));
+	signature[1] ^= 0x80;
+	Check("broken r", !Ecc_Verify(PublicKeyA, Hash, signature));
+
+	Check("sign", Ecc_Sign(PrivateKeyA, Hash, signature) && memcmp(signature, SignatureA, sizeof(signature)) == 0);
+	Check("signature verifies", Ecc_Verify(PublicKeyA, Hash, signature));
+	Check("shared key A", Ecc_ComputeSharedKey(PrivateKeyA, PublicKeyB, sharedKey) && memcmp(sharedKey, SharedKey, sizeof(sharedKey)) == 0);
+	Check("shared key B", Ecc_ComputeSharedKey(PrivateKeyB, PublicKeyA, sharedKey) && memcmp(sharedKey, SharedKey, sizeof(sharedKey)) == 0);
+
+	//scalars of 1 & the order minus 1 give G & -G, 0 & the order itself are no private keys
+	u8 privateKey[ECC_PRIVATE_KEY_SIZE];
+	u8 negativeKey[ECC_PUBLIC_KEY_SIZE];
+	memset(privateKey, 0, sizeof(privateKey));
+	privateKey[ECC_PRIVATE_KEY_SIZE - 1] = 1;
+	Check("public key of 1", Ecc_GeneratePublicKey(privateKey, publicKey) && memcmp(publicKey, BasePoint, sizeof(publicKey)) == 0);
+	for(u32 i = 0; i < ECC_PRIVATE_KEY_SIZE; i++)
+		privateKey[i] = Order[i];
+	privateKey[ECC_PRIVATE_KEY_SIZE - 1]--;
+	Check("public key of n - 1", Ecc_GeneratePublicKey(privateKey, negativeKey) && memcmp(negativeKey, BasePoint, ECC_PUBLIC_KEY_SIZE / 2) == 0);
+	privateKey[ECC_PRIVATE_KEY_SIZE - 1]++;
+	Check("private key of n", !Ecc_GeneratePublicKey(privateKey, publicKey));
+	memset(privateKey, 0, sizeof(privateKey));
+	Check("private key of 0", !Ecc_GeneratePublicKey(privateKey, publicKey));
+}
+
+static double GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	const double duration = argc > 1 ? atof(argv[1]) : 2.0;
+	u8 privateKey[ECC_PRIVATE_KEY_SIZE];
+	u8 otherPrivateKey[ECC_PRIVATE_KEY_SIZE];
+	u8 publicKey[ECC_PUBLIC_KEY_SIZE];
+	u8 otherPublicKey[ECC_PUBLIC_KEY_SIZE];
+	u8 hash[ECC_HASH_SIZE];
+	u8 signature[ECC_SIGNATURE_SIZE];
+	u8 sharedKey[ECC_SHARED_KEY_SIZE];
+	u8 otherSharedKey[ECC_SHARED_KEY_SIZE];
+
+	double start = GetSeconds();
+	TestKnownAnswers();
+	if(Failures != 0)
+	{
+		printf("%u tests failed\n", Failures);
+		return 1;
+	}
+	printf("ecc known answers ok : %.3f ms with the tables\n", (GetSeconds() - start) * 1000.0);
+
+	if(duration <= 0)
+		return 0;
+
+	srand(0x233);
+	for(u32 i = 0; i < ECC_PRIVATE_KEY_SIZE; i++)
+	{
+		privateKey[i] = (u8)rand();
+		otherPrivateKey[i] = (u8)rand();
+	}
+	privateKey[0] = otherPrivateKey[0] = 0;
+	for(u32 i = 0; i < ECC_HASH_SIZE; i++)
+		hash[i] = (u8)rand();
+
+	if(!Ecc_GeneratePublicKey(privateKey, publicKey) || !Ecc_GeneratePublicKey(otherPrivateKey, otherPublicKey))
+	{
+		printf("failed to generate the public keys\n");
+		return 1;
+	}
+
+	if(!Ecc_Sign(privateKey, hash, signature) || !Ecc_Verify(publicKey, hash, signature))
+	{
+		printf("signature doesn't verify\n");
+		return 1;
+	}
+
+	signature[ECC_SIGNATURE_SIZE - 1] ^= 1;
+	if(Ecc_Verify(publicKey, hash, signature))
+	{
+		printf("broken signature verifies\n");
+		return 1;
+	}
+	signature[ECC_SIGNATURE_SIZE - 1] ^= 1;
+
+	if(!Ecc_ComputeSharedKey(privateKey, otherPublicKey, sharedKey)
+		|| !Ecc_ComputeSharedKey(otherPrivateKey, publicKey, otherSharedKey)
+		|| memcmp(sharedKey, otherSharedKey, ECC_SHARED_KEY_SIZE) != 0)
+	{
+		printf("shared keys don't match\n");
+		return 1;
+	}
+
+	u32 count = 0;
+	start = GetSeconds();
+	double elapsed = 0;
+	for(; elapsed < duration; elapsed = GetSeconds() - start, count++)
+	{
+		hash[count % ECC_HASH_SIZE]++;
+		Ecc_Sign(privateKey, hash, signature);
+	}
+	printf("sign   : %8.1f ops/s\n", count / elapsed);
+
+	count = 0;
+	start = GetSeconds();
+	elapsed = 0;
+	for(; elapsed < duration; elapsed = GetSeconds() - start, count++)
+		Ecc_Verify(publicKey, hash, signature);
+	printf("verify : %8.1f ops/s\n", count / elapsed);
+
+	count = 0;
+	start = GetSeconds();
+	elapsed = 0;
+	for(; elapsed < duration; elapsed = GetSeconds() - start, count++)
+		Ecc_ComputeSharedKey(privateKey, otherPublicKey, sharedKey);
+	printf("shared : %8.1f ops/s\n", count / elapsed);
+
+	return 0;
+}
@@ -0,0 +1,863 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	enginetest - host tests of the request handling in crypto/sha.c & crypto/aes.c
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// runs sha.c & aes.c against an emulation of the engines' registers, which hashes & encrypts with softwareCrypto.c and
+// fails commands on demand. covers the bounce buffer seams of GenerateShaVectors, the hmac midstate cache across key
+// changes, the aes descriptor ring wrapping around with a request falling back to the cpu halfway through the queue,
+// and the retries & fallbacks of engine errors. usage (from kernel/tools) :
+//   make test   or   make enginetest && ./enginetest
+// the emulated engines finish a command as soon as it is written, but their irq only arrives once the handler thread
+// waits for one, so requests pile up in the descriptor ring like they do on starlet. the timing of the real engines,
+// their dma & the cache & ahb flushes aren't covered, those still need hardware
+
+#include "kerneltest.h"
+
+//processor.h's register accessors are arm assembly. the emulation of the engines below replaces them
+#define __PROCESSOR_H__
+static u32 read32(u32 address);
+static void write32(u32 address, u32 data);
+
+#include "../source/crypto/softwareCrypto.c"
+#include "../source/crypto/sha.c"
+#include "../source/crypto/aes.c"
+
+#define SHA_EVENT_QUEUE		1
+#define AES_EVENT_QUEUE		2
+#define AES_RESOURCE_QUEUE	3
+#define MAX_REPLIES			0x20
+
+//what sha.c & aes.c need from the rest of the kernel. there is no mmu, so virtual addresses are the physical ones
+MessageQueue MessageQueues[MAX_MESSAGEQUEUES];
+s32 KernelHeapId = 0;
+u8 HmacKey[SHA_BLOCK_SIZE];
+u32 KeyringKeyVersions[KEYRING_METADATA_TOTAL_ENTRIES];
+static u8 TestKeys[KEYRING_METADATA_TOTAL_ENTRIES][0x14];
+static u32 LoggedMessages = 0;
+static IpcMessage* Replies[MAX_REPLIES];
+static s32 ReplyValues[MAX_REPLIES];
+static u32 ReplyCount = 0;
+
+u32 VirtualToPhysical(u32 virtualAddress) { return virtualAddress; }
+void DCFlushRange(const void* start, u32 size) { (void)start; (void)size; }
+void DCInvalidateRange(const void* start, u32 size) { (void)start; (void)size; }
+void DCRangeOperations(const CacheRangeOperation* operations, u32 count) { (void)operations; (void)count; }
+void AhbFlushFrom(AHBDEV type) { (void)type; }
+void AhbFlushTo(AHBDEV dev) { (void)dev; }
+u32 DisableInterrupts(void) { return 0; }
+void RestoreInterrupts(u32 cookie) { (void)cookie; }
+s32 FreeOnHeap(s32 heapid, void* ptr) { (void)heapid; (void)ptr; return IPC_SUCCESS; }
+s32 RegisterEventHandler(const u8 device, const s32 queueid, void* message) { (void)device; (void)queueid; (void)message; return IPC_SUCCESS; }
+s32 RegisterResourceManager(const char* devicePath, const s32 queueid) { (void)devicePath; (void)queueid; return IPC_SUCCESS; }
+s32 CreateMessageQueue(void** ptr, u32 numberOfMessages) { (void)ptr; (void)numberOfMessages; return IPC_EMAX; }
+
+u32 gecko_printf(const char* fmt, ...)
+{
+	(void)fmt;
+	LoggedMessages++;
+	return 0;
+}
+
+void panic(const char* fmt, ...)
+{
+	Print("panic: ");
+	Print(fmt);
+	for(;;)
+		HostSyscall(HOST_SYSCALL_EXIT, 2, 0, 0);
+}
+
+void HMAC_Panic(const char* message, void* hash)
+{
+	(void)hash;
+	panic(message);
+}
+
+s32 Keyring_FindKeySize(u32* keySize, u32 keyHandle)
+{
+	(void)keyHandle;
+	*keySize = sizeof(TestKeys[0]);
+	return IPC_SUCCESS;
+}
+
+s32 Keyring_GetKey(u32 keyHandle, void* keyPtr, u32 keySize)
+{
+	memcpy(keyPtr, TestKeys[keyHandle], keySize);
+	return IPC_SUCCESS;
+}
+
+s32 ResourceReply(IpcMessage* message, s32 requestReturnValue)
+{
+	if(ReplyCount < MAX_REPLIES)
+	{
+		Replies[ReplyCount] = message;
+		ReplyValues[ReplyCount] = requestReturnValue;
+	}
+	ReplyCount++;
+	return IPC_SUCCESS;
+}
+
+//on starlet /dev/sha runs in its own thread, here aes.c calls into it directly
+int IoctlvFD_InnerWithFlag(s32 fd, u32 requestId, u32 vectorInputCount, u32 vectorIOCount, IoctlvMessageData *vectors,
+						   MessageQueue* messageQueue, IpcMessage* message, const int checkBeforeSend)
+{
+	(void)fd; (void)vectorInputCount; (void)vectorIOCount; (void)messageQueue; (void)message; (void)checkBeforeSend;
+	return GenerateSha((ShaContext*)vectors[1].Data, vectors[0].Data, vectors[0].Length, (ShaCommandType)requestId, vectors[2].Data);
+}
+
+static void CreateTestQueue(const s32 queueId, void** storage, const u32 size)
+{
+	MessageQueue* queue = &MessageQueues[queueId];
+	memset(queue, 0, sizeof(MessageQueue));
+	queue->QueueHeap = storage;
+	queue->QueueSize = size;
+}
+
+static s32 SendTestMessage(MessageQueue* queue, void* message)
+{
+	if(queue->Used >= queue->QueueSize)
+		return IPC_EQUEUEFULL;
+
+	queue->QueueHeap[(queue->First + queue->Used) % queue->QueueSize] = message;
+	queue->Used++;
+	return IPC_SUCCESS;
+}
+
+s32 SignalInterruptThread(const u32 device, MessageQueue* messageQueue, void* message)
+{
+	(void)device;
+	return SendTestMessage(messageQueue, message);
+}
+
+//emulated engine registers. the SHA_H registers, AES_KEY & AES_IV hold the words as the kernel wrote them
+static u32 ShaRegisters[(SHA_H0 - SHA_REG_BASE) / 4 + SHA_NUM_WORDS];
+static u32 ShaCommandsRun = 0;
+static u8 ShaIrqPending = 0;
+//commands that still succeed before ShaFailCount commands fail
+static u32 ShaFailSkip = 0;
+static u32 ShaFailCount = 0;
+
+static u32 AesControl = 0;
+static u32 AesSource = 0;
+static u32 AesDestination = 0;
+static u32 AesKeyFifo[4];
+static u32 AesIvFifo[4];
+static u32 AesKeyIndex = 0;
+static u32 AesIvIndex = 0;
+static u32 AesChainIv[4];
+static u32 AesCommandsRun = 0;
+static u8 AesIrqPending = 0;
+//commands reading from AesFailSource, or from anywhere when it is 0, that fail
+static u32 AesFailSource = 0;
+static u32 AesFailCount = 0;
+
+static void RunShaCommand(const u32 value)
+{
+	ShaControl control = { .Value = value };
+	if(!control.Fields.Execute)
+	{
+		ShaRegisters[0] = value;
+		return;
+	}
+
+	u32* states = &ShaRegisters[(SHA_H0 - SHA_REG_BASE) / 4];
+	ShaCommandsRun++;
+	control.Fields.Execute = 0;
+	if(ShaFailSkip != 0)
+		ShaFailSkip--;
+	else if(ShaFailCount != 0)
+	{
+		//whatever the engine had hashed of the command is in the states
+		ShaFailCount--;
+		control.Fields.HasError = 1;
+		states[0] ^= 0xDEADBEEF;
+	}
+
+	if(!control.Fields.HasError)
+		SoftwareSha1_HashBlocks(states, (const void*)ShaRegisters[1], control.Fields.NumberOfBlocks + 1);
+
+	ShaIrqPending |= control.Fields.GenerateIrq;
+	ShaRegisters[0] = control.Value;
+}
+
+static void RunAesCommand(const u32 value)
+{
+	AESCommand command = { .Value = value };
+	if(!command.Fields.Command)
+	{
+		//a reset drops the key & the iv
+		memset(AesKeyFifo, 0, sizeof(AesKeyFifo));
+		memset(AesIvFifo, 0, sizeof(AesIvFifo));
+		AesKeyIndex = 0;
+		AesIvIndex = 0;
+		AesControl = value;
+		return;
+	}
+
+	const u32 blocks = command.Fields.NumberOfBlocks + 1;
+	AesCommandsRun++;
+	command.Fields.Command = 0;
+	if(AesFailCount != 0 && (AesFailSource == 0 || AesFailSource == AesSource))
+	{
+		//the engine fails before it writes anything
+		AesFailCount--;
+		command.Fields.HasError = 1;
+	}
+	else if(!command.Fields.EnableDataHandling)
+		memmove((void*)AesDestination, (const void*)AesSource, blocks * AES_BLOCK_SIZE);
+	else
+	{
+		SoftwareAesKey key;
+		if(!command.Fields.KeepIV)
+			memcpy(AesChainIv, AesIvFifo, sizeof(AesChainIv));
+
+		SoftwareAes_ExpandKey(&key, AesKeyFifo);
+		if(command.Fields.IsDecryption)
+			SoftwareAes_DecryptCbc(&key, AesChainIv, (const void*)AesSource, (void*)AesDestination, blocks);
+		else
+			SoftwareAes_EncryptCbc(&key, AesChainIv, (const void*)AesSource, (void*)AesDestination, blocks);
+	}
+
+	AesSource += blocks * AES_BLOCK_SIZE;
+	AesDestination += blocks * AES_BLOCK_SIZE;
+	AesIrqPending |= command.Fields.GenerateIrq;
+	AesControl = command.Value;
+}
+
+//everything that isn't a register is memory, in starlet's byte order
+static u32 read32(u32 address)
+{
+	if(address >= SHA_REG_BASE && address < SHA_H0 + SHA_NUM_WORDS * 4)
+		return ShaRegisters[(address - SHA_REG_BASE) / 4];
+
+	switch(address)
+	{
+		case AES_CMD:
+			return AesControl;
+		case AES_SRC:
+			return AesSource;
+		case AES_DEST:
+			return AesDestination;
+		default:
+			break;
+	}
+
+	const u8* data = (const u8*)address;
+	return (u32)data[0] << 24 | (u32)data[1] << 16 | (u32)data[2] << 8 | data[3];
+}
+
+static void write32(u32 address, u32 data)
+{
+	if(address == SHA_CMD)
+		return RunShaCommand(data);
+	if(address >= SHA_REG_BASE && address < SHA_H0 + SHA_NUM_WORDS * 4)
+	{
+		ShaRegisters[(address - SHA_REG_BASE) / 4] = data;
+		return;
+	}
+
+	switch(address)
+	{
+		case AES_CMD:
+			return RunAesCommand(data);
+		case AES_SRC:
+			AesSource = data;
+			return;
+		case AES_DEST:
+			AesDestination = data;
+			return;
+		case AES_KEY:
+			AesKeyFifo[AesKeyIndex++ % 4] = data;
+			return;
+		case AES_IV:
+			AesIvFifo[AesIvIndex++ % 4] = data;
+			return;
+		default:
+			break;
+	}
+
+	u8* memory = (u8*)address;
+	memory[0] = (u8)(data >> 24);
+	memory[1] = (u8)(data >> 16);
+	memory[2] = (u8)(data >> 8);
+	memory[3] = (u8)data;
+}
+
+//the irqs of the engines are delivered while a thread waits, until the queue it waits on has a message
+s32 ReceiveMessage(const s32 queueId, void** message, u32 flags)
+{
+	(void)flags;
+	MessageQueue* queue = &MessageQueues[queueId];
+	while(queue->Used == 0)
+	{
+		if(ShaIrqPending)
+		{
+			ShaIrqPending = 0;
+			SendTestMessage(&MessageQueues[SHA_EVENT_QUEUE], NULL);
+		}
+		else if(AesIrqPending)
+		{
+			AesIrqPending = 0;
+			AesCommandCompleted();
+		}
+		else
+			panic("waiting on a queue no irq will send to\n");
+	}
+
+	*message = queue->QueueHeap[queue->First];
+	queue->First = (queue->First + 1) % queue->QueueSize;
+	queue->Used--;
+	return IPC_SUCCESS;
+}
+
+static void* ShaEventQueue[1];
+static void* AesEventQueue[1];
+static void* AesResourceQueue[AES_RM_QUEUE_SIZE];
+static u8 Input[0x80000] ALIGNED(0x40);
+static u8 Output[0x80000] ALIGNED(0x40);
+static u8 Expected[0x80000] ALIGNED(0x40);
+
+static void Fill(u8* buffer, const u32 length, u32 seed)
+{
+	for(u32 index = 0; index < length; index++)
+	{
+		seed = seed * 1103515245 + 12345;
+		buffer[index] = (u8)(seed >> 16);
+	}
+}
+
+static void ResetEngines(void)
+{
+	ShaFailSkip = 0;
+	ShaFailCount = 0;
+	ShaUseSoftware = 0;
+	ShaEngineFailures = 0;
+	AesFailSource = 0;
+	AesFailCount = 0;
+	AesUseSoftware = 0;
+	AesEngineFailures = 0;
+	AesCheckEngineNeeded = 0;
+	ReplyCount = 0;
+	CreateTestQueue(SHA_EVENT_QUEUE, ShaEventQueue, 1);
+	CreateTestQueue(AES_EVENT_QUEUE, AesEventQueue, 1);
+	CreateTestQueue(AES_RESOURCE_QUEUE, AesResourceQueue, AES_RM_QUEUE_SIZE);
+	AesCompletionSignalled = 0;
+}
+
+//the hash as the words GetShaStates gives
+static void ReferenceSha1(u32* hash, const void* data, const u32 length)
+{
+	SoftwareSha1Context context;
+	u8 digest[0x14];
+	SoftwareSha1_Init(&context);
+	SoftwareSha1_Update(&context, data, length);
+	SoftwareSha1_Finalize(&context, digest);
+	for(u32 word = 0; word < SHA_NUM_WORDS; word++)
+		hash[word] = read32((u32)&digest[word * 4]);
+}
+
+//the outer hash of the kernel is over the inner hash as it is in memory, which on a little endian host isn't in the
+//byte order of the digest. on starlet both are the same
+static void ReferenceHmac(u32* hash, const u8* key, const void* data, const u32 length)
+{
+	SoftwareSha1Context context;
+	u8 pad[SHA_BLOCK_SIZE];
+	u8 digest[0x14];
+	u32 inner[SHA_NUM_WORDS];
+
+	memset(pad, 0, sizeof(pad));
+	memcpy(pad, key, 0x14);
+	for(u32 index = 0; index < sizeof(pad); index++)
+		pad[index] ^= 0x36;
+	SoftwareSha1_Init(&context);
+	SoftwareSha1_Update(&context, pad, sizeof(pad));
+	SoftwareSha1_Update(&context, data, length);
+	SoftwareSha1_Finalize(&context, digest);
+	for(u32 word = 0; word < SHA_NUM_WORDS; word++)
+		inner[word] = read32((u32)&digest[word * 4]);
+
+	for(u32 index = 0; index < sizeof(pad); index++)
+		pad[index] ^= 0x36 ^ 0x5C;
+	SoftwareSha1_Init(&context);
+	SoftwareSha1_Update(&context, pad, sizeof(pad));
+	SoftwareSha1_Update(&context, inner, sizeof(inner));
+	SoftwareSha1_Finalize(&context, digest);
+	for(u32 word = 0; word < SHA_NUM_WORDS; word++)
+		hash[word] = read32((u32)&digest[word * 4]);
+}
+
+//an hmac over 0x40 bytes of init, 0x80 of contribute & the rest in the finalize
+static s32 Hmac(u32* hash, u32 keyHandle, const u8* data, const u32 length)
+{
+	ShaContext context;
+	s32 ret = GenerateHmac_Init(&context, data, 0x40, &keyHandle, sizeof(keyHandle));
+	if(ret == IPC_SUCCESS)
+		ret = GenerateHmac_Contribute(&context, data + 0x40, 0x40, data + 0x80, 0x40);
+	if(ret == IPC_SUCCESS)
+		ret = GenerateHmac_Finalize(&context, data + 0xC0, 0x40, data + 0x100, length - 0x100, &keyHandle, sizeof(keyHandle), hash);
+	return ret;
+}
+
+//3 segments, the first 2 of every length around a block, the bounce buffer & an engine command, at every word offset
+static void TestShaVectorSeams(void)
+{
+	static const u32 lengths[] =
+	{
+		0, 1, 3, 0x3F, 0x40, 0x41, 0x7F, 0x100, SHA_BOUNCE_BLOCKS * SHA_BLOCK_SIZE - 1, SHA_BOUNCE_BLOCKS * SHA_BLOCK_SIZE,
+		SHA_BOUNCE_BLOCKS * SHA_BLOCK_SIZE + 5, 0x2345, SHA_MAX_BLOCKS * SHA_BLOCK_SIZE + 0x47
+	};
+	const u32 numberOfLengths = sizeof(lengths) / sizeof(lengths[0]);
+	u32 mismatches = 0;
+	u32 hash[SHA_NUM_WORDS];
+	u32 expected[SHA_NUM_WORDS];
+
+	ResetEngines();
+	Fill(Input, sizeof(Input), 0x5A5A);
+	for(u32 first = 0; first < numberOfLengths; first++)
+	{
+		for(u32 offset = 0; offset < 4; offset++)
+		{
+			for(u32 second = 0; second < numberOfLengths; second++)
+			{
+				const IoctlvMessageData segments[3] =
+				{
+					{ .Data = (u32*)&Input[offset], .Length = lengths[first] },
+					{ .Data = (u32*)&Input[0x20000 + ((offset + second) & 3)], .Length = lengths[second] },
+					{ .Data = (u32*)&Input[0x40001], .Length = 0x21 },
+				};
+
+				u32 length = 0;
+				for(u32 segment = 0; segment < 3; segment++)
+				{
+					memcpy(&Expected[length], segments[segment].Data, segments[segment].Length);
+					length += segments[segment].Length;
+				}
+
+				ReferenceSha1(expected, Expected, length);
+				mismatches += GenerateShaVectors(segments, 3, hash) != IPC_SUCCESS || memcmp(hash, expected, sizeof(hash)) != 0;
+			}
+		}
+	}
+	Check("sha vectors across the bounce buffer seams", mismatches == 0);
+
+	//aligned data goes to the engine as is, unaligned data in whole bounce buffers
+	IoctlvMessageData segment = { .Data = (u32*)Input, .Length = 0x10000 };
+	u32 commands = ShaCommandsRun;
+	GenerateShaVectors(&segment, 1, hash);
+	Check("aligned sha vector is hashed in place", ShaCommandsRun - commands == 0x10000 / (SHA_MAX_BLOCKS * SHA_BLOCK_SIZE) + 1);
+	segment.Data = (u32*)&Input[1];
+	commands = ShaCommandsRun;
+	GenerateShaVectors(&segment, 1, hash);
+	Check("unaligned sha vector is bounced in bulk", ShaCommandsRun - commands <= 0x10000 / sizeof(BounceBuffer) + 1);
+	Check("sha vectors didn't log engine errors", LoggedMessages == 0);
+}
+
+static void TestHmacMidstateCache(void)
+{
+	u32 hash[SHA_NUM_WORDS];
+	u32 expected[SHA_NUM_WORDS];
+	u32 mismatches = 0;
+	const u32 length = 0x123;
+
+	ResetEngines();
+	Fill(Input, length, 0x1234);
+	for(u32 handle = 0; handle < KEYRING_METADATA_TOTAL_ENTRIES; handle++)
+		Fill(TestKeys[handle], sizeof(TestKeys[handle]), handle);
+
+	//more keys than the cache holds, twice, so the second round hits evicted & cached entries
+	for(u32 round = 0; round < 2; round++)
+	{
+		for(u32 handle = 1; handle <= HMAC_MIDSTATE_CACHE_SIZE + 1; handle++)
+		{
+			ReferenceHmac(expected, TestKeys[handle], Input, length);
+			mismatches += Hmac(hash, handle, Input, length) != IPC_SUCCESS || memcmp(hash, expected, sizeof(hash)) != 0;
+		}
+	}
+	Check("hmac with more keys than the midstate cache", mismatches == 0);
+
+	//a handle that isn't cached yet
+	u32 commands = ShaCommandsRun;
+	Hmac(hash, 10, Input, length);
+	const u32 uncachedCommands = ShaCommandsRun - commands;
+	commands = ShaCommandsRun;
+	Hmac(hash, 10, Input, length);
+	Check("cached midstates skip hashing the pads", ShaCommandsRun - commands == uncachedCommands - 2);
+
+	//a new key in the same handle has to replace the cached midstates
+	u32 oldHash[SHA_NUM_WORDS];
+	memcpy(oldHash, hash, sizeof(oldHash));
+	Fill(TestKeys[10], sizeof(TestKeys[10]), 0x7777);
+	KeyringKeyVersions[10]++;
+	ReferenceHmac(expected, TestKeys[10], Input, length);
+	commands = ShaCommandsRun;
+	Check("hmac after a key change uses the new key", Hmac(hash, 10, Input, length) == IPC_SUCCESS &&
+		  memcmp(hash, expected, sizeof(hash)) == 0 && memcmp(hash, oldHash, sizeof(hash)) != 0);
+	Check("key change hashes the pads again", ShaCommandsRun - commands == uncachedCommands);
+
+	Check("hmac of an invalid key handle fails", Hmac(hash, KEYRING_METADATA_TOTAL_ENTRIES, Input, length) == IPC_EINVAL);
+}
+
+static void TestShaEngineErrors(void)
+{
+	u32 hash[SHA_NUM_WORDS];
+	u32 expected[SHA_NUM_WORDS];
+	//3 engine commands & the padding
+	IoctlvMessageData segment = { .Data = (u32*)Input, .Length = 3 * SHA_MAX_BLOCKS * SHA_BLOCK_SIZE + 0x10 };
+
+	ResetEngines();
+	Fill(Input, segment.Length, 0x4242);
+	ReferenceSha1(expected, Input, segment.Length);
+
+	u32 logs = LoggedMessages;
+	ShaFailSkip = 1;
+	ShaFailCount = 1;
+	Check("sha engine error is retried", GenerateShaVectors(&segment, 1, hash) == IPC_SUCCESS &&
+		  memcmp(hash, expected, sizeof(hash)) == 0 && ShaEngineFailures == 0 && LoggedMessages == logs + 1);
+
+	//the retry from the bounce buffer fails as well, so the rest of the request is hashed on the cpu
+	ShaFailSkip = 1;
+	ShaFailCount = 0x1000;
+	u32 commands = ShaCommandsRun;
+	s32 ret = GenerateShaVectors(&segment, 1, hash);
+	ShaFailCount = 0;
+	Check("failed retry finishes the request on the cpu", ret == IPC_SUCCESS && memcmp(hash, expected, sizeof(hash)) == 0 &&
+		  ShaEngineFailures == 1 && !ShaUseSoftware && ShaCommandsRun - commands == 3);
+
+	commands = ShaCommandsRun;
+	Check("next sha request is back on the engine", GenerateShaVectors(&segment, 1, hash) == IPC_SUCCESS &&
+		  memcmp(hash, expected, sizeof(hash)) == 0 && ShaCommandsRun - commands == 4);
+
+	//an error on the padding, which is polled
+	ShaFailSkip = 3;
+	ShaFailCount = 1;
+	Check("sha engine error on the padding is retried", GenerateShaVectors(&segment, 1, hash) == IPC_SUCCESS &&
+		  memcmp(hash, expected, sizeof(hash)) == 0 && ShaEngineFailures == 1);
+
+	for(u32 failure = ShaEngineFailures; failure < SHA_ENGINE_MAX_FAILURES; failure++)
+	{
+		ShaFailSkip = 0;
+		ShaFailCount = 0x1000;
+		ret = GenerateShaVectors(&segment, 1, hash);
+	}
+	ShaFailCount = 0;
+	Check("sha moves to the cpu after repeated failures", ret == IPC_SUCCESS && memcmp(hash, expected, sizeof(hash)) == 0 &&
+		  ShaUseSoftware == 1);
+
+	commands = ShaCommandsRun;
+	Check("sha runs on the cpu from then on", GenerateShaVectors(&segment, 1, hash) == IPC_SUCCESS &&
+		  memcmp(hash, expected, sizeof(hash)) == 0 && ShaCommandsRun == commands);
+}
+
+static void TestVerifyHashesArray(void)
+{
+	const u32 elementSize = 0x400;
+	const u32 elements = SHA_VERIFY_BATCH + 3;
+	u32 hashes[SHA_VERIFY_BATCH + 3][SHA_NUM_WORDS];
+
+	ResetEngines();
+	Fill(Input, elementSize * elements, 0x9999);
+	for(u32 element = 0; element < elements; element++)
+		ReferenceSha1(hashes[element], &Input[element * elementSize], elementSize);
+
+	Check("verify hashes array", VerifyHashesArray(Input, elementSize, elements, hashes) == IPC_SUCCESS);
+	ShaFailSkip = 9;
+	ShaFailCount = 1;
+	Check("verify hashes array with an engine error", VerifyHashesArray(Input, elementSize, elements, hashes) == IPC_SUCCESS);
+	hashes[elements - 2][1] ^= 1;
+	Check("verify hashes array finds a bad hash", VerifyHashesArray(Input, elementSize, elements, hashes) == IPC_CHECKVALUE);
+}
+
+typedef struct
+{
+	u32 Ioctl;
+	u32 Offset;
+	u32 Length;
+	u8 InPlace;
+} AesTestRequest;
+
+typedef struct
+{
+	IpcMessage Message;
+	IoctlvMessageData Vectors[4];
+	u32 Key[4];
+	u32 IV[4];
+	u32 ExpectedIV[4];
+} AesTestMessage;
+
+//requests of up to 2 engine commands, more than fit in the descriptor ring
+static const AesTestRequest AesRequests[] =
+{
+	{ ENCRYPT, 0x00000, 0x00010, 0 },
+	{ DECRYPT, 0x00100, 0x01000, 1 },
+	{ COPY,    0x01100, 0x00200, 0 },
+	{ DECRYPT, 0x02000, 0x18000, 0 },
+	{ ENCRYPT, 0x1A000, 0x14000, 1 },
+	{ DECRYPT, 0x2E000, 0x00020, 0 },
+	{ ENCRYPT, 0x2E100, 0x00800, 0 },
+	{ DECRYPT, 0x2F000, 0x10010, 1 },
+	{ ENCRYPT, 0x40000, 0x00040, 0 },
+	{ COPY,    0x40100, 0x00030, 1 },
+};
+#define AES_TEST_REQUESTS (sizeof(AesRequests) / sizeof(AesRequests[0]))
+static AesTestMessage AesMessages[AES_TEST_REQUESTS];
+
+static void QueueAesRequests(void)
+{
+	Fill(Input, sizeof(Input), 0xAE5);
+	Fill(Output, sizeof(Output), 0x0);
+	for(u32 index = 0; index < AES_TEST_REQUESTS; index++)
+	{
+		const AesTestRequest* request = &AesRequests[index];
+		AesTestMessage* message = &AesMessages[index];
+		u8* input = &Input[request->Offset];
+		u8* output = request->InPlace ? input : &Output[request->Offset];
+
+		Fill((u8*)message->Key, sizeof(message->Key), index & 1);
+		Fill((u8*)message->IV, sizeof(message->IV), index + 0x100);
+		memcpy(message->ExpectedIV, message->IV, sizeof(message->IV));
+		if(request->Ioctl == COPY)
+			memcpy(&Expected[request->Offset], input, request->Length);
+		else
+		{
+			SoftwareAesKey key;
+			SoftwareAes_ExpandKey(&key, message->Key);
+			if(request->Ioctl == DECRYPT)
+				SoftwareAes_DecryptCbc(&key, message->ExpectedIV, input, &Expected[request->Offset], request->Length / AES_BLOCK_SIZE);
+			else
+				SoftwareAes_EncryptCbc(&key, message->ExpectedIV, input, &Expected[request->Offset], request->Length / AES_BLOCK_SIZE);
+		}
+
+		message->Message.Request.Data.Ioctlv.Data = message->Vectors;
+		message->Vectors[0] = (IoctlvMessageData) { .Data = (u32*)input, .Length = request->Length };
+		message->Vectors[1] = (IoctlvMessageData) { .Data = message->Key, .Length = sizeof(message->Key) };
+		message->Vectors[2] = (IoctlvMessageData) { .Data = (u32*)output, .Length = request->Length };
+		message->Vectors[3] = (IoctlvMessageData) { .Data = message->IV, .Length = sizeof(message->IV) };
+		AesQueueDescriptor(&message->Message, request->Ioctl, input, output, request->Length, message->Key, message->IV);
+	}
+
+	AesWaitForDescriptor(1);
+}
+
+//all requests are replied to in order. failedRequest is the one expected to have failed
+static bool CheckAesReplies(const u32 failedRequest)
+{
+	if(ReplyCount != AES_TEST_REQUESTS)
+		return false;
+
+	for(u32 index = 0; index < AES_TEST_REQUESTS; index++)
+	{
+		const AesTestRequest* request = &AesRequests[index];
+		const AesTestMessage* message = &AesMessages[index];
+		const u8* output = (const u8*)message->Vectors[2].Data;
+		if(Replies[index] != &message->Message)
+			return false;
+		if(index == failedRequest)
+		{
+			if(ReplyValues[index] != -1)
+				return false;
+			continue;
+		}
+
+		if(ReplyValues[index] != IPC_SUCCESS || memcmp(output, &Expected[request->Offset], request->Length) != 0)
+			return false;
+		if(request->Ioctl != COPY && memcmp(message->IV, message->ExpectedIV, sizeof(message->IV)) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+static void TestAesDescriptorRing(void)
+{
+	ResetEngines();
+	const u32 logs = LoggedMessages;
+	QueueAesRequests();
+	Check("aes descriptor ring wraps around", CheckAesReplies(AES_TEST_REQUESTS) && LoggedMessages == logs);
+
+	//the first command of the 4th request fails once
+	ResetEngines();
+	AesFailSource = (u32)&Input[AesRequests[3].Offset];
+	AesFailCount = 1;
+	QueueAesRequests();
+	Check("aes engine error is retried", CheckAesReplies(AES_TEST_REQUESTS) && !AesCheckEngineNeeded);
+}
+
+static void TestAesFallback(void)
+{
+	//the first command of a request in the middle of the ring fails twice, so it runs on the cpu & the rest stays on the engine
+	ResetEngines();
+	AesFailSource = (u32)&Input[AesRequests[4].Offset];
+	AesFailCount = 2;
+	u32 commands = AesCommandsRun;
+	QueueAesRequests();
+	Check("aes request falls back to the cpu mid-queue", CheckAesReplies(AES_TEST_REQUESTS) && AesCheckEngineNeeded);
+	u32 engineCommands = 0;
+	for(u32 index = 0; index < AES_TEST_REQUESTS; index++)
+	{
+		if(index != 4)
+			engineCommands += (AesRequests[index].Length / AES_BLOCK_SIZE + AES_MAX_BLOCKS - 1) / AES_MAX_BLOCKS;
+	}
+	Check("aes requests around it stay on the engine", AesCommandsRun - commands == engineCommands + 2);
+	AesCheckEngine();
+	Check("aes engine passes its check afterwards", AesEngineFailures == 0 && !AesUseSoftware && !AesCheckEngineNeeded);
+
+	//the second command of a request fails, its chain can't be continued
+	ResetEngines();
+	AesFailSource = (u32)&Input[AesRequests[3].Offset + AES_MAX_BLOCKS * AES_BLOCK_SIZE];
+	AesFailCount = 1;
+	QueueAesRequests();
+	Check("aes error halfway through a request fails it", CheckAesReplies(3) && AesCheckEngineNeeded);
+	AesCheckEngine();
+
+	//a broken engine fails every command & its check
+	ResetEngines();
+	AesFailCount = 0xFFFFFFFF;
+	for(u32 failure = 0; failure < AES_ENGINE_MAX_FAILURES; failure++)
+	{
+		ReplyCount = 0;
+		QueueAesRequests();
+		if(!CheckAesReplies(AES_TEST_REQUESTS))
+			break;
+		AesCheckEngine();
+	}
+	Check("aes moves to the cpu after repeated failures", ReplyCount == AES_TEST_REQUESTS && AesUseSoftware &&
+		  AesEngineFailures == AES_ENGINE_MAX_FAILURES);
+
+	commands = AesCommandsRun;
+	ReplyCount = 0;
+	QueueAesRequests();
+	Check("aes runs on the cpu from then on", CheckAesReplies(AES_TEST_REQUESTS) && AesCommandsRun == commands);
+}
+
+static void DeliverAesIrqs(void)
+{
+	while(AesIrqPending)
+	{
+		AesIrqPending = 0;
+		AesCommandCompleted();
+	}
+}
+
+//completions of requests the handler thread isn't waiting for wake it through its resource manager queue
+static void TestAesCompletionMessage(void)
+{
+	MessageQueue* queue = &MessageQueues[AES_RESOURCE_QUEUE];
+	void* message;
+
+	//a queue full of requests still has room for the completion, but only once
+	ResetEngines();
+	for(u32 index = 0; index < AES_RM_QUEUE_SIZE - 1; index++)
+		SendTestMessage(queue, &AesMessages[index].Message);
+	Fill(Input, 0x100, 0x46);
+	for(u32 index = 0; index < 3; index++)
+	{
+		AesQueueDescriptor(&AesMessages[index].Message, COPY, &Input[index * 0x40], &Output[index * 0x40], 0x40, NULL, NULL);
+		DeliverAesIrqs();
+	}
+	Check("aes completion takes the spare queue slot", queue->Used == AES_RM_QUEUE_SIZE &&
+		  queue->QueueHeap[(queue->First + queue->Used - 1) % queue->QueueSize] == AES_COMPLETION_MESSAGE);
+
+	//queueing replies to the requests finished before, the handler picks up the rest on the first message it receives
+	ReceiveMessage(AES_RESOURCE_QUEUE, &message, None);
+	AesReplyCompleted();
+	Check("aes completions are replied to on any message", ReplyCount == 3 && memcmp(Output, Input, 3 * 0x40) == 0);
+
+	//with the queue full of requests the completion is dropped, but the next one is signalled again
+	SendTestMessage(queue, &AesMessages[0].Message);
+	AesQueueDescriptor(&AesMessages[3].Message, COPY, Input, Output, 0x40, NULL, NULL);
+	DeliverAesIrqs();
+	const bool dropped = queue->Used == AES_RM_QUEUE_SIZE && !AesCompletionSignalled;
+	ReceiveMessage(AES_RESOURCE_QUEUE, &message, None);
+	AesQueueDescriptor(&AesMessages[4].Message, COPY, Input, Output, 0x40, NULL, NULL);
+	DeliverAesIrqs();
+	Check("aes completion is signalled again after a full queue", dropped && AesCompletionSignalled &&
+		  queue->QueueHeap[(queue->First + queue->Used - 1) % queue->QueueSize] == AES_COMPLETION_MESSAGE);
+	AesWaitForDescriptor(1);
+}
+
+static s32 DecryptAndVerify(u8* ciphertext, const u32 length, u32* key, const u32* hash, u8* plaintext, u32* iv)
+{
+	IoctlvMessageData vectors[5] =
+	{
+		{ .Data = (u32*)ciphertext, .Length = length },
+		{ .Data = key, .Length = 0x10 },
+		{ .Data = (u32*)hash, .Length = sizeof(FinalShaHash) },
+		{ .Data = (u32*)plaintext, .Length = length },
+		{ .Data = iv, .Length = 0x10 },
+	};
+	IoctlvMessage message = { .Ioctl = DECRYPT_AND_VERIFY, .InputArgc = 3, .IoArgc = 2, .Data = vectors };
+	return AesDecryptAndVerify(&message);
+}
+
+//chunks of AES_PIPELINE_CHUNK decrypted by the engine & hashed by the sha engine, with a chunk falling back to the cpu
+static void TestAesDecryptAndVerify(void)
+{
+	const u32 length = 2 * AES_PIPELINE_CHUNK + 0x8000;
+	u32 key[4] = { 0x01020304, 0x05060708, 0x090A0B0C, 0x0D0E0F10 };
+	u32 iv[4] = { 0x11111111, 0x22222222, 0x33333333, 0x44444444 };
+	u32 nextIV[4];
+	u32 hash[SHA_NUM_WORDS];
+	SoftwareAesKey softwareKey;
+
+	ResetEngines();
+	Fill(Expected, length, 0xDEC);
+	ReferenceSha1(hash, Expected, length);
+	memcpy(nextIV, iv, sizeof(iv));
+	SoftwareAes_ExpandKey(&softwareKey, key);
+	SoftwareAes_EncryptCbc(&softwareKey, nextIV, Expected, Input, length / AES_BLOCK_SIZE);
+
+	u32 requestIV[4];
+	memcpy(requestIV, iv, sizeof(iv));
+	Check("aes decrypt & verify", DecryptAndVerify(Input, length, key, hash, Output, requestIV) == IPC_SUCCESS &&
+		  memcmp(Output, Expected, length) == 0 && memcmp(requestIV, nextIV, sizeof(nextIV)) == 0);
+
+	//the second chunk fails in the engine twice & is decrypted on the cpu
+	memset(Output, 0, length);
+	memcpy(requestIV, iv, sizeof(iv));
+	AesFailSource = (u32)&Input[AES_PIPELINE_CHUNK];
+	AesFailCount = 2;
+	Check("aes decrypt & verify with a chunk on the cpu", DecryptAndVerify(Input, length, key, hash, Output, requestIV) == IPC_SUCCESS &&
+		  memcmp(Output, Expected, length) == 0 && memcmp(requestIV, nextIV, sizeof(nextIV)) == 0);
+	AesCheckEngine();
+
+	//in place, with a sha engine error in the middle
+	memcpy(requestIV, iv, sizeof(iv));
+	memcpy(Output, Input, length);
+	ShaFailSkip = 2;
+	ShaFailCount = 1;
+	Check("aes decrypt & verify in place", DecryptAndVerify(Output, length, key, hash, Output, requestIV) == IPC_SUCCESS &&
+		  memcmp(Output, Expected, length) == 0);
+
+	hash[2] ^= 0x100;
+	memcpy(requestIV, iv, sizeof(iv));
+	Check("aes decrypt & verify finds a bad hash", DecryptAndVerify(Input, length, key, hash, Output, requestIV) == IPC_CHECKVALUE);
+}
+
+int main(void)
+{
+	ShaEventMessageQueueId = SHA_EVENT_QUEUE;
+	AesEventMessageQueueId = AES_EVENT_QUEUE;
+	AesResourceQueueId = AES_RESOURCE_QUEUE;
+
+	TestShaVectorSeams();
+	TestHmacMidstateCache();
+	TestShaEngineErrors();
+	TestVerifyHashesArray();
+	TestAesDescriptorRing();
+	TestAesFallback();
+	TestAesCompletionMessage();
+	TestAesDecryptAndVerify();
+	if(Failures != 0)
+	{
+		PrintHex(Failures);
+		Print(" tests failed\n");
+		return 1;
+	}
+
+	return 0;
+}
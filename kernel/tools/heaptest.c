@@ -0,0 +1,135 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	heaptest - host tests of memory/heaps.c
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// allocates, reallocates & frees on a heap & checks the blocks & data that results. usage (from kernel/tools) :
+//   make test   or   make heaptest && ./heaptest
+
+#include "kerneltest.h"
+#include "scheduler/threads.h"
+
+//what heaps.c needs from the rest of the kernel
+static ThreadInfo TestThread;
+ThreadInfo* CurrentThread = &TestThread;
+u32 DisableInterrupts(void) { return 0; }
+void RestoreInterrupts(u32 cookie) { (void)cookie; }
+s32 CheckMemoryPointer(const void* ptr, u32 size, u32 type, u32 pid, u32 domainPid)
+{
+	(void)ptr; (void)size; (void)type; (void)pid; (void)domainPid;
+	return 0;
+}
+
+#include "../source/memory/heaps.c"
+
+#define HEAP_SIZE	0x800
+
+static u8 HeapMemory[0x2000] ALIGNED(0x1000);
+
+static bool IsFilled(const u8* data, u8 value, u32 size)
+{
+	for(u32 index = 0; index < size; index++)
+	{
+		if(data[index] != value)
+			return false;
+	}
+
+	return true;
+}
+
+//all blocks must be back as a single free block once everything is freed
+static bool IsHeapEmpty(s32 heapid)
+{
+	const HeapBlock* block = heaps[heapid].FirstBlock;
+	return block == heaps[heapid].Heap && block->NextBlock == NULL && block->Size == HEAP_SIZE - ALIGNED_BLOCK_HEADER_SIZE;
+}
+
+//a 0x20 aligned block that happens to start at a page boundary has to move with 0x20 alignment. there is no other page
+//boundary in the heap, so moving it with the alignment of its address fails
+static void TestReallocateHighlyAlignedBlock(void)
+{
+	//every 0x20 aligned block takes its header & an aligned header, so the data of the second block is at 0x60
+	const s32 heapid = CreateHeap(&HeapMemory[0x1000 - 0x60], HEAP_SIZE);
+	u8* first = AllocateOnHeap(heapid, 0x20);
+	u8* block = AllocateOnHeap(heapid, 0x40);
+	u8* next = AllocateOnHeap(heapid, 0x20);
+	Check("allocated block at a page boundary", block == &HeapMemory[0x1000]);
+
+	memset(block, 0xA5, 0x40);
+	u8* moved = ReallocateOnHeap(heapid, block, 0x200);
+	Check("realloc of a page aligned block moves it", moved != NULL && moved != block);
+	Check("realloc keeps the 0x20 alignment", ((u32)moved & 0x1F) == 0);
+	Check("realloc keeps the data", moved != NULL && IsFilled(moved, 0xA5, 0x40));
+	Check("realloc clears the new space", moved != NULL && IsFilled(moved + 0x40, 0x00, 0x200 - 0x40));
+	Check("realloc frees the old block", FreeOnHeap(heapid, block) == IPC_EINVAL);
+
+	FreeOnHeap(heapid, first);
+	FreeOnHeap(heapid, next);
+	FreeOnHeap(heapid, moved);
+	Check("heap is empty again", IsHeapEmpty(heapid));
+	DestroyHeap(heapid);
+}
+
+static void TestReallocateAlignedBlock(void)
+{
+	const s32 heapid = CreateHeap(&HeapMemory[0x20], HEAP_SIZE);
+	u8* block = MallocateOnHeap(heapid, 0x20, 0x100);
+	u8* next = AllocateOnHeap(heapid, 0x20);
+	memset(block, 0x5A, 0x20);
+
+	u8* moved = ReallocateOnHeap(heapid, block, 0x100);
+	Check("realloc of a 0x100 aligned block moves it", moved != NULL && moved != block);
+	Check("realloc keeps the 0x100 alignment", ((u32)moved & 0xFF) == 0);
+	Check("realloc keeps the aligned data", moved != NULL && IsFilled(moved, 0x5A, 0x20));
+
+	FreeOnHeap(heapid, next);
+	FreeOnHeap(heapid, moved);
+	Check("heap is empty again", IsHeapEmpty(heapid));
+	DestroyHeap(heapid);
+}
+
+static void TestReallocateInPlace(void)
+{
+	const s32 heapid = CreateHeap(&HeapMemory[0x20], HEAP_SIZE);
+	u8* block = AllocateOnHeap(heapid, 0x40);
+	memset(block, 0x3C, 0x40);
+
+	u8* grown = ReallocateOnHeap(heapid, block, 0x100);
+	Check("realloc grows into the free block behind it", grown == block);
+	Check("realloc in place keeps the data", IsFilled(block, 0x3C, 0x40));
+	Check("realloc in place clears the new space", IsFilled(block + 0x40, 0x00, 0x100 - 0x40));
+
+	u8* shrunk = ReallocateOnHeap(heapid, block, 0x20);
+	u8* next = AllocateOnHeap(heapid, 0x20);
+	Check("realloc shrinks in place", shrunk == block);
+	Check("realloc gives the rest back", next != NULL && next < block + 0x100);
+
+	Check("realloc of NULL allocates", (block = ReallocateOnHeap(heapid, NULL, 0x20)) != NULL);
+	Check("realloc to size 0 frees", ReallocateOnHeap(heapid, block, 0) == NULL && FreeOnHeap(heapid, block) == IPC_EINVAL);
+	Check("realloc that can't fit fails", ReallocateOnHeap(heapid, shrunk, HEAP_SIZE) == NULL && IsFilled(shrunk, 0x3C, 0x20));
+
+	FreeOnHeap(heapid, next);
+	FreeOnHeap(heapid, shrunk);
+	Check("heap is empty again", IsHeapEmpty(heapid));
+	DestroyHeap(heapid);
+}
+
+int main(void)
+{
+	TestReallocateHighlyAlignedBlock();
+	TestReallocateAlignedBlock();
+	TestReallocateInPlace();
+	if(Failures != 0)
+	{
+		PrintHex(Failures);
+		Print(" tests failed\n");
+		return 1;
+	}
+
+	return 0;
+}
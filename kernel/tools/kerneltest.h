@@ -0,0 +1,69 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	kerneltest - runtime of the 32 bit host builds of kernel code
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// the kernel casts pointers to u32 & lays its structures out for 32 bit pointers, so the tests of kernel code that
+// isn't self contained are built as 32 bit x86 programs without a libc, against the kernel's own headers & core's
+// string.c. this provides their entry point, output & checks. the test defines the kernel functions the code it
+// includes needs (DisableInterrupts, CurrentThread, ...) itself. it needs an x86 host, but no 32 bit libraries
+
+#ifndef __KERNELTEST_H__
+#define __KERNELTEST_H__
+
+#include <types.h>
+#include <string.h>
+
+#include "../../core/source/string.c"
+
+#define HOST_SYSCALL_EXIT	1
+#define HOST_SYSCALL_WRITE	4
+
+static u32 Failures = 0;
+
+static s32 HostSyscall(u32 number, u32 argument0, u32 argument1, u32 argument2)
+{
+	s32 ret;
+	__asm__ volatile ("int $0x80" : "=a" (ret) : "a" (number), "b" (argument0), "c" (argument1), "d" (argument2) : "memory");
+	return ret;
+}
+
+static void Print(const char* text)
+{
+	HostSyscall(HOST_SYSCALL_WRITE, 1, (u32)text, strlen(text));
+}
+
+static void PrintHex(u32 value)
+{
+	char text[11] = "0x";
+	for(u32 digit = 0; digit < 8; digit++)
+		text[2 + digit] = "0123456789ABCDEF"[(value >> (28 - digit * 4)) & 0x0F];
+	text[10] = '\0';
+	Print(text);
+}
+
+static void Check(const char* name, const bool passed)
+{
+	static const char padding[] = "                                                  ";
+	const u32 length = strlen(name);
+	Print(name);
+	Print(&padding[length < 48 ? length : 48]);
+	Print(passed ? "ok\n" : "FAILED\n");
+	Failures += !passed;
+}
+
+int main(void);
+
+__attribute__((noreturn, used, force_align_arg_pointer)) void _start(void)
+{
+	const s32 ret = main();
+	for(;;)
+		HostSyscall(HOST_SYSCALL_EXIT, (u32)ret, 0, 0);
+}
+
+#endif
@@ -0,0 +1,229 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	memcpybench - host tests & benchmark of core/source/string.c's memcpy & memmove
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// checks core's memcpy & memmove against a byte by byte copy for every size up to TEST_SIZES, all source & destination
+// alignments & overlaps in both directions, then prints the same size & alignment matrix as MEMCPY_BENCHMARK (utils.h)
+// does on starlet, next to the host libc's memcpy. usage (from kernel/tools) :
+//   make test   or   make memcpybench && ./memcpybench [seconds per size]
+// a duration of 0 only runs the tests. the host has no MEM1, so the MEM1 partial word path isn't covered here
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// types.h assumes a 32 bit target, so provide the types ourselves & keep it from being included
+#define __TYPES_H__
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+//the libc memcpy to compare against, taken before core's functions are renamed over libc's names
+static void* (*const LibcMemcpy)(void*, const void*, size_t) = memcpy;
+
+//build core's string functions under their own names so they don't clash with libc
+#define strlen				CoreStrlen
+#define strnlen				CoreStrnlen
+#define set_memory			CoreSetMemory
+#define set_memory_short	CoreSetMemoryShort
+#define memset				CoreMemset
+#define memcpy				CoreMemcpy
+#define memmove				CoreMemmove
+#define memcmp				CoreMemcmp
+#define strcmp				CoreStrcmp
+#define strncmp				CoreStrncmp
+#define strncpy				CoreStrncpy
+#define strlcpy				CoreStrlcpy
+#define strlcat				CoreStrlcat
+#define strchr				CoreStrchr
+#define strspn				CoreStrspn
+#define strcspn				CoreStrcspn
+//host pointers are 64 bit & never in MEM1
+#define IS_MEM1(address)	0
+#pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+#pragma GCC diagnostic ignored "-Wint-to-pointer-cast"
+
+#include "../../core/source/string.c"
+
+#undef strlen
+#undef strnlen
+#undef set_memory
+#undef set_memory_short
+#undef memset
+#undef memcpy
+#undef memmove
+#undef memcmp
+#undef strcmp
+#undef strncmp
+#undef strncpy
+#undef strlcpy
+#undef strlcat
+#undef strchr
+#undef strspn
+#undef strcspn
+
+#define TEST_SIZES		0x120
+#define MAX_OVERLAP		0x28
+//room for the largest test or benchmark copy, plus alignment & overlap
+#define BUFFER_SIZE		0x1100
+
+static u32 Failures = 0;
+static u8 Source[BUFFER_SIZE] __attribute__((aligned(32)));
+static u8 Destination[BUFFER_SIZE] __attribute__((aligned(32)));
+static u8 Expected[BUFFER_SIZE] __attribute__((aligned(32)));
+
+static void FillPattern(u8* buffer, u32 seed)
+{
+	for(u32 i = 0; i < BUFFER_SIZE; i++)
+		buffer[i] = (u8)(i * 7 + seed);
+}
+
+static void Check(const char* name, u32 size, u32 sourceOffset, u32 destinationOffset, const u8* result)
+{
+	//compares the whole buffer, so writes outside of the copy are caught as well
+	if(memcmp(result, Expected, BUFFER_SIZE) == 0)
+		return;
+
+	//only report the first few, a broken copy fails most of the combinations
+	if(Failures < 8)
+		printf("%s FAILED : size 0x%X, source %u, destination %u\n", name, size, sourceOffset, destinationOffset);
+	Failures++;
+}
+
+static void TestCopy(void)
+{
+	for(u32 size = 0; size < TEST_SIZES; size++)
+	{
+		for(u32 sourceOffset = 0; sourceOffset < 8; sourceOffset++)
+		{
+			for(u32 destinationOffset = 0; destinationOffset < 8; destinationOffset++)
+			{
+				FillPattern(Source, 0x11);
+				FillPattern(Destination, 0xA5);
+				memcpy(Expected, Destination, BUFFER_SIZE);
+				for(u32 i = 0; i < size; i++)
+					Expected[destinationOffset + i] = Source[sourceOffset + i];
+
+				CoreMemcpy(Destination + destinationOffset, Source + sourceOffset, size);
+				Check("memcpy", size, sourceOffset, destinationOffset, Destination);
+
+				//without overlap memmove has to give the exact same result
+				FillPattern(Destination, 0xA5);
+				CoreMemmove(Destination + destinationOffset, Source + sourceOffset, size);
+				Check("memmove", size, sourceOffset, destinationOffset, Destination);
+			}
+		}
+	}
+}
+
+static void TestOverlap(void)
+{
+	u8 original[BUFFER_SIZE];
+	for(u32 size = 0; size < TEST_SIZES; size++)
+	{
+		for(u32 offset = 0; offset < 4; offset++)
+		{
+			for(u32 distance = 1; distance < MAX_OVERLAP; distance++)
+			{
+				//destination after the source, which copies backwards, & before it, which copies forwards
+				for(u32 backwards = 0; backwards < 2; backwards++)
+				{
+					const u32 sourceOffset = backwards ? offset : offset + distance;
+					const u32 destinationOffset = backwards ? offset + distance : offset;
+					FillPattern(original, 0x3C);
+					memcpy(Expected, original, BUFFER_SIZE);
+					for(u32 i = 0; i < size; i++)
+						Expected[destinationOffset + i] = original[sourceOffset + i];
+
+					memcpy(Destination, original, BUFFER_SIZE);
+					CoreMemmove(Destination + destinationOffset, Destination + sourceOffset, size);
+					Check(backwards ? "memmove backwards" : "memmove forwards", size, sourceOffset, destinationOffset, Destination);
+				}
+			}
+		}
+	}
+}
+
+static double GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+//nanoseconds per copy. the size is read back from a volatile so the compiler can't specialise the copies on it
+static double TimeCopy(void* (*copy)(void*, const void*, size_t), u8* destination, const u8* source, const u32 size, const double duration)
+{
+	volatile u32 length = size;
+	u32 count = 0;
+	double elapsed = 0;
+	const double start = GetSeconds();
+	for(; elapsed < duration || count == 0; elapsed = GetSeconds() - start)
+	{
+		for(u32 round = 0; round < 0x100; round++)
+			copy(destination, source, length);
+		count += 0x100;
+	}
+
+	return elapsed * 1e9 / count;
+}
+
+static void Benchmark(const double duration)
+{
+	static const u32 sizes[] = { 0x10, 0x40, 0x100, 0x400, 0x1000 };
+	//every size spreads its duration over its 16 alignment combinations & 4 copies
+	const double cellDuration = duration / 64;
+
+	printf("memcpy benchmark (ns per copy) size src dst : memcpy memmove memmove(overlap) libc memcpy\n");
+	for(u32 index = 0; index < sizeof(sizes) / sizeof(sizes[0]); index++)
+	{
+		const u32 size = sizes[index];
+		for(u32 sourceAlignment = 0; sourceAlignment < 4; sourceAlignment++)
+		{
+			for(u32 destinationAlignment = 0; destinationAlignment < 4; destinationAlignment++)
+			{
+				const u8* source = Source + sourceAlignment;
+				u8* destination = Destination + destinationAlignment;
+				const double memcpyTime = TimeCopy(CoreMemcpy, destination, source, size, cellDuration);
+				const double memmoveTime = TimeCopy(CoreMemmove, destination, source, size, cellDuration);
+				//overlapping, destination after the source so it has to copy backwards
+				const double overlapTime = TimeCopy(CoreMemmove, Source + sourceAlignment + 0x08 + destinationAlignment, source, size, cellDuration);
+				const double libcTime = TimeCopy(LibcMemcpy, destination, source, size, cellDuration);
+				printf("0x%04X %u %u : %8.1f %8.1f %8.1f %8.1f\n", size, sourceAlignment, destinationAlignment,
+					memcpyTime, memmoveTime, overlapTime, libcTime);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double duration = argc > 1 ? atof(argv[1]) : 1.0;
+	TestCopy();
+	TestOverlap();
+	if(Failures != 0)
+	{
+		printf("%u tests failed\n", Failures);
+		return 1;
+	}
+	printf("memcpy & memmove ok\n");
+
+	if(duration > 0)
+		Benchmark(duration);
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+
+# symbolizes the samples printed by DumpProfilerSamples over usb gecko and writes them as folded stacks,
+# which can be turned in to a flame graph with flamegraph.pl or speedscope.
+#
+# usage: profiler.py <gecko log> <elf> [elf ...] > profile.folded
+#   elf : armboot-sym.elf and the -sym.elf's of the modules, so their symbols can be found
+#
+# every sample is folded as "pid N;caller;function". the caller comes from the link register, which is only
+# reliable while the sampled function hasn't made a call of its own yet
+
+import sys, struct, bisect, re
+from collections import Counter
+
+SHT_SYMTAB = 2
+STT_FUNC = 2
+
+class Symbols:
+	def __init__(self):
+		self.starts = []
+		self.symbols = []
+
+	def load(self, filename):
+		data = open(filename, "rb").read()
+		if data[:4] != b"\x7fELF" or data[4] != 1:
+			print("ERROR: %s is not a 32 bit elf" % filename, file=sys.stderr)
+			sys.exit(1)
+
+		endian = ">" if data[5] == 2 else "<"
+		shoff, = struct.unpack(endian + "I", data[0x20:0x24])
+		shentsize, shnum = struct.unpack(endian + "HH", data[0x2E:0x32])
+
+		sections = []
+		for i in range(shnum):
+			offset = shoff + i * shentsize
+			sections.append(struct.unpack(endian + "IIIIIIIIII", data[offset:offset + 0x28]))
+
+		symbols = []
+		for section in sections:
+			if section[1] != SHT_SYMTAB:
+				continue
+
+			strings = sections[section[6]]
+			stroff = strings[4]
+			for offset in range(section[4], section[4] + section[5], 0x10):
+				name, value, size, info = struct.unpack(endian + "IIIB", data[offset:offset + 0x0D])
+				if (info & 0x0F) != STT_FUNC or value == 0:
+					continue
+
+				end = data.index(b"\0", stroff + name)
+				symbols.append((value & ~1, size, data[stroff + name:end].decode("ascii", "replace")))
+
+		for symbol in symbols:
+			index = bisect.bisect(self.starts, symbol[0])
+			self.starts.insert(index, symbol[0])
+			self.symbols.insert(index, symbol)
+
+	def lookup(self, address):
+		address &= ~1
+		index = bisect.bisect(self.starts, address) - 1
+		if index >= 0:
+			start, size, name = self.symbols[index]
+			if address < start + max(size, 1):
+				return name
+
+		return "0x%08x" % address
+
+if len(sys.argv) < 3:
+	print("usage: %s <gecko log> <elf> [elf ...]" % sys.argv[0], file=sys.stderr)
+	sys.exit(1)
+
+symbols = Symbols()
+for elf in sys.argv[2:]:
+	symbols.load(elf)
+
+sample = re.compile(r"profiler: (\d+) ([0-9a-fA-F]{8}) ([0-9a-fA-F]{8})")
+stacks = Counter()
+for line in open(sys.argv[1], "r", errors="replace"):
+	if "profiler: begin" in line:
+		stacks.clear()
+		continue
+
+	match = sample.search(line)
+	if match is None:
+		continue
+
+	function = symbols.lookup(int(match.group(2), 16))
+	caller = symbols.lookup(int(match.group(3), 16))
+	frames = ["pid %s" % match.group(1)]
+	if caller != function:
+		frames.append(caller)
+	frames.append(function)
+	stacks[";".join(frames)] += 1
+
+for stack, count in sorted(stacks.items()):
+	print("%s %d" % (stack, count))
@@ -0,0 +1,291 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	rsatest - host known answer tests & benchmark of crypto/rsa.c
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// checks Rsa_VerifySha1 against signatures made by openssl with rsa-2048 & rsa-4096 keys, each with e = 65537, e = 3
+// & e = 2^31 - 1 (which takes the windowed path), and that tampered signatures & padding are rejected.
+// then prints how many signatures of each key it verifies per second. usage (from kernel/tools) :
+//   make test   or   make rsatest && ./rsatest [seconds]
+// a duration of 0 only runs the tests. the numbers are for the host cpu, starlet runs the same code at 243MHz
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// types.h assumes a 32 bit target, so provide the types ourselves & keep it from being included
+#define __TYPES_H__
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#include "../source/crypto/rsa.c"
+
+//the keys & signatures were generated with openssl 3.0 :
+//  openssl genpkey -algorithm RSA -pkeyopt rsa_keygen_bits:2048 -pkeyopt rsa_keygen_pubexp:3 -out key.pem
+//  openssl pkeyutl -sign -inkey key.pem -in hash.bin -pkeyopt digest:sha1
+//the bad padding signatures are the raw private key operation on a block with a broken pkcs#1 padding :
+//a single fe byte in the ff's, the hash followed by garbage instead of ending the block (the layout e = 3 forgeries use)
+//& block type 02. Hash is the sha-1 of "starstruck rsa known answer"
+static const char* const Hash = "6ab19b04bc101d0e4aefb930b0ed29fda3b73763";
+
+static const char* const Modulus2048_65537 =
+	"f07f43ecf9fc0c54c91d01b150f9f7ed48bf8f98993440cb054bd01ecf7f28e47b2d9fd328a22af2f0629c5e12d70bc625caf2d1b467868e177c15b0882ce13e"
+	"3617baad4e3dddbe9921dc3cc6c789c85af5fb82e79eccdc054f8a34a4ec95de4d056c3c1960bee5a341c7414ea64617fe94b315397147116d06422f6e417f22"
+	"76ff2c668c40bdb57560131f529d558528e150c6060d0d0a0534203c75138e5d31cd769cdadc232042906ff8cb440e05e10f2933d375b7c9e342007cf1bb3770"
+	"2de6a665219252319efb23996a56124ccce5cef4d4bf39ac5ae26bd09a30d59a3880bc89b7f257f34776f175ad4f86fd7a9bdbab6467e51f41299ce222378107";
+
+static const char* const Signature2048_65537 =
+	"80ea4cef75519550a6346b620004079418c11f86dfaeb3f7ef0202adafec7f27b0f3c0697155152e38bfa819a8d730eaadbb08ebe67380c8438c3e26db12e3a5"
+	"c00a6ea1578b88e5bdd74029215ffb9f6964a152b2d54e1b7c56e6feabb9bb802bd85138b7ad85c6885895bb6cb1e33059a841ea6e60ebf0b4cfacb12d23d8a8"
+	"34097949b3db7d48e0f928fb496a0b717f6f45bf30234679865151f099c68275d6a9c3734e255453215e88ff28b881e5070e2b3fac4ade84d2e17b7036e53418"
+	"ddda62e23d850179dbf42be13a330ef0ecff2e536b8bf6cde1eec396e5ad04078264ffad841f5a4bda339025daada925b2ec22711e17b9969ba3cfa5417a1435";
+
+static const char* const Modulus2048_3 =
+	"d638eb8b1beaa7705e58788404e73a741498877f2cc766590d106a7612bf65c9d31558f293efd6e718cf0c09ba3783c19f341a625c28f4d0efae820591f5bc3f"
+	"3decf76975a33051411cc55fad18bd5081de9ab463c5ed8f3fef3be4d5ec9b057a89d3d7bc78de5dae54518b62b842ffc52d30b5f1e8aa9fa83a9d1b91f27317"
+	"e9da2f7b099eab2ced65a27910aa60f8f43a0824d098619401d83736dd9d5590caa8375a2c6e2ff39d70acabb34d48d64a6d206c4065f17269e5cc93b0690a2d"
+	"225aba4916d1abfbe25ba190186389ef31f5056408c67d5a321e03bac11c4ee701d25b68e159088778827dceda3632714b269e46f6144a9fa6e2b71a414a974b";
+
+static const char* const Signature2048_3 =
+	"4564fabed142fa958089268f83dacee83f267a5275596ae7a1f3de60380cceffa61ba69dc6c12f6cf596a1147579f287de427aae0121add194771fd93dc145ad"
+	"0583193f4a3ff6e5a0354f7d5aa2e9c1c5061ec9667fc4b3cca9eb56e5f20e6338cf28b8c5ea14699ed12c5abf9291f57394df9ca678985b1365aa7318365b95"
+	"b047260dba79816fc082125892ab49c3370fef5c68a51675bdedd79a9a17c27034f2dfc5ccd6b31a6dc51d1c004022011183d1de0ab191e12d0819d601b03c4d"
+	"ea108d6ba4f2a9c3258f371eeef3da2d0b4f41b4d489caa6fa377855bfce67f5aecb7c9320e16d50a664dc3507e96288e886f6b1711ab11e78e56c7b3f3bf8e5";
+
+static const char* const Modulus2048_Dense =
+	"a8f8a4a994c323351b639f222b549f5e0516e01838b5b773daaa286c3e84038dbe3a9734582287a3f31902b4df2aaa5d3022686411eb43fe73f472d3558d4864"
+	"4af950e41ded453744bd1028e6ffe477ae2f6aa2a3e4b8c9bc8045f733ccf25bb21e918597d6080cfab9442d909a38e5bc8eed4104f80346058213ddfb324b60"
+	"daaf2e0bdfdee3363c222a3afc1ab1942ed4613ccc5682c6ee3ea24ffd65c85d06be52287d374286fcc86a03935b05654e08246f7923003c63f460a6983d8bd8"
+	"a984e9a235c90d7587fbe78cc89ba34e7ae9a498eac7de034ba7d1a7505df43f6562c4370ea09ff4edde24dc1fc9a84c919a143cc537712d66f23ec4d99f13a5";
+
+static const char* const Signature2048_Dense =
+	"8d54e1e4152848e4a1884ba02a166d21d67b351b11d10fe5e9f4dc2bf80ab04646b7edc9825cafa48c616652df86c383df3dfd2f45916b7e57cbf9a7fdccfd8e"
+	"ab5970d68c4d9efc163f8ed61050cae21dfa7cc6bd2b15c0a5e7859a780df4a4a7173bda988197756634c3ffc76dc1ffc13abaa2602c591fb336a66f7a8e5227"
+	"c788994d25bfd131f75cc8341a231736a7d5aa267c35b93f2cfab0aa56614ad274fdf54a13e2ea92b05458aa4789c7520ac6d28d7ac87f17ea3d3fb2bdab7c26"
+	"f7a1616c467bb99f05dc5f30cfc5655419780d140952b68d55dbabfad46eedaf6884297aa46fe02b5d61c7688fc12807ca38d176458e2d1938194f2cfdbf9b40";
+
+static const char* const Modulus4096_65537 =
+	"cb593fa54a99767c670ee39818ff49df50325dc56475327cf2d607572e73ff4e476548f12d0750a4dabb76cd18548d7a9692827ffb71e9f452537dc1b1b960c5"
+	"351a066251965b76b901592ba8e620f014dd51c59d631dcbba3088c06473b3bedf658e369ee4527ac6692f0c265be9f3addfc27ce5d7e8a6fd815b679783d506"
+	"896c83f1943ef08ca20d8b06ea7b427804651c3f1a4d3a097251698be7d7ee40769a532f3e8ceea6cae288c50a58691d7a239abaf6b20acada3d12b9a8c93188"
+	"7e6a08ed82bc72998ed22f29b6275507ed22ea527ea23ea904e08d1394fb0f9933a7d0efe99a091feb0ef3a961988a038232848c87a6a790b956a1e05529fabc"
+	"e193d801f134f348b202b565ba7f7da0380d4558a3f0c7912be9f64368896e91c7240c6905d17469c452ac72d565971326e06026b934303f2ea57467fe11fd0f"
+	"ed8a38b390b68ec495628098c8bbaf20944062b662dff79af0e96b283647d130eb42bdd8e81cf8ccb28cfe0704344bed5cdff0a2247287fabdcccb1e1409d5cf"
+	"917e8bb531e3cb59293e1e39f3b8e52869a8ac1937f7bd8a3ddce445652daaf814d27e563896d4d3e90d20aba4d2d468c01f959f6c545fd78c9081ffcd53997f"
+	"506ddd0eb9abb9f0a7655d1719026648353585664e2ed1e3b005dc352992bdeda0cadeab61566f4c73a0d26bd9119a02736e819513dbc3bb25a021f41ec59fd3";
+
+static const char* const Signature4096_65537 =
+	"4298a461ea9f933477deb50735f04786c41c05f1b7113961fcfe6e6a1d455595996f3aa1bae9eb2371f596e88c382b43904c9f0bf831147708841bce68353b35"
+	"888c95963ec15ff687fe14acf2643bf77c5b0aee4a85dde6eff77fad74326b28bfc03fa6e7c69e532299565310a8a15d0b4c123d3e88ca1a5caffc672744c351"
+	"4696359f1f382d98b5d2b4878fdfefa89a966565c44f8a8c789468c6f10e51cbfb301e06748982a742810ed077086751bbf80560d229b1181d35d13e52827bb9"
+	"f24712ca10329e14f7912a5f67e5883c6524454f245ebee207d8e5b03dca3e8f7eaaea9ea99a2d940c4180ca8cb3b4bcc77cc4eb9452c6dddc8d8d104c8d0c3a"
+	"c7915bdc5ea493aab8654f864407c1d53729afdf22baf5b8057350a100832c1b65788545800988e9511496292c172ebcf962608dec49a63f8077a39af74d934d"
+	"f6d5bd4c7e040ac344b8ac8f4fa9f1e7d9f89431aa27517bad99cbfa6d5111391b4869d4d3d6a593f0f5096a36161094ea4baf52c60bf6ac637a8fd4df2cefea"
+	"4bec1ed72bbfd52feab030cf1f56ebeeeda720652819e8f8aed385c19bc25a5a7e12b6f3d4be673bdbdcb8253cc50a44156b9078b7d623e8c626659e902ce8fe"
+	"26165833e7a96d3b50e105b6f9753306ea193887a0d0c6a430a2c9c44302461843d19f4cc441cd7287634e8ce8ce8afa3b7c822db802b60e4e89b9e71504ed8c";
+
+static const char* const Modulus4096_3 =
+	"abd2e8eabd6636ab6700ea965923c004c0eb331318f35397baa160d2a9a80a5b02ecd3da6fa8057e76107f755c4ae2cd8d2895850bccd730de4124132c4fdcd1"
+	"9a989c1e12f2cf8855cc311f300c7b4814ad580b5767b3ebeec593260a3a3360b6a68b5cb2a756593380f83b691a2f94cdf9779590f006734e9f5d609af57a90"
+	"4366af5c004249aaacdd013b31f0dff2bfb31c1312db99a6098899d9f211736c5406f23bfc10e1c3b42b0792baac07dc618dcd37069c124d39c968d497bcb287"
+	"9ea8a9f3d6232b56ce088e798ee0bf741d67aa7f13e751e748ae53b1b611d28b45fdce095f1e3463abc9e905bbfeb26637d732edc3a512d29f0c70bcf2e4b618"
+	"ab26009cf0e44d07d94bebd95f2453e3741081b8d94a82db7482879b44fb610641709e5d94cb7589b6abf977c956098267fcdc2367a6d6e98b01afe14c6b5a00"
+	"27574b12e5d608033c8847c22c50bdd53e65c04ea4df54d067f3b83e8b4295c134887ee19e71682cea1cdc1c615795f2b4df625c5ea20aed8cb59aaa5d5fd747"
+	"97add2666fd8d123710f16627e09473f7ac91381746b01f5ed6fa956d56d8487af43e2cf076f862f63471ff324cf32ee68449ee044c8dc0b6ced3b7af101a160"
+	"c6b32a2c3180614692f8f5e84b101bf63c284aa7a63f65139759dfe4ec9ddce5d706cc8ee91c8547538e72bcd0e49b7f0a80d1fe38b7c67055e024ce4af10f07";
+
+static const char* const Signature4096_3 =
+	"a529d9fa4a3f5042e7bb60edc565db8a50a278c6589294319e13fb62805f2da9189d883a565182e4eb92c689ed23dc25ee6a7b0bd6945dd95f6c82f55dd6ef66"
+	"735f4ce79bff2a841a6f1c6ce3f9366628cdb584002b7eb185616ab113b8e3719d4e208c28b075a2c5173d44e1e8c75aca1384277940639e61f9658f9d9632e4"
+	"5b802d0aa27e33e5b214623a20a7920fbde08ac0b45384771c0d2f8a88454755eff3ed9dfb485fa98038e9d197b3cdc6a7cd77e7dd60105d3f14c9dfe20acb93"
+	"cc991db249802fcced2a0cf06afca6b981a86b93d043c09a80fabd5312d02461c71a7231614f6fb2d71dd4b0aa716bab576958094bca7f26b2715b76e1f42cb4"
+	"688e8e11abe23ff0db203e7951716b3486bd1ab0955e6d699b4afecc282622f9131c204d422a93a103fbbfad6d6c10c07752d8f3413fe49ae9333169cb6eb80b"
+	"5dcd8d040f6d8bf949400fccdc026059d7a4440360bfd5b5876b5a88f7387d072487e5bdc4c108420005257713bc6eca0219d6720c3f0201bcde8386bf63e8d4"
+	"2c956daccda2aff5f9121ca2f05adcbe8aa0db12582574734f7a5ac741341e03a03984c9f344bc37ed6a4a9b485f7da99b0b9e7c15dc33d371f7dc378f3717ad"
+	"b293718505715025a38afef99cb7ba72bcc31f5eea40c05256e0f36d2da227dd64719aae69e088e52c85dd531da2c9ebe29a82c2791382dc7df2e71709c2273a";
+
+static const char* const Modulus4096_Dense =
+	"cadb1acf354d12dd48a082dcee2f44defae093c0325ee059d90fdc5254c644b1011d4849733041058734827a1a7b2e15173f268f901cbfd97150d5ef860cc8f9"
+	"515fd92f79b85b0c08b8267f2278e7f42f31cd8e1eb1913ea2315c4fb0383ad2706178d1c0c1aa6f9340c851ac2712ff824ffd5c6e6b2e08dc079e5a543107c8"
+	"346a4fd013f7de0ab2c39980d845ae7ae1f46ea896302812b368c709ad3be7004b4cb5723d9c538ab9e9f6412e637c193712ac3b0e579b4161c035bed8ea8959"
+	"4764d2e523c5f096d6cbd0a6e756c7cc22d12a0471ab4ce1ee6f3488fa19ae750fed6d1fb736649e3965d13d2b3bdfb11710afda493405a88b4a1a8539a5486f"
+	"daac86983d22479c02e2dfc4b270749b436a35cd64c1d88c9a3e8b28df76f0905584a254f32ed18d88d5616a7c2f2910f8ba69f6d810b187391c2826f8753d52"
+	"462b2cc8096938a8eb10df8c59b6c6c6597878f44c0559e23d4d41f035a90961ea0837e039e7969e1e1b6e1ddbfd1030aa29467305d2a9adfd9866e6c77a8bd7"
+	"02ed9c11b25dde440a39ecb06eaf8fcecfe73a453d696f010c4ce22564e9fd2a7c052bc0ffa7c257f1f4d8e4c7a57a28856bcc51fd20bf5be0d3503d20eaf71d"
+	"7818995a6edcaeebb0b5ceffc1aa0faad667cd61d431305d423f48115cbefb9a8ca132ccbd24dc50560d27c05a9b55d42b6b93bf9f2b82588b25b6d2bf35eb61";
+
+static const char* const Signature4096_Dense =
+	"825b5feceaec6ea81a0032eaf5e94a6c439cd31cd04d92f0cd6a59907245c7d51abeffc0385fa10cd7266e5e7a4ac965a560104b78da92d0d804a8f6b7da77c8"
+	"62b17503e32b5c4bd70feaa6a7e5167ccb333aee08b0e8e52ca8a768850b6fd15a3bbc7ece28cc80311fe8d8ebc5e07d25f5153c7f4026fadc5e613a785c7a2d"
+	"645c12c2749a8246041bea2ed5a9db5a0f8e9809f67cb432033fcb85ebfc475511f5222cd251a63e03bb196fe10cf53547e0063f18bff1731ef5bc6d99821417"
+	"c9b813f08189ca1f6b0799f90d277bb5432be2e5fb003105e119af66701dd4c46a5ec2d38b66674e620e87d5ba5b11ed51bee384ba5ea9d7e38dd0edec2cdea5"
+	"7c7aa5bc92df6fd8ed5c162127938317150f4707339d12a92261513be72bafa9374fd66ed24b1468f7d5652804c648926b3419288418e8b2047a6aebb07c6d18"
+	"495a1b8dba6d377f86e958bd4cdad5b456e8c02925ab1fdbab28d7744f4ce4f0423694ad5ccc20f87957b3739c5439891c73e56fe2fbfe49325ab4e909ed6ed3"
+	"8de83ab814529ba5703d46b8d75b34ad47ee1e1b670914f9fa5d3205e71b0515056e9770e53a7ef42968e9a72826d90680d3877b2335fdbe5d573323ada4c9c0"
+	"e2501a9767eea54ae709e9a0d72ef1a8b6b4d8ef430d9c08171bc868fbfe43d4f9865c040aeebe5f593ab80f4403612277db82eff93e0532c7ab7d039c551e6d";
+
+static const char* const BadPadding2048_65537 =
+	"4932f4637da15bfc997051b55d9beef9fa264fa1d0d56a4d70c012417b8edd0419c43aa4f2e848836301f63f14f4e64f7adff293f2c6a545a9ec9ec6e6b17701"
+	"e6a92f2b424378ccfc256bbe5c5e19eeec5f6e4a581904d326fbf8e432a4a3d7a5c782051843d7d294cdd7a21732c46eca4d3498186b02fab7d7c9e2f2e9f317"
+	"66f545feb8f4e5e60aee57ae3c95b14db6bf7c7cccf53632448aa2255df339e70bbb55f0df35290af1bc21aad020a49e02ef59d396b377216705aa35668fc177"
+	"52fdac18b72ee8c2dd1d6e6182a9875afd9931f279138b6c4a1e179707b6ac67def54f31c88d5aa81df2d92fed9f478fa94f2f979fd22bd7deb419dd0ee6425b";
+
+static const char* const BadPadding2048_3 =
+	"0ed9212400333b03736551d7acb3dc6175636b41799f69e5ab0bbfed108713fd15a173404e6c93f179eb7e9808eed706cc7c986d4f28f7df8532b6092c23dede"
+	"2a078651992f508cd35833ec11a743880866e4b402baadcd69c157c547dfddd5b42b1d0b8037afa322d73e55cc910d6ccb51d12683b82b6e2516c127e489e99b"
+	"9853be8735f0757cefe3cb177fc341b6d8eebe68d581edcb5ddb89f68189fc5f4458820c208bd770229dc2ee95c4fbcdc098a73f7d00b05df4c85e41de559cd4"
+	"53c6b528df0c0ce706e5a4aee3ef29e2f42d0df0893c3ac83d836b2a24439e221c66993220da017373274f28ab5e1fc2b65ce0cd713c3b6e3e7596e84d2a8e6b";
+
+static const char* const BadPadding4096_3 =
+	"5c055f974abdfeaaa756c73a12f6812a4ccd1f14a9e5782a91da0f27cc0ec3e411ba89bc6f3da89aad95f1ab6943d16e6f8727f5d42b021a98929dbe7940a54b"
+	"7757eb3d5497c61b3a818ab1701839411302ecc837c3fc4a6142723765ce4f0e305956cb4aef9ad1a85568b805c20ecceb85262f821c8b4c34f60e74694be6a4"
+	"448bc19d5c04e72d36ceb6d0cff58060664a9be673878bf4d84d1ed0b8c407986add2a0d550d27a1dd598d888c77fe20256b14c34fe7dfeee2e1b703a6965c01"
+	"3eb9b98aff4c06e2cc7c0161b7c2076fdf86381941bb3041e4927c5a19e53f679b52e1f28eae01f3694415026f26d51528978293727985bdf211c2246676c59c"
+	"254c04dc81ab8f167acbf70556337e2dd5e26cd0ab892793ae773ca6af591279eb1eeadab1f11da766bee388b657432824fe8d58346b059a56714b44d4f3a8c7"
+	"001786636a41660ff45861403752df47623b38bfffb656029bb2dd20dfc7a990077dfd2c1af6f574bee15d346f221bc42edb9df75ff5eb95123592cbe56f6bdc"
+	"90df7f6bfe641e630a8eefca65f834e9323d857f4b26f424e5c5dc5aa132904ee8574ca921657ec1713d25cb4e1b42cbfa1a8463605b3289dc635ac86bc886db"
+	"5a7f7ab1a99a9bbef83224c167ec9dd0634d47c6d9981b4b319a39fede98241e1880fc811a65597455315377120f5e1a3caed3c465760b1562d7c070abee0027";
+
+typedef struct
+{
+	const char* name;
+	const char* modulus;
+	u32 exponent;
+	const char* signature;
+} KnownAnswer;
+
+static const KnownAnswer KnownAnswers[] =
+{
+	{ "rsa-2048, e = 65537", Modulus2048_65537, 65537, Signature2048_65537 },
+	{ "rsa-2048, e = 3", Modulus2048_3, 3, Signature2048_3 },
+	{ "rsa-2048, e = 2^31 - 1", Modulus2048_Dense, 0x7FFFFFFF, Signature2048_Dense },
+	{ "rsa-4096, e = 65537", Modulus4096_65537, 65537, Signature4096_65537 },
+	{ "rsa-4096, e = 3", Modulus4096_3, 3, Signature4096_3 },
+	{ "rsa-4096, e = 2^31 - 1", Modulus4096_Dense, 0x7FFFFFFF, Signature4096_Dense },
+};
+#define KNOWN_ANSWERS	(sizeof(KnownAnswers) / sizeof(KnownAnswers[0]))
+
+static u32 Failures = 0;
+
+static u32 ParseHex(u8* output, const char* hex)
+{
+	u32 i = 0;
+	for(; hex[2 * i] != '\0'; i++)
+		sscanf(&hex[2 * i], "%2hhx", &output[i]);
+	return i;
+}
+
+static void Check(const char* name, const char* test, bool passed)
+{
+	printf("%-24s %-24s %s\n", name, test, passed ? "ok" : "FAILED");
+	Failures += !passed;
+}
+
+static void TestKnownAnswers(void)
+{
+	u8 hash[RSA_HASH_SIZE];
+	u8 modulus[RSA_MAX_MODULUS_SIZE];
+	u8 signature[RSA_MAX_MODULUS_SIZE];
+	ParseHex(hash, Hash);
+
+	for(u32 test = 0; test < KNOWN_ANSWERS; test++)
+	{
+		const KnownAnswer* answer = &KnownAnswers[test];
+		const u32 size = ParseHex(modulus, answer->modulus);
+		ParseHex(signature, answer->signature);
+		Check(answer->name, "valid signature", Rsa_VerifySha1(modulus, size, answer->exponent, signature, hash));
+
+		signature[size - 1] ^= 0x01;
+		Check(answer->name, "tampered signature", !Rsa_VerifySha1(modulus, size, answer->exponent, signature, hash));
+		signature[size - 1] ^= 0x01;
+
+		hash[RSA_HASH_SIZE - 1] ^= 0x01;
+		Check(answer->name, "other hash", !Rsa_VerifySha1(modulus, size, answer->exponent, signature, hash));
+		hash[RSA_HASH_SIZE - 1] ^= 0x01;
+
+		//signatures have to be below the modulus
+		Check(answer->name, "signature = modulus", !Rsa_VerifySha1(modulus, size, answer->exponent, modulus, hash));
+	}
+
+	const struct
+	{
+		const char* name;
+		const char* test;
+		const char* modulus;
+		u32 exponent;
+		const char* signature;
+	} badPaddings[] =
+	{
+		{ "rsa-2048, e = 65537", "fe in the padding", Modulus2048_65537, 65537, BadPadding2048_65537 },
+		{ "rsa-2048, e = 3", "garbage after the hash", Modulus2048_3, 3, BadPadding2048_3 },
+		{ "rsa-4096, e = 3", "block type 02", Modulus4096_3, 3, BadPadding4096_3 },
+	};
+
+	for(u32 test = 0; test < sizeof(badPaddings) / sizeof(badPaddings[0]); test++)
+	{
+		const u32 size = ParseHex(modulus, badPaddings[test].modulus);
+		ParseHex(signature, badPaddings[test].signature);
+		Check(badPaddings[test].name, badPaddings[test].test,
+			!Rsa_VerifySha1(modulus, size, badPaddings[test].exponent, signature, hash));
+	}
+}
+
+static double GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+static void Benchmark(const double duration)
+{
+	u8 hash[RSA_HASH_SIZE];
+	u8 modulus[RSA_MAX_MODULUS_SIZE];
+	u8 signature[RSA_MAX_MODULUS_SIZE];
+	ParseHex(hash, Hash);
+
+	for(u32 test = 0; test < KNOWN_ANSWERS; test++)
+	{
+		const KnownAnswer* answer = &KnownAnswers[test];
+		const u32 size = ParseHex(modulus, answer->modulus);
+		ParseHex(signature, answer->signature);
+
+		u32 count = 0;
+		double elapsed = 0;
+		const double start = GetSeconds();
+		for(; elapsed < duration; elapsed = GetSeconds() - start, count++)
+			Rsa_VerifySha1(modulus, size, answer->exponent, signature, hash);
+
+		printf("%-24s : %8.1f verifications/s\n", answer->name, count / elapsed);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const double duration = argc > 1 ? atof(argv[1]) : 1.0;
+	TestKnownAnswers();
+	if(Failures != 0)
+	{
+		printf("%u tests failed\n", Failures);
+		return 1;
+	}
+
+	if(duration > 0)
+		Benchmark(duration);
+
+	return 0;
+}
@@ -0,0 +1,427 @@
+/*
+	starstruck - a Free Software reimplementation for the Nintendo/BroadOn IOS.
+	timertest - host tests & benchmark of the timer wheel in scheduler/timer.c
+
+	Copyright (C) 2026	DacoTaco
+
+# This code is licensed to you under the terms of the GNU GPL, version 2;
+# see file COPYING or http://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+*/
+
+// runs timer.c against an emulated hardware timer & alarm, jumping the timer to every alarm the wheel sets. checks that
+// timers across all wheel levels, the overflow bucket & the hardware timer wrapping fire at their expire time & in
+// order, that periodic timers don't drift when the irq is late, that slack merges alarms & that stopped timers stay
+// quiet. timerbench also prints the cycles per insert, cancel & requeue of the wheel next to those of the sorted delta
+// list it replaced, for the same workload as TIMER_BENCHMARK. usage (from kernel/tools) :
+//   make test   or   make timerbench && ./timerbench
+// the cycles are the host's, the ratio between both is what carries over to starlet
+
+#include "kerneltest.h"
+
+//processor.h's register accessors are arm assembly. the emulated timer below replaces them
+#define __PROCESSOR_H__
+static u32 read32(u32 address);
+static void write32(u32 address, u32 data);
+
+#include "../source/scheduler/timer.c"
+
+#define TEST_TIMERS			200
+#define BENCHMARK_ROUNDS	0x400
+#define BENCHMARK_REPEATS	0x10
+
+//what timer.c needs from the rest of the kernel
+MessageQueue MessageQueues[MAX_MESSAGEQUEUES];
+ThreadInfo Threads[MAX_THREADS];
+ThreadInfo ThreadStartingState;
+ThreadQueue SchedulerQueue;
+ThreadInfo* CurrentThread = &Threads[0];
+u8 TracingEnabled = 0;
+u32 DisableInterrupts(void) { return 0; }
+void RestoreInterrupts(u32 cookie) { (void)cookie; }
+u32 GetCoreClock(void) { return 0x6C; }
+void WakeThread(ThreadInfo* thread, s32 returnValue) { (void)thread; (void)returnValue; }
+s32 YieldCurrentThread(ThreadQueue* threadQueue) { (void)threadQueue; return IPC_SUCCESS; }
+void RecordTraceEvent(u32 event, u32 argument1, u32 argument2) { (void)event; (void)argument1; (void)argument2; }
+s32 CreateMessageQueue(void** ptr, u32 numberOfMessages) { (void)ptr; (void)numberOfMessages; return IPC_EMAX; }
+s32 RegisterEventCounter(const u8 device, const s32 queueid, void* message) { (void)device; (void)queueid; (void)message; return IPC_SUCCESS; }
+s32 TakeEventCount(const u8 device) { (void)device; return 0; }
+s32 ReceiveMessage(s32 queueid, void** message, u32 flags) { (void)queueid; (void)message; (void)flags; return IPC_EINVAL; }
+//the libgcc helper behind __builtin_ctzll on 32 bit x86, there is no 32 bit libgcc to link
+int __ctzdi2(u64 value)
+{
+	const u32 low = (u32)value;
+	return low != 0 ? __builtin_ctz(low) : 32 + __builtin_ctz((u32)(value >> 32));
+}
+
+s32 CheckMemoryPointer(const void* ptr, u32 size, u32 type, u32 pid, u32 domainPid)
+{
+	(void)ptr; (void)size; (void)type; (void)pid; (void)domainPid;
+	return 0;
+}
+
+u32 gecko_printf(const char* fmt, ...)
+{
+	(void)fmt;
+	return 0;
+}
+
+void panic(const char* fmt, ...)
+{
+	Print("panic: ");
+	Print(fmt);
+	for(;;)
+		HostSyscall(HOST_SYSCALL_EXIT, 2, 0, 0);
+}
+
+static u32 HardwareTimer = 0;
+static u32 HardwareAlarm = 0;
+//the timer each message came from & the hardware time it was sent at
+static u32 FiredTimers[TEST_TIMERS * 2];
+static u32 FiredTimes[TEST_TIMERS * 2];
+static u32 FiredCount = 0;
+
+static u32 read32(u32 address)
+{
+	return address == HW_TIMER ? HardwareTimer : 0;
+}
+
+static void write32(u32 address, u32 data)
+{
+	if(address == HW_ALARM)
+		HardwareAlarm = data;
+}
+
+s32 SendMessageToQueue(MessageQueue* messageQueue, void* message, u32 flags)
+{
+	(void)messageQueue; (void)flags;
+	if(FiredCount < TEST_TIMERS * 2)
+	{
+		FiredTimers[FiredCount] = (u32)message;
+		FiredTimes[FiredCount] = HardwareTimer;
+	}
+	FiredCount++;
+	return IPC_SUCCESS;
+}
+
+static void PrintNumber(u32 value)
+{
+	char text[11];
+	u32 index = sizeof(text) - 1;
+	text[index] = '\0';
+	do
+	{
+		text[--index] = (char)('0' + value % 10);
+		value /= 10;
+	} while(value != 0);
+	Print(&text[index]);
+}
+
+static u32 Random(void)
+{
+	static u32 state = 0x12345678;
+	state = state * 1664525 + 1013904223;
+	return state >> 8;
+}
+
+static void ResetTimers(u32 time)
+{
+	memset(timers, 0, sizeof(timers));
+	memset(TimerBuckets, 0, sizeof(TimerBuckets));
+	memset(TimerBucketsUsed, 0, sizeof(TimerBucketsUsed));
+	HardwareTimer = time;
+	WheelTime = time;
+	AlarmSet = 0;
+	FiredCount = 0;
+	CoalescedTimerInterrupts = 0;
+}
+
+static void StartTestTimer(u32 timer, u32 ticks, u32 periodUs, u16 slackTicks)
+{
+	timers[timer].MessageQueue = &MessageQueues[0];
+	timers[timer].Message = (void*)timer;
+	timers[timer].IntervalInTicks = ticks;
+	timers[timer].IntervalInµs = periodUs;
+	timers[timer].SlackInTicks = slackTicks;
+	QueueTimer(&timers[timer]);
+}
+
+//what TimerHandler does for every timer irq, once the hardware timer reached the alarm & some ticks of irq latency
+static void RunAlarm(u32 latency)
+{
+	HardwareTimer = HardwareAlarm + latency;
+	AlarmSet = 0;
+	RunTimerWheel(read32(HW_TIMER));
+	UpdateTimerAlarm();
+}
+
+//delays on every level of the wheel, in the overflow bucket & longer than the wheel can order in one go,
+//from just before the hardware timer wraps
+static void TestTimerOrder(void)
+{
+	const u32 startTime = 0xFFF00000;
+	u32 expireTimes[TEST_TIMERS];
+	ResetTimers(startTime);
+	for(u32 timer = 0; timer < TEST_TIMERS; timer++)
+	{
+		u32 ticks = 1 + (Random() & ((1u << (Random() % 31)) - 1));
+		if(timer == 0)
+			ticks = 0xF0000000;
+		else if(timer == 1)
+			ticks = 3 * TIMER_MAX_WHEEL_TICKS;
+		else if(timer == 2)
+			ticks = 1;
+
+		expireTimes[timer] = ticks;
+		StartTestTimer(timer, ticks, 0, 0);
+	}
+
+	for(u32 alarm = 0; alarm < 0x10000 && FiredCount < TEST_TIMERS; alarm++)
+		RunAlarm(0);
+
+	bool once = FiredCount == TEST_TIMERS;
+	bool onTime = once;
+	bool inOrder = once;
+	u32 seen[TEST_TIMERS] = { 0 };
+	for(u32 index = 0; once && index < TEST_TIMERS; index++)
+	{
+		const u32 timer = FiredTimers[index];
+		const u32 lateness = FiredTimes[index] - startTime - expireTimes[timer];
+		seen[timer]++;
+		//the alarm is never set less than 2 ticks ahead
+		if(lateness > 1)
+		{
+			Print("timer ");
+			PrintHex(expireTimes[timer]);
+			Print(" fired late by ");
+			PrintHex(lateness);
+			Print("\n");
+			onTime = false;
+		}
+		if(index > 0)
+			inOrder &= expireTimes[FiredTimers[index - 1]] <= expireTimes[timer];
+	}
+	for(u32 timer = 0; timer < TEST_TIMERS; timer++)
+		once &= seen[timer] == 1;
+
+	Check("every timer fired once", once);
+	Check("timers fire at their expire time", onTime);
+	Check("timers fire in order of expire time", inOrder);
+}
+
+//the alarms in between that only cascade timers down the wheel are late as well
+static void TestPeriodicTimer(void)
+{
+	ResetTimers(0x80000000);
+	const u32 period = ConvertDelayToTicks(1000);
+	StartTestTimer(0, period, 1000, 0);
+	for(u32 alarm = 0; alarm < 0x1000 && FiredCount < 50; alarm++)
+		RunAlarm(alarm % 7);
+
+	bool noDrift = FiredCount == 50;
+	for(u32 index = 0; noDrift && index < FiredCount; index++)
+		noDrift &= FiredTimes[index] - (0x80000000 + (index + 1) * period) < 7;
+	Check("periodic timer doesn't drift when irqs are late", noDrift);
+}
+
+static void TestSlack(void)
+{
+	ResetTimers(0x1000);
+	StartTestTimer(0, 0x300, 0, 0x100);
+	StartTestTimer(1, 0x3C0, 0, 0x100);
+	StartTestTimer(2, 0x2000, 0, 0);
+	RunAlarm(0);
+	Check("timers with overlapping slack share an alarm",
+		FiredCount == 2 && FiredTimes[0] == FiredTimes[1] && FiredTimes[0] <= 0x1000 + 0x300 + 0x100);
+	Check("the shared alarm is counted", GetCoalescedTimerInterrupts() == 1);
+	RunAlarm(0);
+	Check("timers without slack keep their own alarm", FiredCount == 3 && FiredTimes[2] == 0x1000 + 0x2000);
+}
+
+static void TestStoppedTimers(void)
+{
+	ResetTimers(0);
+	for(u32 timer = 0; timer < 8; timer++)
+		StartTestTimer(timer, 0x100 * (timer + 1), 0, 0);
+	for(u32 timer = 0; timer < 8; timer += 2)
+		StopTimer((s32)timer);
+
+	for(u32 alarm = 0; alarm < 16; alarm++)
+		RunAlarm(0);
+
+	bool quiet = FiredCount == 4;
+	for(u32 index = 0; quiet && index < FiredCount; index++)
+		quiet &= (FiredTimers[index] & 1) == 1;
+	Check("stopped timers don't fire", quiet);
+}
+
+#ifdef BENCHMARK
+//the sorted delta list timer.c used before the wheel : every timer holds the ticks between it & the timer before it
+typedef struct DeltaTimer
+{
+	u32 IntervalInTicks;
+	u32 PeriodInTicks;
+	struct DeltaTimer* PreviousTimer;
+	struct DeltaTimer* NextTimer;
+} DeltaTimer;
+
+static DeltaTimer DeltaListHead = { 0, 0, &DeltaListHead, &DeltaListHead };
+
+static void DeltaListInsert(DeltaTimer* timerInfo, u32 ticks)
+{
+	DeltaTimer* nextTimer = DeltaListHead.NextTimer;
+	while(nextTimer != &DeltaListHead && nextTimer->IntervalInTicks < ticks)
+	{
+		ticks -= nextTimer->IntervalInTicks;
+		nextTimer = nextTimer->NextTimer;
+	}
+
+	timerInfo->IntervalInTicks = ticks;
+	if(nextTimer != &DeltaListHead)
+		nextTimer->IntervalInTicks -= ticks;
+
+	timerInfo->PreviousTimer = nextTimer->PreviousTimer;
+	timerInfo->NextTimer = nextTimer;
+	nextTimer->PreviousTimer->NextTimer = timerInfo;
+	nextTimer->PreviousTimer = timerInfo;
+}
+
+static void DeltaListRemove(DeltaTimer* timerInfo)
+{
+	if(timerInfo->NextTimer != &DeltaListHead)
+		timerInfo->NextTimer->IntervalInTicks += timerInfo->IntervalInTicks;
+
+	timerInfo->PreviousTimer->NextTimer = timerInfo->NextTimer;
+	timerInfo->NextTimer->PreviousTimer = timerInfo->PreviousTimer;
+}
+
+//the fastest of the repeats, the others got interrupted by the host
+static void KeepFastest(u32* cycles, u32 measurement)
+{
+	if(measurement < *cycles)
+		*cycles = measurement;
+}
+
+static u32 ReadCycles(void)
+{
+	u32 low, high;
+	__asm__ volatile ("rdtsc" : "=a" (low), "=d" (high));
+	return low;
+}
+
+//the ops of BenchmarkTimers : periodic timers with periods between ~1ms and ~1s are inserted, requeued one period
+//later the way the handler does & cancelled. returns the cycles per insert, cancel & requeue
+static void BenchmarkWheel(u32 count, u32 cycles[3])
+{
+	static TimerInfo scratchTimers[256];
+	memset(cycles, 0xFF, 3 * sizeof(u32));
+	for(u32 repeat = 0; repeat < BENCHMARK_REPEATS; repeat++)
+	{
+		ResetTimers(0);
+		memset(scratchTimers, 0, sizeof(scratchTimers));
+		u32 start = ReadCycles();
+		for(u32 timer = 0; timer < count; timer++)
+			ScheduleTimer(&scratchTimers[timer], 0, ConvertDelayToTicks(1000 + (timer * 3907)));
+		KeepFastest(&cycles[0], ReadCycles() - start);
+
+		start = ReadCycles();
+		for(u32 round = 0; round < BENCHMARK_ROUNDS; round++)
+		{
+			TimerInfo* timerInfo = &scratchTimers[round % count];
+			RemoveTimer(timerInfo);
+			ScheduleTimer(timerInfo, timerInfo->ExpireTime, ConvertDelayToTicks(1000 + ((round % count) * 3907)));
+		}
+		KeepFastest(&cycles[2], ReadCycles() - start);
+
+		start = ReadCycles();
+		for(u32 timer = 0; timer < count; timer++)
+			RemoveTimer(&scratchTimers[timer]);
+		KeepFastest(&cycles[1], ReadCycles() - start);
+	}
+
+	cycles[0] /= count;
+	cycles[1] /= count;
+	cycles[2] /= BENCHMARK_ROUNDS;
+}
+
+static void BenchmarkDeltaList(u32 count, u32 cycles[3])
+{
+	static DeltaTimer scratchTimers[256];
+	memset(cycles, 0xFF, 3 * sizeof(u32));
+	for(u32 repeat = 0; repeat < BENCHMARK_REPEATS; repeat++)
+	{
+		u32 start = ReadCycles();
+		for(u32 timer = 0; timer < count; timer++)
+		{
+			scratchTimers[timer].PeriodInTicks = ConvertDelayToTicks(1000 + (timer * 3907));
+			DeltaListInsert(&scratchTimers[timer], scratchTimers[timer].PeriodInTicks);
+		}
+		KeepFastest(&cycles[0], ReadCycles() - start);
+
+		//the requeue is relative to the list head, like the old handler requeued relative to the time it ran
+		start = ReadCycles();
+		for(u32 round = 0; round < BENCHMARK_ROUNDS; round++)
+		{
+			DeltaTimer* timerInfo = &scratchTimers[round % count];
+			DeltaListRemove(timerInfo);
+			DeltaListInsert(timerInfo, timerInfo->PeriodInTicks);
+		}
+		KeepFastest(&cycles[2], ReadCycles() - start);
+
+		start = ReadCycles();
+		for(u32 timer = 0; timer < count; timer++)
+			DeltaListRemove(&scratchTimers[timer]);
+		KeepFastest(&cycles[1], ReadCycles() - start);
+	}
+
+	cycles[0] /= count;
+	cycles[1] /= count;
+	cycles[2] /= BENCHMARK_ROUNDS;
+}
+
+static void Benchmark(void)
+{
+	static const u32 counts[] = { 16, 64, 256 };
+	Print("timer benchmark (host cycles per timer) timers : insert cancel requeue\n");
+	for(u32 index = 0; index < sizeof(counts) / sizeof(counts[0]); index++)
+	{
+		u32 deltaList[3];
+		u32 wheel[3];
+		BenchmarkDeltaList(counts[index], deltaList);
+		BenchmarkWheel(counts[index], wheel);
+
+		const u32* results[] = { deltaList, wheel };
+		const char* names[] = { "  delta list  ", "  timer wheel " };
+		for(u32 result = 0; result < 2; result++)
+		{
+			Print(names[result]);
+			PrintNumber(counts[index]);
+			Print(" : ");
+			for(u32 operation = 0; operation < 3; operation++)
+			{
+				PrintNumber(results[result][operation]);
+				Print(operation < 2 ? " " : "\n");
+			}
+		}
+	}
+}
+#endif
+
+int main(void)
+{
+	InitializeTimerConversion();
+	TestTimerOrder();
+	TestPeriodicTimer();
+	TestSlack();
+	TestStoppedTimers();
+	if(Failures != 0)
+	{
+		PrintNumber(Failures);
+		Print(" tests failed\n");
+		return 1;
+	}
+
+#ifdef BENCHMARK
+	Benchmark();
+#endif
+	return 0;
+}
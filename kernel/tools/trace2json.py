@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+
+# converts the events printed by DumpTraceEvents over usb gecko to the chrome trace event format,
+# which can be opened in chrome://tracing or ui.perfetto.dev
+#
+# usage: trace2json.py <gecko log> <output json>
+#
+# every thread gets a slice for each time it was scheduled, irq's are shown on their own track and ipc messages
+# that got a ResourceReply are followed from the moment they were first sent until the reply
+
+import sys, re, json
+
+TRACE_SCHEDULE = 0
+TRACE_UNBLOCK_THREAD = 1
+TRACE_SEND_MESSAGE = 2
+TRACE_RECEIVE_MESSAGE = 3
+TRACE_RESOURCE_REPLY = 4
+TRACE_IRQ_ENTRY = 5
+TRACE_IRQ_EXIT = 6
+TRACE_TIMER_FIRE = 7
+
+IRQ_TRACK = 0x100
+
+if len(sys.argv) != 3:
+	print("usage: %s <gecko log> <output json>" % sys.argv[0], file=sys.stderr)
+	sys.exit(1)
+
+header = re.compile(r"trace: begin (\d+) events (\d+) ticks per ms")
+record = re.compile(r"trace: ([0-9a-fA-F]{8}) ([0-9a-fA-F]{4})([0-9a-fA-F]{4}) ([0-9a-fA-F]{8}) ([0-9a-fA-F]{8})")
+
+ticksPerUs = None
+events = []
+for line in open(sys.argv[1], "r", errors="replace"):
+	match = header.search(line)
+	if match is not None:
+		#only the last dump in the log is converted
+		ticksPerUs = int(match.group(2)) / 1000.0
+		events = []
+		continue
+
+	match = record.search(line)
+	if match is not None:
+		events.append(tuple(int(group, 16) for group in match.groups()))
+
+if ticksPerUs is None or ticksPerUs == 0:
+	print("ERROR: no trace dump found in %s" % sys.argv[1], file=sys.stderr)
+	sys.exit(1)
+
+#the hardware timer is 32 bit, so unwrap the timestamps before converting them to µs
+timestamps = []
+wraps = 0
+previous = None
+for event in events:
+	if previous is not None and event[0] < previous and previous - event[0] > 0x80000000:
+		wraps += 1
+	previous = event[0]
+	timestamps.append(((wraps << 32) + event[0]) / ticksPerUs)
+
+if len(timestamps) != 0:
+	start = timestamps[0]
+	timestamps = [timestamp - start for timestamp in timestamps]
+
+replied = set(event[3] for event in events if event[1] == TRACE_RESOURCE_REPLY)
+processIds = {}
+for event in events:
+	if event[1] == TRACE_SCHEDULE:
+		processIds[event[2]] = event[3]
+
+output = []
+running = None
+requests = set()
+irqStart = None
+for timestamp, (_, eventId, threadId, argument1, argument2) in zip(timestamps, events):
+	pid = processIds.get(threadId, 0)
+	if eventId == TRACE_SCHEDULE:
+		if running is not None:
+			output.append({ "name": "running", "ph": "X", "ts": running[2], "dur": timestamp - running[2], "pid": running[1], "tid": running[0] })
+		running = (threadId, argument1, timestamp)
+	elif eventId == TRACE_IRQ_ENTRY:
+		irqStart = (timestamp, argument1)
+	elif eventId == TRACE_IRQ_EXIT:
+		if irqStart is not None:
+			output.append({ "name": "irq 0x%08x" % argument1, "ph": "X", "ts": irqStart[0], "dur": timestamp - irqStart[0],
+				"pid": 0, "tid": IRQ_TRACK, "args": { "pending": "0x%08x" % irqStart[1], "ticks": argument2 } })
+		irqStart = None
+	elif eventId == TRACE_SEND_MESSAGE:
+		output.append({ "name": "send", "ph": "i", "s": "t", "ts": timestamp, "pid": pid, "tid": threadId,
+			"args": { "queue": argument1, "message": "0x%08x" % argument2 } })
+		if argument2 in replied and argument2 not in requests:
+			requests.add(argument2)
+			output.append({ "name": "ipc 0x%08x" % argument2, "cat": "ipc", "ph": "b", "id2": { "global": "0x%08x" % argument2 }, "ts": timestamp, "pid": pid, "tid": threadId })
+	elif eventId == TRACE_RECEIVE_MESSAGE:
+		output.append({ "name": "receive", "ph": "i", "s": "t", "ts": timestamp, "pid": pid, "tid": threadId,
+			"args": { "queue": argument1, "message": "0x%08x" % argument2 } })
+		if argument2 in requests:
+			output.append({ "name": "ipc 0x%08x" % argument2, "cat": "ipc", "ph": "n", "id2": { "global": "0x%08x" % argument2 }, "ts": timestamp, "pid": pid, "tid": threadId,
+				"args": { "queue": argument1 } })
+	elif eventId == TRACE_RESOURCE_REPLY:
+		output.append({ "name": "reply", "ph": "i", "s": "t", "ts": timestamp, "pid": pid, "tid": threadId,
+			"args": { "message": "0x%08x" % argument1, "result": argument2 - (1 << 32) if argument2 & 0x80000000 else argument2 } })
+		if argument1 in requests:
+			requests.discard(argument1)
+			output.append({ "name": "ipc 0x%08x" % argument1, "cat": "ipc", "ph": "e", "id2": { "global": "0x%08x" % argument1 }, "ts": timestamp, "pid": pid, "tid": threadId })
+	elif eventId == TRACE_UNBLOCK_THREAD:
+		output.append({ "name": "unblock", "ph": "i", "s": "t", "ts": timestamp, "pid": pid, "tid": threadId,
+			"args": { "thread": argument1, "return": argument2 } })
+	elif eventId == TRACE_TIMER_FIRE:
+		output.append({ "name": "timer", "ph": "i", "s": "t", "ts": timestamp, "pid": pid, "tid": threadId,
+			"args": { "timer": "0x%08x" % argument1, "message": "0x%08x" % argument2 } })
+
+if running is not None and len(timestamps) != 0:
+	output.append({ "name": "running", "ph": "X", "ts": running[2], "dur": timestamps[-1] - running[2], "pid": running[1], "tid": running[0] })
+
+for threadId, pid in processIds.items():
+	output.append({ "name": "thread_name", "ph": "M", "pid": pid, "tid": threadId, "args": { "name": "thread %d" % threadId } })
+for pid in set(processIds.values()) | { 0 }:
+	output.append({ "name": "process_name", "ph": "M", "pid": pid, "args": { "name": "process %d" % pid } })
+output.append({ "name": "thread_name", "ph": "M", "pid": 0, "tid": IRQ_TRACK, "args": { "name": "irq" } })
+
+json.dump({ "traceEvents": output, "displayTimeUnit": "ns" }, open(sys.argv[2], "w"), indent=1)